@@ -16,6 +16,7 @@ typedef struct db2Column {
   size_t              colBytes;      // number of bytes representing colSize
   int                 colPrimKeyPart;// 1 if column is part of the primary key - only relevant for UPDATE or DELETE
   int                 colCodepage;   // codepage set for this column (only set on char columns), if 0 the content is binary
+  int                 colIndexed;    // 1 if the column leads a DB2 index, 2 if it is the only column of a unique index - only used for planning
   char*               pgname;        // PG column name
   int                 pgattnum;      // PG attribute number
   Oid                 pgtype;        // PG data type
@@ -24,10 +25,12 @@ typedef struct db2Column {
   int                 pkey;          // nonzero for primary keys, later set to the resjunk attribute number
   char*               val;           // buffer for DB2 to return results in (LOB locator for LOBs)
   size_t              val_size;      // allocated size in val
+  size_t              val_bound;     // size of val bound to the result, longer values are read with SQLGetData
   size_t              val_len;       // actual length of val
   int                 val_null;      // indicator for NULL value
   int                 varno;         // range table index of this column's relation
   db2NoEncErrType     noencerr;      // no encoding error produced
+  int                 colCollate;    // 1 if DB2 compares and sorts the column's strings like PostgreSQL (option "collation_compatible")
 } DB2Column;
 
 #endif
\ No newline at end of file
@@ -9,6 +9,8 @@
  *  Attached to a specific connection is a pure forward linked list of HdlEntry elemens
  *  in "handleList". By that the code is able to reuse any active statment handle in that
  *  chain.
+ *  The index columns of the tables described on the connection are cached in "indexlist".
+ *  The key tables declared on the connection and not yet dropped are in "keytablelist".
  * 
  *  @see    HdlList.h for more details on a HdlEntry element of handleList.
  *  @author Ing. Wolfgang Brandl
@@ -22,6 +24,8 @@ typedef struct connEntry {
   SQLHDBC             hdbc;       // SQL DB connect handle
   ULONG               conAttr;    // connection attributes
   HdlEntry*           handlelist; // linked list of statement handles
+  IndexEntry*         indexlist;  // linked list of the index columns of described tables
+  KeyTableEntry*      keytablelist; // linked list of the declared key tables
   int                 xact_level; // transaction level 0 = none, 1 = main, else subtransaction
   struct connEntry*   left;       // preceeding connection
   struct connEntry*   right;      // following connection
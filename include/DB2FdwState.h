@@ -4,6 +4,11 @@
 #ifndef PARAMDESC_H
 #include "ParamDesc.h"
 #endif
+#ifndef LOOKUPENTRY_H
+#include "LookupEntry.h"
+#endif
+#include <utils/tuplestore.h>
+#include <utils/hsearch.h>
 
 /** DB2FdwState
  *  FDW-specific information for RelOptInfo.fdw_private and ForeignScanState.fdw_state.
@@ -33,6 +38,32 @@ typedef struct db2FdwState {
   int                 columnindex;   // currently processed column for error context
   MemoryContext       temp_cxt;      // short-lived memory for data modification
   unsigned int        prefetch;      // number of rows to prefetch
+  int                 fetch_memory;  // bytes the prefetched rows may take, 0 if "prefetch" applies as is
+  double              fetch_bytes;   // length of the values converted so far, to adapt prefetch to fetch_memory
+  unsigned long       fetch_rows;    // number of rows converted so far
+  int                 column_buffer; // largest result buffer of a character column, 0 for the declared size
+  bool                rescan_cache;  // keep the result locally for rescans
+  int                 key_table_min; // ship arrays with at least this many elements into a key table, 0 = never
+  bool                bind_constants;// bind constants of pushed down conditions as parameters, only needed for planning
+  db2LoadMode         load_mode;     // INSERT rows through the DB2 LOAD utility
+  int                 load_savecount;// rows between the consistency points of a load, 0 for none
+  char*               load_messages; // message file of a load, NULL for the default
+  Tuplestorestate*    rescan_store;  // local copy of the result set, NULL if not materialized
+  bool                rescan_full;   // rescan_store holds the complete result set
+  bool                rescan_read;   // rows are returned from rescan_store instead of DB2
+  TupleTableSlot*     rescan_slot;   // slot to read rows from rescan_store
+  MemoryContext       lookup_cxt;    // memory for full_cache and its rows, NULL if there is no switch to a full scan
+  Size                lookup_used;   // memory used by the rows in full_cache
+  LookupEntry*        lookup_entry;  // rows being returned from full_cache, NULL if none
+  ListCell*           lookup_next;   // next row to return from lookup_entry
+  bool                lookup_read;   // rows are returned from lookup_entry instead of DB2
+  char*               full_query;    // query without the parameterized join conditions, NULL if lookups cannot switch to a full scan
+  List*               full_keys;     // attribute numbers of the join keys compared with the parameters, by position
+  int                 full_after;    // number of lookups after which the full result is fetched
+  unsigned long       lookups;       // lookups sent to DB2 so far
+  HTAB*               full_cache;    // full result by hash of the join keys, NULL if not fetched
+  TupleTableSlot*     full_slot;     // slot to compare the join keys of rows in full_cache
+  LookupEntry*        full_match;    // rows of full_cache matching the current parameter values
   char*               order_clause;  // for sort-pushdown
   char*               where_clause;  // deparsed where clause
   /*
@@ -55,5 +86,7 @@ typedef struct db2FdwState {
   RelOptInfo*         innerrel;
   JoinType            jointype;
   List*               joinclauses;
+  /* Computed columns */
+  List*               scan_tlist;    // target list of the remote query if it is not the table row, only needed for planning
 } DB2FdwState;
 #endif
\ No newline at end of file
@@ -15,5 +15,9 @@ typedef struct db2Table {
   int                 ncols;         // number of columns in DB2 table
   int                 npgcols;       // number of columns (including dropped) in the PostgreSQL foreign table
   DB2Column**         cols;          // pointer to an array of DB2Column descriptors, as many as ncols tells
+  int                 nattrs;        // number of entries in attrmap
+  int*                attrmap;       // index in cols for each PostgreSQL attribute number - 1, -1 if there is none
+  char*               buffers;       // one block holding the result buffers (val) of all used columns
+  size_t              buffers_size;  // allocated size of buffers
 } DB2Table;
 #endif
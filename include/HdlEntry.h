@@ -6,6 +6,8 @@
  *  a statement handle. For historic reasons the element carries a type.
  *  It was formerly used to distinguish statement handles from resource handles.
  *  Hence, resource handles are no longer required by DB2 SQL CLI API.
+ *  A prepared statement keeps its parameter buffers and the state of its cursor,
+ *  so it can be executed repeatedly without being prepared again.
  * 
  *  @author Ing. Wolfgang Brandl
  *  @since  1.0
@@ -22,6 +24,13 @@ typedef struct handleEntry
   struct handleEntry* next;
   SQLCHAR             dummy_buffer[4];   // Buffer for COUNT(*) queries with no columns
   SQLLEN              dummy_null;        // Null indicator for dummy buffer
+  int                 cursor_open;       // 1 while the executed statement has an open result set
+  int                 param_cnt;         // number of elements in param_buf
+  ParamBuf*           param_buf;         // parameter buffers bound to the statement, kept across executions
+  SQLINTEGER          load_mode;         // SQL_USE_LOAD_INSERT or SQL_USE_LOAD_REPLACE while the statement runs a LOAD, 0 otherwise
+  void*               load_info;         // db2LoadStruct passed with SQL_ATTR_LOAD_INFO, NULL if none
+  SQLINTEGER          load_loaded;       // rows loaded, set when the LOAD ends
+  SQLINTEGER          load_rejected;     // rows rejected, set when the LOAD ends
 } HdlEntry;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,21 @@
+#ifndef INDEXENTRY_H
+#define INDEXENTRY_H
+/** IndexEntry
+ *  The columns of a DB2 table that lead an index, as read by SQLStatistics.
+ *  The entries are kept in a forward linked list at the connection, so that
+ *  the DB2 catalog is only asked once per table and connection, and not
+ *  every time a query on the foreign table is planned.
+ * 
+ *  @see    DB2ConnEntry.h for the connection carrying the list
+ *  @author Ing. Wolfgang Brandl
+ *  @since  18.1
+ */
+typedef struct indexEntry {
+  char*               schema;     // DB2 schema of the table, NULL for the default schema
+  char*               table;      // DB2 table name
+  int                 ncols;      // number of entries in colName and indexed
+  char**              colName;    // quoted names of the columns leading an index
+  int*                indexed;    // 1 if the column leads an index, 2 if it is the only column of a unique index
+  struct indexEntry*  next;       // next table described on the connection
+} IndexEntry;
+#endif
@@ -0,0 +1,17 @@
+#ifndef KEYTABLEENTRY_H
+#define KEYTABLEENTRY_H
+/** KeyTableEntry
+ *  A key table declared on a DB2 connection by db2DeclareKeyTable.
+ *  The entries are kept in a forward linked list at the connection, so that
+ *  the tables a scan could not drop, because it ended with an error, are
+ *  dropped when the transaction ends.
+ * 
+ *  @see    DB2ConnEntry.h for the connection carrying the list
+ *  @author Ing. Wolfgang Brandl
+ *  @since  18.1
+ */
+typedef struct keyTableEntry {
+  char*                 tabname;  // qualified name of the declared temporary table
+  struct keyTableEntry* next;     // next key table declared on the connection
+} KeyTableEntry;
+#endif
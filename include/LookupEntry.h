@@ -0,0 +1,15 @@
+#ifndef LOOKUPENTRY_H
+#define LOOKUPENTRY_H
+/** LookupEntry
+ *  One entry of the full result a parameterized scan switched to. It holds
+ *  the rows whose join keys have the same hash, so that a rescan finds the
+ *  rows for its parameter values without a round trip to DB2.
+ *
+ *  @author Ing Wolfgang Brandl
+ *  @since  1.0
+ */
+typedef struct lookupEntry {
+  uint32              hash;      // hash of the join key values, hash key
+  List*               tuples;    // MinimalTuples with join keys of this hash
+} LookupEntry;
+#endif
@@ -0,0 +1,29 @@
+#ifndef PARAMBUF_H
+#define PARAMBUF_H
+/** ParamBuf
+ *  The buffer bound to one parameter marker of a prepared statement.
+ *  It lives as long as the statement handle it belongs to, so that a statement
+ *  can be executed again with new values by only refilling the buffers.
+ *  The binding attributes are remembered, SQLBindParameter is only called again
+ *  if any of them changes.
+ * 
+ *  @see    HdlEntry.h for the statement handle carrying the buffers
+ *  @author Ing. Wolfgang Brandl
+ *  @since  18.1
+ */
+typedef struct paramBuf {
+  SQLSMALLINT         inout;      // SQL_PARAM_INPUT or SQL_PARAM_OUTPUT of the current binding
+  SQLSMALLINT         ctype;      // C data type of the current binding
+  SQLSMALLINT         sqltype;    // SQL data type of the current binding
+  SQLULEN             colsize;    // column size of the current binding
+  SQLSMALLINT         digits;     // decimal digits of the current binding
+  SQLPOINTER          ptr;        // address of the currently bound value
+  SQLLEN              buflen;     // buffer length of the current binding
+  SQLLEN              ind;        // length/indicator of the bound value
+  SQLSMALLINT         sval;       // value storage for SMALLINT parameters
+  SQLINTEGER          ival;       // value storage for INTEGER parameters
+  SQL_NUMERIC_STRUCT  nval;       // value storage for DECIMAL/NUMERIC parameters
+  SQLCHAR*            cval;       // value storage for character parameters
+  SQLLEN              cval_size;  // allocated size of cval
+} ParamBuf;
+#endif
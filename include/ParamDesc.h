@@ -11,9 +11,18 @@ typedef struct paramDesc {
   Oid                 type;      // PG data type
   db2BindType         bindType;  // which type to use for binding to DB2 statement
   char*               value;     // value rendered for DB2
+  long                value_len; // length of value for BIND_LONG and BIND_LONGRAW, binary values are not terminated
+  void*               lob;       // BIND_LONG and BIND_LONGRAW: TOAST pointer of a value sent in pieces at execution, value is NULL then
   void*               node;      // the executable expression
   int                 colnum;    // corresponding column in DB2Table (-1 in SELECT queries unless output column)
   int                 txts;      // transaction timestamp
+  int                 isarray;   // array parameter of an IN list, "type" is the element type
+  char**              elems;     // array parameter: element values rendered for DB2, NULL for a NULL element
+  int                 nelems;    // array parameter: number of entries in elems
+  int                 nmarkers;  // array parameter: number of markers in the prepared statement
+  char*               keytable;  // array parameter: DB2 temporary table holding the elements, NULL if bound to markers
+  char*               keytype;   // array parameter: DB2 type of the key table column
+  int                 keyattno;  // attribute number of the join key compared with the parameter, 0 if none
   struct paramDesc*   next;      // next ParamDesc element in the list
 } ParamDesc;
 #endif
\ No newline at end of file
@@ -78,18 +78,34 @@
 #define DB2_FDW_VERSION "18.1.0"
 /* number of bytes to read per LOB chunk */
 #define LOB_CHUNK_SIZE    8192
+/* room for a varlena header before the LOB values read by db2GetLob, equals VARHDRSZ */
+#define DB2_LOB_HEADER    4
+/* number of bytes sent per SQLPutData call for values streamed at execution */
+#define LOB_PUT_SIZE      65536
 #define ERRBUFSIZE        2000
 #define SUBMESSAGE_LEN    200
 #define EXPLAIN_LINE_SIZE 1000
 #define DEFAULT_MAX_LONG  32767
 #define DEFAULT_PREFETCH  200
+#define MAX_PREFETCH      10240
 #define DEFAULT_BATCHSZ   100
 #define TABLE_NAME_LEN    129
 #define COLUMN_NAME_LEN   129
 #define SQLSTATE_LEN      6
+/* constant IN lists with more elements are bound as an array parameter */
+#define MAX_INLINE_IN     16
+/* DB2 accepts at most this many parameter markers in a statement */
+#define MAX_MARKERS       32767
+/* number of keys inserted into a key table per execution of the INSERT */
+#define KEY_TABLE_CHUNK   1000
+/* cost factor of a scan sorted by DB2 over an unsorted one */
+#define DB2_SORT_MULTIPLIER 1.2
 
 #ifdef SQL_H_SQLCLI1
+#include "ParamBuf.h"
 #include "HdlEntry.h"
+#include "IndexEntry.h"
+#include "KeyTableEntry.h"
 #include "DB2ConnEntry.h"
 #include "DB2EnvEntry.h"
 #include "DB2Session.h"
@@ -101,6 +117,10 @@ typedef struct db2Session DB2Session;
 #ifndef UUIDOID
 #define UUIDOID 2950
 #endif
+/* the DB2 side needs the OID of bytea to fetch binary values as they are */
+#ifndef BYTEAOID
+#define BYTEAOID 17
+#endif
 
 typedef enum {
   NO_ENC_ERR_NULL,
@@ -108,6 +128,13 @@ typedef enum {
   NO_ENC_ERR_FALSE
 } db2NoEncErrType;
 
+/* how INSERTs use the DB2 LOAD utility, see the "load" option */
+typedef enum {
+  LOAD_OFF,
+  LOAD_INSERT,
+  LOAD_REPLACE
+} db2LoadMode;
+
 #include "DB2Column.h"
 #include "DB2Table.h"
 
@@ -150,8 +177,18 @@ typedef enum {
 #define OPT_KEY               "key"
 #define OPT_SAMPLE            "sample_percent"
 #define OPT_PREFETCH          "prefetch"
+#define OPT_FETCH_MEMORY      "fetch_memory"
+#define OPT_COLUMN_BUFFER     "column_buffer"
 #define OPT_NO_ENCODING_ERROR "no_encoding_error"
 #define OPT_BATCH_SIZE        "batch_size"
+#define OPT_RESCAN_CACHE      "rescan_cache"
+#define OPT_KEY_TABLE         "key_table_threshold"
+#define OPT_COLLATION         "collation_compatible"
+#define OPT_FUNCTION_MAP      "function_map"
+#define OPT_BIND_CONSTANTS    "bind_constants"
+#define OPT_LOAD              "load"
+#define OPT_LOAD_SAVECOUNT    "load_savecount"
+#define OPT_LOAD_MESSAGES     "load_messages"
 
 /* types for the DB2 table description */
 typedef enum {
@@ -197,7 +234,7 @@ typedef enum { CASE_KEEP, CASE_LOWER, CASE_SMART } fold_t;
 #define REL_ALIAS_PREFIX    "r"
 /* Handy macro to add relation name qualification */
 #define ADD_REL_QUALIFIER(buf, varno)  appendStringInfo((buf), "%s%d.", REL_ALIAS_PREFIX, (varno))
-#define serializeInt(x)                makeConst(INT4OID, -1, InvalidOid, 4, Int32GetDatum((int32)(x)), false, true)
-#define serializeOid(x)                makeConst(OIDOID, -1, InvalidOid, 4, ObjectIdGetDatum(x), false, true)
+/* version of the binary plan data in fdw_private, see serializePlanData */
+#define DB2_PLAN_VERSION               4
 
 #endif
\ No newline at end of file
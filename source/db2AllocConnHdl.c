@@ -162,6 +162,8 @@ DB2ConnEntry* insertconnEntry(DB2ConnEntry* start, const char* srvname, const ch
   new->pwd        = (pwd       && pwd[0]       != '\0') ? strdup(pwd)       : NULL;
   new->jwt_token  = (jwt_token && jwt_token[0] != '\0') ? strdup(jwt_token) : NULL;
   new->handlelist = NULL;
+  new->indexlist  = NULL;
+  new->keytablelist = NULL;
   new->hdbc       = hdbc;
   new->xact_level = 0;
   db2Debug2("  < insertconnEntry - returns: %x",new);
@@ -52,6 +52,13 @@ HdlEntry* db2AllocStmtHdl (SQLSMALLINT type, DB2ConnEntry* connp, db2error error
     db2Debug3("  entry->hsql: %d",entry->hsql);
     entry->type         = type;
     db2Debug3("  entry->type: %d",entry->type);
+    entry->cursor_open  = 0;
+    entry->param_cnt    = 0;
+    entry->param_buf    = NULL;
+    entry->load_mode    = 0;
+    entry->load_info    = NULL;
+    entry->load_loaded  = 0;
+    entry->load_rejected= 0;
     entry->next         = connp->handlelist;
     db2Debug3("  adding connp->handlelist: %x to entry->next: %x",connp->handlelist, entry->next);
     connp->handlelist   = entry;
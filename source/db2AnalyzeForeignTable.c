@@ -27,6 +27,8 @@ extern void         db2Debug1                 (const char* message, ...);
 extern void         db2Debug2                 (const char* message, ...);
 extern void         db2Debug3                 (const char* message, ...);
 extern void*        db2alloc                  (const char* type, size_t size);
+extern void         allocColumnBuffers        (DB2Table* db2Table, int column_buffer);
+extern unsigned int budgetPrefetch            (DB2FdwState* fdw_state);
 
 /** local prototypes */
 bool db2AnalyzeForeignTable(Relation relation, AcquireSampleRowsFunc* func, BlockNumber* totalpages);
@@ -92,14 +94,6 @@ int acquireSampleRowsFunc (Relation relation, int elevel, HeapTuple * rows, int
       fdw_state->db2Table->cols[i]->used = 1;
       db2Debug2("  fdw_state->db2Table->cols[%d]->used: %d",i,fdw_state->db2Table->cols[i]->used);
 
-      /* allocate memory for return value */
-      db2Debug2("  fdw_state->db2Table->cols[%d]->val_size: %x",i,fdw_state->db2Table->cols[i]->val_size);
-      fdw_state->db2Table->cols[i]->val = (char *) db2alloc ("fdw_state->db2Table->cols[i]->val", fdw_state->db2Table->cols[i]->val_size + 1);
-      db2Debug2("  fdw_state->db2Table->cols[%d]->val: %x",i,fdw_state->db2Table->cols[i]->val);
-      fdw_state->db2Table->cols[i]->val_len  = 0;
-      db2Debug2("  fdw_state->db2Table->cols[%d]->val_len: %x",i,fdw_state->db2Table->cols[i]->val);
-      fdw_state->db2Table->cols[i]->val_null = 1;
-      db2Debug2("  fdw_state->db2Table->cols[%d]->val_null: %x",i,fdw_state->db2Table->cols[i]->val_null);
 
       if (first_column)
         first_column = false;
@@ -115,6 +109,9 @@ int acquireSampleRowsFunc (Relation relation, int elevel, HeapTuple * rows, int
   if (first_column)
     appendStringInfo (&query, "NULL");
 
+  /* allocate memory for the return values */
+  allocColumnBuffers (fdw_state->db2Table, fdw_state->column_buffer);
+
   /* append DB2 table name */
   appendStringInfo (&query, " FROM %s", fdw_state->db2Table->name);
 
@@ -132,7 +129,7 @@ int acquireSampleRowsFunc (Relation relation, int elevel, HeapTuple * rows, int
 
   db2Debug3("  loop through query results");
   /* loop through query results */
-  while (db2IsStatementOpen (fdw_state->session) ? db2FetchNext (fdw_state->session) : (db2PrepareQuery (fdw_state->session, fdw_state->query, fdw_state->db2Table, fdw_state->prefetch), db2ExecuteQuery (fdw_state->session, fdw_state->db2Table, fdw_state->paramList))) {
+  while (db2IsStatementOpen (fdw_state->session) ? db2FetchNext (fdw_state->session) : (db2PrepareQuery (fdw_state->session, fdw_state->query, fdw_state->db2Table, budgetPrefetch (fdw_state)), db2ExecuteQuery (fdw_state->session, fdw_state->db2Table, fdw_state->paramList))) {
     /* allow user to interrupt ANALYZE */
     #if PG_VERSION_NUM >= 180000
     vacuum_delay_point (true);
@@ -23,13 +23,16 @@ extern void         db2Debug1                  (const char* message, ...);
 extern void         db2Debug2                  (const char* message, ...);
 extern void*        db2alloc                   (const char* type, size_t size);
 extern char*        c2name                     (short fcType);
+extern void         buildAttrMap               (DB2Table* db2Table);
+extern void         allocColumnBuffers         (DB2Table* db2Table, int column_buffer);
 extern void         db2BeginForeignModifyCommon(ModifyTableState* mtstate, ResultRelInfo* rinfo, DB2FdwState* fdw_state, Plan* subplan);
 
 /** local prototypes */
 void         db2BeginForeignModify(ModifyTableState* mtstate, ResultRelInfo* rinfo, List* fdw_private, int subplan_index, int eflags);
 DB2FdwState* deserializePlanData  (List* list);
-char*        deserializeString    (Const* constant);
-long         deserializeLong      (Const* constant);
+int32        unpackInt            (const char** p);
+int64        unpackLong           (const char** p);
+char*        unpackString         (const char** p);
 
 /** db2BeginForeignModify
  *   Prepare everything for the DML query:
@@ -53,16 +56,25 @@ void db2BeginForeignModify (ModifyTableState * mtstate, ResultRelInfo * rinfo, L
 }
 
 /** deserializePlanData
- *   Extract the data structures from a List created by serializePlanData.
+ *   Extract the data structures from the plan data created by serializePlanData.
+ *   The plan data are copied once, strings point into that copy,
+ *   and the column descriptors and result buffers are allocated in one
+ *   piece each.
  */
 DB2FdwState* deserializePlanData (List* list) {
   DB2FdwState* state = db2alloc ("DB2FdwState", sizeof (DB2FdwState));
-  ListCell*    cell  = list_head (list);
-  int          i, 
-               len;
+  bytea*       blob  = DatumGetByteaPCopy (((Const*) linitial (list))->constvalue);
+  const char*  p     = VARDATA (blob);
+  DB2Column*   cols;
+  int          i,
+               len,
+               version;
   ParamDesc*   param;
 
   db2Debug1("> deserializePlanData");
+  version = unpackInt (&p);
+  if (version != DB2_PLAN_VERSION)
+    elog (ERROR, "db2_fdw: plan data of version %d, expected version %d", version, DB2_PLAN_VERSION);
   /* session will be set upon connect */
   state->session      = NULL;
   /* these fields are not needed during execution */
@@ -74,164 +86,151 @@ DB2FdwState* deserializePlanData (List* list) {
   state->params       = NULL;
   state->temp_cxt     = NULL;
   state->order_clause = NULL;
+  state->rescan_store = NULL;
+  state->rescan_full  = false;
+  state->rescan_read  = false;
+  state->rescan_slot  = NULL;
+  state->lookup_cxt   = NULL;
+  state->lookup_used  = 0;
+  state->lookup_entry = NULL;
+  state->lookup_next  = NULL;
+  state->lookup_read  = false;
+  state->lookups      = 0;
+  state->full_cache   = NULL;
+  state->full_slot    = NULL;
+  state->full_match   = NULL;
 
   /* dbserver */
-  state->dbserver = deserializeString (lfirst (cell));
-  cell = list_next (list,cell);
-
+  state->dbserver      = unpackString (&p);
   /* user */
-  state->user = deserializeString (lfirst (cell));
-  cell = list_next (list,cell);
-
+  state->user          = unpackString (&p);
   /* password */
-  state->password = deserializeString (lfirst (cell));
-  cell = list_next (list,cell);
-
+  state->password      = unpackString (&p);
   /* nls_lang */
-  state->nls_lang = deserializeString (lfirst (cell));
-  cell = list_next (list,cell);
-
+  state->nls_lang      = unpackString (&p);
   /* query */
-  state->query = deserializeString (lfirst (cell));
-  cell = list_next (list,cell);
-
+  state->query         = unpackString (&p);
+  db2Debug2("  state->query: '%s'",state->query);
   /* DB2 prefetch count */
-  state->prefetch = (unsigned int) DatumGetInt32 (((Const *) lfirst (cell))->constvalue);
-  cell = list_next (list,cell);
+  state->prefetch      = (unsigned int) unpackInt (&p);
+  state->fetch_memory  = unpackInt (&p);
+  state->fetch_bytes   = 0.0;
+  state->fetch_rows    = 0;
+  state->column_buffer = unpackInt (&p);
+  /* rescan cache */
+  state->rescan_cache  = (bool) unpackInt (&p);
+  /* key table threshold */
+  state->key_table_min = unpackInt (&p);
+  /* LOAD utility */
+  state->load_mode      = (db2LoadMode) unpackInt (&p);
+  state->load_savecount = unpackInt (&p);
+  state->load_messages  = unpackString (&p);
+  /* full scan instead of lookups */
+  state->full_query    = unpackString (&p);
+  state->full_after    = unpackInt (&p);
+  len = unpackInt (&p);
+  state->full_keys = NIL;
+  for (i = 0; i < len; ++i)
+    state->full_keys = lappend_int (state->full_keys, unpackInt (&p));
 
   /* table data */
-  state->db2Table = (DB2Table*) db2alloc ("state->db2Table", sizeof (struct db2Table));
-  state->db2Table->name = deserializeString (lfirst (cell));
-  db2Debug2("  state->db2Table->name: '%s'",state->db2Table->name);
-  cell = list_next (list,cell);
-  state->db2Table->pgname = deserializeString (lfirst (cell));
-  db2Debug2("  state->db2Table->pgname: '%s'",state->db2Table->pgname);
-  cell = list_next (list,cell);
-  state->db2Table->batchsz = (int) DatumGetInt32 (((Const*) lfirst (cell))->constvalue);
-  db2Debug2("  state->db2Table->batchsz: %d",state->db2Table->batchsz);
-  cell = list_next (list,cell);
-  state->db2Table->ncols = (int) DatumGetInt32 (((Const*) lfirst (cell))->constvalue);
-  db2Debug2("  state->db2Table->ncols: %d",state->db2Table->ncols);
-  cell = list_next (list,cell);
-  state->db2Table->npgcols = (int) DatumGetInt32 (((Const*) lfirst (cell))->constvalue);
-  db2Debug2("  state->db2Table->npgcols: %d",state->db2Table->npgcols);
-  cell = list_next (list,cell);
-  state->db2Table->cols = (DB2Column**) db2alloc ("state->db2Table->cols", sizeof (DB2Column*) * state->db2Table->ncols);
+  state->db2Table          = (DB2Table*) db2alloc ("state->db2Table", sizeof (struct db2Table));
+  state->db2Table->name    = unpackString (&p);
+  state->db2Table->pgname  = unpackString (&p);
+  state->db2Table->batchsz = unpackInt (&p);
+  state->db2Table->ncols   = unpackInt (&p);
+  state->db2Table->npgcols = unpackInt (&p);
+  db2Debug2("  state->db2Table->name: '%s', ncols: %d, npgcols: %d",state->db2Table->name,state->db2Table->ncols,state->db2Table->npgcols);
+  state->db2Table->cols    = (DB2Column**) db2alloc ("state->db2Table->cols", sizeof (DB2Column*) * Max (state->db2Table->ncols, 1));
+  cols                     = (DB2Column*) db2alloc ("state->db2Table->cols[i]", sizeof (DB2Column) * Max (state->db2Table->ncols, 1));
 
   /* loop columns */
   for (i = 0; i < state->db2Table->ncols; ++i) {
-    state->db2Table->cols[i]           = (DB2Column *) db2alloc ("state->db2Table->cols[i]", sizeof (DB2Column));
-    state->db2Table->cols[i]->colName  = deserializeString (lfirst (cell));
-    db2Debug2("  state->db2Table->cols[%d]->colName: '%s'",i,state->db2Table->cols[i]->colName);
-    cell = list_next (list,cell);
-    state->db2Table->cols[i]->colType  = (short) DatumGetInt32 (((Const*) lfirst (cell))->constvalue);
-    db2Debug2("  state->db2Table->cols[%d]->colType: %d (%s)",i,state->db2Table->cols[i]->colType,c2name(state->db2Table->cols[i]->colType));
-    cell = list_next (list,cell);
-    state->db2Table->cols[i]->colSize  = (size_t) DatumGetInt32 (((Const*) lfirst (cell))->constvalue);
-    db2Debug2("  state->db2Table->cols[%d]->colSize: %lld",i,state->db2Table->cols[i]->colSize);
-    cell = list_next (list,cell);
-    state->db2Table->cols[i]->colScale = (short) DatumGetInt32 (((Const*) lfirst (cell))->constvalue);
-    db2Debug2("  state->db2Table->cols[%d]->colScale: %d",i,state->db2Table->cols[i]->colScale);
-    cell = list_next (list,cell);
-    state->db2Table->cols[i]->colNulls = (short) DatumGetInt32 (((Const*) lfirst (cell))->constvalue);
-    db2Debug2("  state->db2Table->cols[%d]->colNulls: %d",i,state->db2Table->cols[i]->colNulls);
-    cell = list_next (list,cell);
-    state->db2Table->cols[i]->colChars = (size_t) DatumGetInt32 (((Const*) lfirst (cell))->constvalue);
-    db2Debug2("  state->db2Table->cols[%lld]->colChars: %lld",i,state->db2Table->cols[i]->colChars);
-    cell = list_next (list,cell);
-    state->db2Table->cols[i]->colBytes = (size_t) DatumGetInt32 (((Const*) lfirst (cell))->constvalue);
-    db2Debug2("  state->db2Table->cols[%lld]->colBytes: %lld",i,state->db2Table->cols[i]->colBytes);
-    cell = list_next (list,cell);
-    state->db2Table->cols[i]->colPrimKeyPart = (size_t) DatumGetInt32 (((Const*) lfirst (cell))->constvalue);
-    db2Debug2("  state->db2Table->cols[%lld]->colPrimKeyPart: %lld",i,state->db2Table->cols[i]->colPrimKeyPart);
-    cell = list_next (list,cell);
-    state->db2Table->cols[i]->colCodepage = (size_t) DatumGetInt32 (((Const*) lfirst (cell))->constvalue);
-    db2Debug2("  state->db2Table->cols[%lld]->colCodepaget: %lld",i,state->db2Table->cols[i]->colCodepage);
-    cell = list_next (list,cell);
-    state->db2Table->cols[i]->pgname   = deserializeString (lfirst (cell));
-    db2Debug2("  state->db2Table->cols[%d]->pgname: '%s'",i,state->db2Table->cols[i]->pgname);
-    cell = list_next (list,cell);
-    state->db2Table->cols[i]->pgattnum = (int) DatumGetInt32 (((Const*) lfirst (cell))->constvalue);
-    db2Debug2("  state->db2Table->cols[%d]->pgattnum: %d",i,state->db2Table->cols[i]->pgattnum);
-    cell = list_next (list,cell);
-    state->db2Table->cols[i]->pgtype   = DatumGetObjectId (((Const*) lfirst (cell))->constvalue);
-    db2Debug2("  state->db2Table->cols[%d]->pgtype: %d",i,state->db2Table->cols[i]->pgtype);
-    cell = list_next (list,cell);
-    state->db2Table->cols[i]->pgtypmod = (int) DatumGetInt32 (((Const*) lfirst (cell))->constvalue);
-    db2Debug2("  state->db2Table->cols[%d]->pgtypmod: %d",i,state->db2Table->cols[i]->pgtypmod);
-    cell = list_next (list,cell);
-    state->db2Table->cols[i]->used     = (int) DatumGetInt32 (((Const*) lfirst (cell))->constvalue);
-    db2Debug2("  state->db2Table->cols[%d]->used: %d",i,state->db2Table->cols[i]->used);
-    cell = list_next (list,cell);
-    state->db2Table->cols[i]->pkey     = (int) DatumGetInt32 (((Const*) lfirst (cell))->constvalue);
-    db2Debug2("  state->db2Table->cols[%d]->pkey: %d",i,state->db2Table->cols[i]->pkey);
-    cell = list_next (list,cell);
-    state->db2Table->cols[i]->val_size = deserializeLong (lfirst (cell));
-    db2Debug2("  state->db2Table->cols[%d]->val_size: %ld",i,state->db2Table->cols[i]->val_size);
-    cell = list_next (list,cell);
-    state->db2Table->cols[i]->noencerr = deserializeLong (lfirst (cell));
-    db2Debug2("  state->db2Table->cols[%d]->noencerr: %d",i,state->db2Table->cols[i]->noencerr);
-    cell = list_next (list,cell);
-    /* allocate memory for the result value only when the column is used in query */
-    state->db2Table->cols[i]->val      = (state->db2Table->cols[i]->used == 1) ? (char*) db2alloc ("state->db2Table->cols[i]->val", state->db2Table->cols[i]->val_size + 1) : NULL;
-    db2Debug2("  state->db2Table->cols[%d]->val: %x",i,state->db2Table->cols[i]->val);
-    state->db2Table->cols[i]->val_len  = 0;
-    db2Debug2("  state->db2Table->cols[%d]->val_len: %d",i,state->db2Table->cols[i]->val_len);
-    state->db2Table->cols[i]->val_null = 1;
-    db2Debug2("  state->db2Table->cols[%d]->val_null: %d",i,state->db2Table->cols[i]->val_null);
+    DB2Column* col = &cols[i];
+
+    state->db2Table->cols[i] = col;
+    col->colName        = unpackString (&p);
+    col->colType        = (short) unpackInt (&p);
+    col->colSize        = (size_t) unpackLong (&p);
+    col->colScale       = (short) unpackInt (&p);
+    col->colNulls       = (short) unpackInt (&p);
+    col->colChars       = (size_t) unpackLong (&p);
+    col->colBytes       = (size_t) unpackLong (&p);
+    col->colPrimKeyPart = unpackInt (&p);
+    col->colCodepage    = unpackInt (&p);
+    col->pgname         = unpackString (&p);
+    col->pgattnum       = unpackInt (&p);
+    col->pgtype         = (Oid) unpackInt (&p);
+    col->pgtypmod       = unpackInt (&p);
+    col->used           = unpackInt (&p);
+    col->pkey           = unpackInt (&p);
+    col->val_size       = (size_t) unpackLong (&p);
+    col->noencerr       = (db2NoEncErrType) unpackInt (&p);
+    db2Debug2("  state->db2Table->cols[%d]: %s (%s), pgattnum: %d, used: %d, val_size: %ld",i,col->colName,c2name(col->colType),col->pgattnum,col->used,col->val_size);
   }
+  /* memory for the result values of the columns used in the query */
+  allocColumnBuffers (state->db2Table, state->column_buffer);
+  /* the map is derived from pgattnum rather than serialized */
+  buildAttrMap (state->db2Table);
 
   /* length of parameter list */
-  len  = (int) DatumGetInt32 (((Const*) lfirst (cell))->constvalue);
-  cell = list_next (list,cell);
+  len = unpackInt (&p);
 
   /* parameter table entries */
   state->paramList = NULL;
   for (i = 0; i < len; ++i) {
     param            = (ParamDesc*) db2alloc ("state->parmList->next", sizeof (ParamDesc));
-    param->type      = DatumGetObjectId (((Const *) lfirst (cell))->constvalue);
-    cell             = list_next (list,cell);
-    param->bindType  = (db2BindType) DatumGetInt32 (((Const *) lfirst (cell))->constvalue);
-    cell             = list_next (list,cell);
+    param->type      = (Oid) unpackInt (&p);
+    param->bindType  = (db2BindType) unpackInt (&p);
     if (param->bindType == BIND_OUTPUT)
       param->value   = (void *) 42;	/* something != NULL */
     else
       param->value   = NULL;
     param->node      = NULL;
-    param->colnum    = (int) DatumGetInt32 (((Const *) lfirst (cell))->constvalue);
-    cell             = list_next (list,cell);
-    param->txts      = (int) DatumGetInt32 (((Const *) lfirst (cell))->constvalue);
-    cell             = list_next (list,cell);
+    param->colnum    = unpackInt (&p);
+    param->txts      = unpackInt (&p);
     param->next      = state->paramList;
     state->paramList = param;
   }
+  Assert (p == (const char*) blob + VARSIZE (blob));
 
   db2Debug1("< deserializePlanData - returns: %x", state);
   return state;
 }
 
-/** deserializeString
- *   Extracts a string from a Const, returns a deep copy.
+/** unpackInt
+ *   Read an integer from the plan data and advance the position.
  */
-char* deserializeString (Const* constant) {
-  char* result = NULL;
-  db2Debug1("> deserializeString");
-  if (constant->constisnull)
-    result = NULL;
-  else
-    result = text_to_cstring (DatumGetTextP (constant->constvalue));
-  db2Debug1("< deserializeString: '%s'", result);
+int32 unpackInt (const char** p) {
+  int32 result;
+
+  memcpy (&result, *p, sizeof (int32));
+  *p += sizeof (int32);
+  return result;
+}
+
+/** unpackLong
+ *   Read a long integer from the plan data and advance the position.
+ */
+int64 unpackLong (const char** p) {
+  int64 result;
+
+  memcpy (&result, *p, sizeof (int64));
+  *p += sizeof (int64);
   return result;
 }
 
-/** deserializeLong
- *   Extracts a long integer from a Const.
+/** unpackString
+ *   Return the string at the position in the plan data, without copying it,
+ *   and advance the position.
  */
-long deserializeLong (Const* constant) {
-  long result = 0L;
-  db2Debug1("> deserializeLong");
-  result =  (sizeof (long) <= 4) ? (long) DatumGetInt32 (constant->constvalue)
-                                 : (long) DatumGetInt64 (constant->constvalue);
-  db2Debug1("< deserializeLong - returns: %ld", result);
+char* unpackString (const char** p) {
+  int32 len = unpackInt (p);
+  char* result;
+
+  if (len < 0)
+    return NULL;
+  result = (char*) *p;
+  *p += len + 1;
   return result;
 }
@@ -22,6 +22,7 @@ extern regproc* output_funcs;
 /** external prototypes */
 extern DB2Session*     db2GetSession             (const char* connectstring, char* user, char* password, char* jwt_token, const char* nls_lang, int curlevel);
 extern void            db2PrepareQuery           (DB2Session* session, const char* query, DB2Table* db2Table, unsigned int prefetch);
+extern void            db2BeginLoad              (DB2Session* session, const char* query, db2LoadMode mode, int savecount, const char* msgfile);
 extern void            db2Debug1                 (const char* message, ...);
 extern void*           db2alloc                  (const char* type, size_t size);
 
@@ -37,9 +38,20 @@ void db2BeginForeignModifyCommon(ModifyTableState* mtstate, ResultRelInfo* rinfo
   db2Debug1("> db2BeginForeignModifyCommon");
   rinfo->ri_FdwState = fdw_state;
 
+  /* the LOAD utility only appends rows, it cannot return them */
+  if (fdw_state->load_mode != LOAD_OFF) {
+    if (mtstate->operation != CMD_INSERT)
+      fdw_state->load_mode = LOAD_OFF;
+    for (param = fdw_state->paramList; param != NULL; param = param->next)
+      if (param->bindType == BIND_OUTPUT)
+        fdw_state->load_mode = LOAD_OFF;
+  }
+
   /* connect to DB2 database */
   fdw_state->session = db2GetSession(fdw_state->dbserver, fdw_state->user, fdw_state->password, fdw_state->jwt_token, fdw_state->nls_lang, GetCurrentTransactionNestLevel());
   db2PrepareQuery(fdw_state->session, fdw_state->query, fdw_state->db2Table,0);
+  if (fdw_state->load_mode != LOAD_OFF)
+    db2BeginLoad(fdw_state->session, fdw_state->query, fdw_state->load_mode, fdw_state->load_savecount, fdw_state->load_messages);
 
   /* get the type output functions for the parameters */
   output_funcs = (regproc*) db2alloc("output_funcs", fdw_state->db2Table->ncols * sizeof(regproc *));
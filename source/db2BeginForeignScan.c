@@ -1,6 +1,8 @@
 #include <postgres.h>
 #include <commands/explain.h>
 #include <nodes/nodeFuncs.h>
+#include <miscadmin.h>
+#include <utils/lsyscache.h>
 #if PG_VERSION_NUM < 120000
 #include <nodes/relation.h>
 #include <optimizer/var.h>
@@ -29,14 +31,20 @@ void db2BeginForeignScan(ForeignScanState* node, int eflags);
  *   DB2 table description and parameter list from the plan's
  *   "fdw_private" field.
  *   Reestablish a connection to DB2.
+ *   If the "rescan_cache" option is set and the scan is to be rewound
+ *   without parameters, prepare a tuplestore to keep the result for rescans.
+ *   If the plan allows it, a parameterized scan can later switch to fetching
+ *   the full result once, the parameters are matched with their join keys for that.
  */
 void db2BeginForeignScan(ForeignScanState* node, int eflags) {
   ForeignScan* fsplan      = (ForeignScan*) node->ss.ps.plan;
   List*        fdw_private = fsplan->fdw_private;
   List*        exec_exprs  = NULL;
   ListCell*    cell        = NULL;
-  int          index       = 0;
   ParamDesc*   paramDesc   = NULL;
+  ParamDesc*   lastDesc    = NULL;
+  bool         has_params  = false;
+  int          position    = 0;
   DB2FdwState* fdw_state   = NULL;
 
   db2Debug1("> db2BeginForeignScan");
@@ -51,54 +59,106 @@ void db2BeginForeignScan(ForeignScanState* node, int eflags) {
   exec_exprs = (List *) ExecInitExprList (fsplan->fdw_exprs, (PlanState *) node);
 #endif /* PG_VERSION_NUM */
 
-  /* create the list of parameters */
-  index = 0;
+  /*
+   * Create the list of parameters in the order of the parameter markers
+   * in the query. A NULL entry stands for the transaction timestamp.
+   */
   foreach (cell, exec_exprs) {
     ExprState* expr = (ExprState*) lfirst (cell);
 
-    /* count, but skip deleted entries */
-    ++index;
-    if (expr == NULL)
-      continue;
-
     /* create a new entry in the parameter list */
-    paramDesc       = (ParamDesc*) db2alloc("fdw_state->paramList->next", sizeof (ParamDesc));
-    paramDesc->type = exprType ((Node*) (expr->expr));
-
-    if (paramDesc->type == TEXTOID
-    ||  paramDesc->type == VARCHAROID
-    ||  paramDesc->type == BPCHAROID
-    ||  paramDesc->type == CHAROID
-    ||  paramDesc->type == DATEOID
-    ||  paramDesc->type == TIMESTAMPOID
-    ||  paramDesc->type == TIMESTAMPTZOID
-    ||  paramDesc->type == TIMEOID
-    ||  paramDesc->type == TIMETZOID)
+    paramDesc = (ParamDesc*) db2alloc("fdw_state->paramList->next", sizeof (ParamDesc));
+    if (expr == NULL) {
+      /* the fake parameter for "now" */
+      paramDesc->type     = TIMESTAMPTZOID;
       paramDesc->bindType = BIND_STRING;
-    else
-      paramDesc->bindType = BIND_NUMBER;
-
+      paramDesc->txts     = 1;
+    } else {
+      paramDesc->type     = exprType ((Node*) (expr->expr));
+      /* an array is bound element by element to the markers of an IN list */
+      if (type_is_array (paramDesc->type)) {
+        paramDesc->type     = get_element_type (paramDesc->type);
+        paramDesc->isarray  = 1;
+        paramDesc->nmarkers = 0;
+      }
+      if (paramDesc->type == TEXTOID
+      ||  paramDesc->type == VARCHAROID
+      ||  paramDesc->type == BPCHAROID
+      ||  paramDesc->type == CHAROID
+      ||  paramDesc->type == DATEOID
+      ||  paramDesc->type == TIMESTAMPOID
+      ||  paramDesc->type == TIMESTAMPTZOID
+      ||  paramDesc->type == TIMEOID
+      ||  paramDesc->type == TIMETZOID
+      ||  paramDesc->type == UUIDOID
+      ||  paramDesc->type == BYTEAOID
+      ||  paramDesc->type == INTERVALOID)
+        paramDesc->bindType = BIND_STRING;
+      else
+        paramDesc->bindType = BIND_NUMBER;
+      paramDesc->txts     = 0;
+      has_params          = true;
+    }
     paramDesc->value     = NULL;
     paramDesc->node      = expr;
     paramDesc->colnum    = -1;
-    paramDesc->txts      = 0;
-    paramDesc->next      = fdw_state->paramList;
+    paramDesc->keyattno  = (fdw_state->full_keys != NIL) ? list_nth_int (fdw_state->full_keys, position) : 0;
+    paramDesc->next      = NULL;
+    ++position;
     db2Debug2("  paramDesc->colnum: %d  ",paramDesc->colnum);
-    fdw_state->paramList = paramDesc;
+    /* append to keep the order of the markers */
+    if (lastDesc == NULL)
+      fdw_state->paramList = paramDesc;
+    else
+      lastDesc->next = paramDesc;
+    lastDesc = paramDesc;
   }
 
-  /* add a fake parameter "if that string appears in the query */
-  if (strstr (fdw_state->query, "?/*:now*/") != NULL) {
-    paramDesc            = (ParamDesc*) db2alloc ("fdw_state->paramList->next", sizeof (ParamDesc));
-    paramDesc->type      = TIMESTAMPTZOID;
-    paramDesc->bindType  = BIND_STRING;
-    paramDesc->value     = NULL;
-    paramDesc->node      = NULL;
-    paramDesc->colnum    = -1;
-    paramDesc->txts      = 1;
-    paramDesc->next      = fdw_state->paramList;
-    fdw_state->paramList = paramDesc;
+  /*
+   * Materialize the result for rescans only if the executor announced
+   * that it will rewind the scan, and the result cannot change between
+   * rescans: no parameters other than the transaction timestamp, no row locks.
+   * A parameterized scan (the inner side of a nested loop) may switch
+   * to a single scan of the full result instead (see fullLoad).
+   */
+  fdw_state->rescan_store = NULL;
+  fdw_state->rescan_full  = false;
+  fdw_state->rescan_read  = false;
+  fdw_state->rescan_slot  = NULL;
+  fdw_state->lookup_cxt   = NULL;
+  fdw_state->lookup_used  = 0;
+  fdw_state->lookup_entry = NULL;
+  fdw_state->lookup_next  = NULL;
+  fdw_state->lookup_read  = false;
+  fdw_state->lookups      = 0;
+  fdw_state->full_cache   = NULL;
+  fdw_state->full_slot    = NULL;
+  fdw_state->full_match   = NULL;
+  if (fdw_state->rescan_cache
+  && !(eflags & EXEC_FLAG_EXPLAIN_ONLY)
+  &&  strstr (fdw_state->query, " FOR UPDATE") == NULL) {
+    if (!has_params && (eflags & EXEC_FLAG_REWIND)) {
+      fdw_state->rescan_store = tuplestore_begin_heap (false, false, work_mem);
+#if PG_VERSION_NUM >= 120000
+      /* the scan slot holds heap tuples, the tuplestore returns minimal tuples */
+      fdw_state->rescan_slot  = MakeSingleTupleTableSlot (node->ss.ss_ScanTupleSlot->tts_tupleDescriptor, &TTSOpsMinimalTuple);
+#endif /* PG_VERSION_NUM */
+      db2Debug2("  result will be materialized for rescans, work_mem: %d kB", work_mem);
+    } else if (has_params && fdw_state->full_query != NULL && node->ss.ss_currentRelation != NULL) {
+      fdw_state->lookup_cxt   = AllocSetContextCreate (node->ss.ps.state->es_query_cxt, "db2_fdw full scan cache", ALLOCSET_DEFAULT_MINSIZE, ALLOCSET_DEFAULT_INITSIZE, ALLOCSET_DEFAULT_MAXSIZE);
+      /* the rows of the full result are compared as minimal tuples */
+#if PG_VERSION_NUM < 120000
+      fdw_state->full_slot  = MakeSingleTupleTableSlot (node->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
+#else
+      fdw_state->full_slot  = MakeSingleTupleTableSlot (node->ss.ss_ScanTupleSlot->tts_tupleDescriptor, &TTSOpsMinimalTuple);
+#endif /* PG_VERSION_NUM */
+      fdw_state->full_match = (LookupEntry*) db2alloc ("fdw_state->full_match", sizeof (LookupEntry));
+      db2Debug2("  full scan after %d lookups", fdw_state->full_after);
+    }
   }
+  /* without the memory for the full result there is no switch to it */
+  if (fdw_state->full_slot == NULL)
+    fdw_state->full_query = NULL;
 
   if (node->ss.ss_currentRelation)
     elog (DEBUG3, "  begin foreign table scan on relid: %d", RelationGetRelid (node->ss.ss_currentRelation));
@@ -0,0 +1,113 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sqlcli1.h>
+#include <db2ApiDf.h>
+#include <postgres_ext.h>
+#include "db2_fdw.h"
+
+/** global variables */
+
+/** external variables */
+extern char         db2Message[ERRBUFSIZE];/* contains DB2 error messages, set by db2CheckErr()             */
+
+/** external prototypes */
+extern void         db2Debug1            (const char* message, ...);
+extern void         db2Debug2            (const char* message, ...);
+extern SQLRETURN    db2CheckErr          (SQLRETURN status, SQLHANDLE handle, SQLSMALLINT handleType, int line, char* file);
+extern void         db2Error_d           (db2error sqlstate, const char* message, const char* detail, ...);
+
+/** internal prototypes */
+void                db2BeginLoad         (DB2Session* session, const char* query, db2LoadMode mode, int savecount, const char* msgfile);
+
+/** LoadInfo
+ *   The description of a LOAD handed to DB2 CLI with SQL_ATTR_LOAD_INFO,
+ *   allocated in one piece so that db2FreeStmtHdl can release it.
+ */
+typedef struct loadInfo {
+  struct db2LoadStruct load;          // the structure SQL_ATTR_LOAD_INFO points to
+  struct db2LoadIn     in;            // input parameters, savecount
+  struct db2LoadOut    out;           // row counts filled in by the utility
+  char                 msgfile[1];    // name of the message file, allocated to size
+} LoadInfo;
+
+/** db2BeginLoad
+ *   Switch the prepared INSERT statement "query" of the session to the DB2 LOAD
+ *   utility, appending ("mode" LOAD_INSERT) or replacing (LOAD_REPLACE) the rows
+ *   of the table. The utility commits every "savecount" rows if that is not 0
+ *   and writes its messages to "msgfile" if that is not NULL.
+ *   CLI expects the LOAD attributes before the statement is prepared, so it is
+ *   prepared again. The LOAD ends with db2EndLoad.
+ */
+void db2BeginLoad (DB2Session* session, const char* query, db2LoadMode mode, int savecount, const char* msgfile) {
+  HdlEntry*   stmtp = session->stmtp;
+  LoadInfo*   info  = NULL;
+  SQLRETURN   rc    = 0;
+
+  db2Debug1("> db2BeginLoad");
+  db2Debug2("  mode: %d, savecount: %d, msgfile: '%s'", mode, savecount, (msgfile == NULL) ? "" : msgfile);
+  if (stmtp == NULL || stmtp->load_mode != 0) {
+    db2Debug1("< db2BeginLoad - no statement or LOAD already running");
+    return;
+  }
+
+  /* the defaults of CLI apply unless a commit interval or a message file is given */
+  if (savecount > 0 || msgfile != NULL) {
+    size_t len = (msgfile == NULL) ? 0 : strlen (msgfile);
+
+    if ((info = malloc (sizeof (LoadInfo) + len)) == NULL) {
+      db2Error_d (FDW_OUT_OF_MEMORY, "error starting load:", " failed to allocate %d bytes of memory", sizeof (LoadInfo) + len);
+    }
+    memset (info, 0, sizeof (LoadInfo));
+    info->in.iSavecount        = (db2Uint32) savecount;
+    info->in.iIndexingMode     = SQLU_INX_AUTOSELECT;
+    info->in.iAccessLevel      = SQLU_ALLOW_NO_ACCESS;
+    info->in.iRestartphase     = ' ';
+    info->in.iStatsOpt         = SQLU_STATS_NONE;
+    info->in.iCheckPending     = SQLU_CHECK_PENDING_CASCADE_DEFERRED;
+    info->load.piLoadInfoIn    = &info->in;
+    info->load.poLoadInfoOut   = &info->out;
+    if (msgfile != NULL) {
+      strcpy (info->msgfile, msgfile);
+      info->load.piLocalMsgFileName = info->msgfile;
+    }
+    stmtp->load_info = info;
+    rc = SQLSetStmtAttr (stmtp->hsql, SQL_ATTR_LOAD_INFO, (SQLPOINTER) &info->load, 0);
+    rc = db2CheckErr (rc, stmtp->hsql, stmtp->type, __LINE__, __FILE__);
+    if (rc != SQL_SUCCESS) {
+      db2Error_d (FDW_UNABLE_TO_CREATE_EXECUTION, "error starting load: SQLSetStmtAttr failed to set load information", db2Message);
+    }
+  }
+
+  /* where the utility reports the rows loaded and rejected */
+  rc = SQLSetStmtAttr (stmtp->hsql, SQL_ATTR_LOAD_ROWS_LOADED_PTR, (SQLPOINTER) &stmtp->load_loaded, 0);
+  rc = db2CheckErr (rc, stmtp->hsql, stmtp->type, __LINE__, __FILE__);
+  if (rc == SQL_SUCCESS) {
+    rc = SQLSetStmtAttr (stmtp->hsql, SQL_ATTR_LOAD_ROWS_REJECTED_PTR, (SQLPOINTER) &stmtp->load_rejected, 0);
+    rc = db2CheckErr (rc, stmtp->hsql, stmtp->type, __LINE__, __FILE__);
+  }
+  if (rc != SQL_SUCCESS) {
+    db2Error_d (FDW_UNABLE_TO_CREATE_EXECUTION, "error starting load: SQLSetStmtAttr failed to set row count pointers", db2Message);
+  }
+
+  stmtp->load_mode = (mode == LOAD_REPLACE) ? SQL_USE_LOAD_REPLACE : SQL_USE_LOAD_INSERT;
+  rc = SQLSetStmtAttr (stmtp->hsql, SQL_ATTR_USE_LOAD_API, (SQLPOINTER) (SQLLEN) stmtp->load_mode, 0);
+  rc = db2CheckErr (rc, stmtp->hsql, stmtp->type, __LINE__, __FILE__);
+  if (rc != SQL_SUCCESS) {
+    stmtp->load_mode = 0;
+    db2Error_d (FDW_UNABLE_TO_CREATE_EXECUTION, "error starting load: SQLSetStmtAttr failed to enable the LOAD utility", db2Message);
+  }
+
+  rc = SQLPrepare (stmtp->hsql, (SQLCHAR*) query, SQL_NTS);
+  rc = db2CheckErr (rc, stmtp->hsql, stmtp->type, __LINE__, __FILE__);
+  if (rc != SQL_SUCCESS) {
+    db2Error_d (FDW_UNABLE_TO_CREATE_EXECUTION, "error starting load: SQLPrepare failed to prepare insert", db2Message);
+  }
+
+  /* the rows are bound column-wise in arrays by db2LoadRows */
+  rc = SQLSetStmtAttr (stmtp->hsql, SQL_ATTR_PARAM_BIND_TYPE, (SQLPOINTER) SQL_PARAM_BIND_BY_COLUMN, 0);
+  rc = db2CheckErr (rc, stmtp->hsql, stmtp->type, __LINE__, __FILE__);
+  if (rc != SQL_SUCCESS) {
+    db2Error_d (FDW_UNABLE_TO_CREATE_EXECUTION, "error starting load: SQLSetStmtAttr failed to set column-wise binding", db2Message);
+  }
+  db2Debug1("< db2BeginLoad");
+}
@@ -112,6 +112,26 @@ int deleteconnEntry(DB2ConnEntry* start, DB2ConnEntry* node) {
       if (step->uid)       free (step->uid);
       if (step->pwd)       free (step->pwd);
       if (step->jwt_token) free (step->jwt_token);
+      while (step->indexlist != NULL) {
+        IndexEntry* next = step->indexlist->next;
+        int         i;
+
+        for (i = 0; i < step->indexlist->ncols; ++i)
+          free (step->indexlist->colName[i]);
+        free (step->indexlist->colName);
+        free (step->indexlist->indexed);
+        free (step->indexlist->schema);
+        free (step->indexlist->table);
+        free (step->indexlist);
+        step->indexlist = next;
+      }
+      while (step->keytablelist != NULL) {
+        KeyTableEntry* next = step->keytablelist->next;
+
+        free (step->keytablelist->tabname);
+        free (step->keytablelist);
+        step->keytablelist = next;
+      }
       if (step) {
         db2Debug1("  DB2ConnEntry freed: %x", step);
         free (step);
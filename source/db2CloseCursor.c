@@ -0,0 +1,38 @@
+#include <sqlcli1.h>
+#include <postgres_ext.h>
+#include "db2_fdw.h"
+
+/** global variables */
+
+/** external variables */
+extern char         db2Message[ERRBUFSIZE];/* contains DB2 error messages, set by db2CheckErr()             */
+
+/** external prototypes */
+extern void      db2Debug1            (const char* message, ...);
+extern void      db2Debug3            (const char* message, ...);
+extern void      db2Error_d           (db2error sqlstate, const char* message, const char* detail, ...);
+extern SQLRETURN db2CheckErr          (SQLRETURN status, SQLHANDLE handle, SQLSMALLINT handleType, int line, char* file);
+
+/** local prototypes */
+void             db2CloseCursor       (DB2Session* session);
+
+/** db2CloseCursor
+ *   Close the result set of the statement associated with the session.
+ *   The statement handle stays prepared and keeps its column and
+ *   parameter bindings, so it can be executed again right away.
+ */
+void db2CloseCursor (DB2Session* session) {
+  SQLRETURN rc = 0;
+  db2Debug1("> db2CloseCursor");
+  if (session->stmtp != NULL && session->stmtp->cursor_open) {
+    rc = SQLFreeStmt (session->stmtp->hsql, SQL_CLOSE);
+    rc = db2CheckErr(rc, session->stmtp->hsql, session->stmtp->type, __LINE__, __FILE__);
+    if (rc != SQL_SUCCESS) {
+      db2Error_d (FDW_UNABLE_TO_CREATE_EXECUTION, "error closing cursor: SQLFreeStmt failed to close cursor", db2Message);
+    }
+    session->stmtp->cursor_open = 0;
+  } else {
+    db2Debug3("  no cursor to close");
+  }
+  db2Debug1("< db2CloseCursor");
+}
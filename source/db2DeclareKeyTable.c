@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sqlcli1.h>
+#include <postgres_ext.h>
+#include "db2_fdw.h"
+
+/** global variables */
+
+/** external variables */
+extern char         db2Message[ERRBUFSIZE];/* contains DB2 error messages, set by db2CheckErr()             */
+
+/** external prototypes */
+extern void         db2Debug1            (const char* message, ...);
+extern void         db2Debug2            (const char* message, ...);
+extern SQLRETURN    db2CheckErr          (SQLRETURN status, SQLHANDLE handle, SQLSMALLINT handleType, int line, char* file);
+extern void         db2Error_d           (db2error sqlstate, const char* message, const char* detail, ...);
+extern HdlEntry*    db2AllocStmtHdl      (SQLSMALLINT type, DB2ConnEntry* connp, db2error error, const char* errmsg);
+extern void         db2FreeStmtHdl       (HdlEntry* handlep, DB2ConnEntry* connp);
+
+/** internal prototypes */
+void                db2DeclareKeyTable   (DB2Session* session, const char* tabname, const char* keytype);
+
+/** db2DeclareKeyTable
+ *   Declare the global temporary table "tabname" with the single column K
+ *   of type "keytype", replacing a table of the same name.
+ *   The table is not logged, its rows are deleted on rollback.
+ *   This needs a user temporary tablespace in the DB2 database.
+ *   The table is remembered at the connection until db2DropKeyTable drops it,
+ *   or db2EndTransaction if the scan did not get that far.
+ */
+void db2DeclareKeyTable (DB2Session* session, const char* tabname, const char* keytype) {
+  HdlEntry* stmtp = NULL;
+  SQLRETURN rc    = 0;
+  char      stmt[256];
+  KeyTableEntry* entry = NULL;
+
+  db2Debug1("> db2DeclareKeyTable");
+  snprintf (stmt, sizeof (stmt), "DECLARE GLOBAL TEMPORARY TABLE %s (K %s) WITH REPLACE ON COMMIT PRESERVE ROWS NOT LOGGED ON ROLLBACK DELETE ROWS", tabname, keytype);
+  db2Debug2("  stmt: '%s'", stmt);
+  stmtp = db2AllocStmtHdl (SQL_HANDLE_STMT, session->connp, FDW_UNABLE_TO_CREATE_EXECUTION, "error declaring key table: failed to allocate statement handle");
+  rc = SQLExecDirect (stmtp->hsql, (SQLCHAR*) stmt, SQL_NTS);
+  rc = db2CheckErr (rc, stmtp->hsql, stmtp->type, __LINE__, __FILE__);
+  db2FreeStmtHdl (stmtp, session->connp);
+  if (rc != SQL_SUCCESS) {
+    db2Error_d (FDW_UNABLE_TO_CREATE_EXECUTION, "error declaring key table: SQLExecDirect failed to declare temporary table", db2Message);
+  }
+  for (entry = session->connp->keytablelist; entry != NULL; entry = entry->next)
+    if (strcmp (entry->tabname, tabname) == 0)
+      break;
+  if (entry == NULL) {
+    if ((entry = malloc (sizeof (KeyTableEntry))) == NULL) {
+      db2Error_d (FDW_OUT_OF_MEMORY, "error declaring key table:", " failed to allocate %d bytes of memory", sizeof (KeyTableEntry));
+    }
+    if ((entry->tabname = strdup (tabname)) == NULL) {
+      free (entry);
+      db2Error_d (FDW_OUT_OF_MEMORY, "error declaring key table:", " failed to allocate %d bytes of memory", strlen (tabname) + 1);
+    }
+    entry->next = session->connp->keytablelist;
+    session->connp->keytablelist = entry;
+  }
+  db2Debug1("< db2DeclareKeyTable");
+}
@@ -23,6 +23,7 @@ extern char*        db2CopyText          (const char* string, int size, int quot
 extern char*        c2name               (short fcType);
 extern HdlEntry*    db2AllocStmtHdl      (SQLSMALLINT type, DB2ConnEntry* connp, db2error error, const char* errmsg);
 extern void         db2FreeStmtHdl       (HdlEntry* handlep, DB2ConnEntry* connp);
+extern void         db2DescribeIndexes   (DB2Session* session, char* schema, char* table, DB2Table* db2Table);
 
 /** internal prototypes */
 DB2Table*           db2Describe          (DB2Session* session, char* schema, char* table, char* pgname, long max_long, char* noencerr, char* batchsz);
@@ -130,6 +131,7 @@ DB2Table* db2Describe (DB2Session* session, char* schema, char* table, char* pgn
     reply->cols[i - 1]                 = (DB2Column *) db2alloc (" reply->cols[i - 1]", sizeof (DB2Column));
     reply->cols[i - 1]->colPrimKeyPart = 0;
     reply->cols[i -1 ]->colCodepage    = 0;
+    reply->cols[i - 1]->colIndexed     = 0;
     reply->cols[i - 1]->pgname         = NULL;
     reply->cols[i - 1]->pgattnum       = 0;
     reply->cols[i - 1]->pgtype         = 0;
@@ -278,6 +280,9 @@ DB2Table* db2Describe (DB2Session* session, char* schema, char* table, char* pgn
   }
   /* release statement handle, this takes care of the parameter handles */
   db2FreeStmtHdl(stmthp, session->connp);
+
+  /* find the columns that can be used for index lookups */
+  db2DescribeIndexes (session, schema, table, reply);
   db2Debug1("< db2Describe - returns: %x", reply);
   return reply;
 }
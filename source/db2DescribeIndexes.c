@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sqlcli1.h>
+#include <postgres_ext.h>
+#include "db2_fdw.h"
+
+/** global variables */
+
+/** external variables */
+extern char         db2Message[ERRBUFSIZE];/* contains DB2 error messages, set by db2CheckErr()             */
+
+/** external prototypes */
+extern void         db2free              (void* p);
+extern void         db2Debug1            (const char* message, ...);
+extern void         db2Debug2            (const char* message, ...);
+extern SQLRETURN    db2CheckErr          (SQLRETURN status, SQLHANDLE handle, SQLSMALLINT handleType, int line, char* file);
+extern char*        db2CopyText          (const char* string, int size, int quote);
+extern HdlEntry*    db2AllocStmtHdl      (SQLSMALLINT type, DB2ConnEntry* connp, db2error error, const char* errmsg);
+extern void         db2FreeStmtHdl       (HdlEntry* handlep, DB2ConnEntry* connp);
+extern void         db2Error_d           (db2error sqlstate, const char* message, const char* detail, ...);
+
+/** internal prototypes */
+void                db2DescribeIndexes   (DB2Session* session, char* schema, char* table, DB2Table* db2Table);
+IndexEntry*         readIndexes          (DB2Session* session, char* schema, char* table);
+void                addIndexColumn       (IndexEntry* entry, const char* colName, int indexed);
+
+/** db2DescribeIndexes
+ *   Mark the columns of "db2Table" that lead a DB2 index.
+ *   colIndexed is set to 1 for the first column of an index and to 2
+ *   for the only column of a unique index, which a lookup by equality
+ *   finds at most one row for.
+ *   The index columns are read once per table and connection and then
+ *   taken from the connection's indexlist.
+ *   The information is only used to cost parameterized scans, so a
+ *   table that is defined as a query or whose indexes cannot be read
+ *   is silently left without index information.
+ */
+void db2DescribeIndexes (DB2Session* session, char* schema, char* table, DB2Table* db2Table) {
+  IndexEntry* entry;
+  int         i, j;
+
+  db2Debug1("> db2DescribeIndexes");
+  /* a query cannot have indexes */
+  if (table == NULL || table[0] == '(') {
+    db2Debug1("< db2DescribeIndexes - no table");
+    return;
+  }
+  for (entry = session->connp->indexlist; entry != NULL; entry = entry->next) {
+    if (strcmp (entry->table, table) == 0
+    &&  ((schema == NULL && entry->schema == NULL) || (schema != NULL && entry->schema != NULL && strcmp (entry->schema, schema) == 0)))
+      break;
+  }
+  if (entry == NULL) {
+    entry = readIndexes (session, schema, table);
+    if (entry == NULL) {
+      db2Debug1("< db2DescribeIndexes");
+      return;
+    }
+    entry->next = session->connp->indexlist;
+    session->connp->indexlist = entry;
+  } else {
+    db2Debug2("  index columns of %s taken from the cache", table);
+  }
+  for (j = 0; j < entry->ncols; ++j) {
+    for (i = 0; i < db2Table->ncols; ++i) {
+      if (strcmp (db2Table->cols[i]->colName, entry->colName[j]) == 0) {
+        if (entry->indexed[j] > db2Table->cols[i]->colIndexed)
+          db2Table->cols[i]->colIndexed = entry->indexed[j];
+        db2Debug2("  db2Table->cols[%d]->colIndexed: %d", i, db2Table->cols[i]->colIndexed);
+        break;
+      }
+    }
+  }
+  db2Debug1("< db2DescribeIndexes");
+}
+
+/** readIndexes
+ *   Read the columns leading an index of "table" with SQLStatistics.
+ *   The result is ordered by index and column position, so a unique index
+ *   has a single column if no second column of the same index follows.
+ *   Returns a new IndexEntry or NULL if the indexes cannot be read.
+ */
+IndexEntry* readIndexes (DB2Session* session, char* schema, char* table) {
+  HdlEntry*   stmthp;
+  IndexEntry* entry;
+  SQLRETURN   rc         = 0;
+  SQLSMALLINT non_unique = 0;
+  SQLSMALLINT position   = 0;
+  SQLCHAR     colName[129];
+  SQLCHAR     idxName[129];
+  SQLCHAR     lastIdx[129] = "";
+  SQLLEN      ind_unique = 0;
+  SQLLEN      ind_pos    = 0;
+  SQLLEN      ind_name   = 0;
+  SQLLEN      ind_idx    = 0;
+  char*       pending    = NULL;   /* leading column of the last index, not yet added */
+  int         pending_ix = 0;
+
+  db2Debug1("> readIndexes");
+  stmthp = db2AllocStmtHdl(SQL_HANDLE_STMT, session->connp, FDW_UNABLE_TO_CREATE_REPLY, "error describing remote table: failed to allocate statement handle");
+  rc = SQLStatistics ( stmthp->hsql
+                     , NULL, 0
+                     , (SQLCHAR*) schema, (schema == NULL) ? 0 : SQL_NTS
+                     , (SQLCHAR*) table, SQL_NTS
+                     , SQL_INDEX_ALL
+                     , SQL_QUICK
+                     );
+  rc = db2CheckErr(rc, stmthp->hsql, stmthp->type, __LINE__, __FILE__);
+  if (rc != SQL_SUCCESS) {
+    db2Debug2("  SQLStatistics failed, no index information: %s", db2Message);
+    db2FreeStmtHdl(stmthp, session->connp);
+    db2Debug1("< readIndexes - returns: NULL");
+    return NULL;
+  }
+  entry = malloc (sizeof (IndexEntry));
+  if (entry == NULL) {
+    db2Error_d (FDW_OUT_OF_MEMORY, "error describing remote table:", " failed to allocate %d bytes of memory", sizeof (IndexEntry));
+  }
+  entry->schema  = (schema == NULL) ? NULL : strdup (schema);
+  entry->table   = strdup (table);
+  entry->ncols   = 0;
+  entry->colName = NULL;
+  entry->indexed = NULL;
+  entry->next    = NULL;
+  /* NON_UNIQUE, INDEX_NAME, ORDINAL_POSITION and COLUMN_NAME of the result set */
+  SQLBindCol (stmthp->hsql, 4, SQL_C_SSHORT, &non_unique, 0, &ind_unique);
+  SQLBindCol (stmthp->hsql, 6, SQL_C_CHAR, idxName, sizeof (idxName), &ind_idx);
+  SQLBindCol (stmthp->hsql, 8, SQL_C_SSHORT, &position, 0, &ind_pos);
+  SQLBindCol (stmthp->hsql, 9, SQL_C_CHAR, colName, sizeof (colName), &ind_name);
+  while ((rc = SQLFetch (stmthp->hsql)) == SQL_SUCCESS || rc == SQL_SUCCESS_WITH_INFO) {
+    /* table statistics rows carry no column */
+    if (ind_name == SQL_NULL_DATA || ind_pos == SQL_NULL_DATA || ind_idx == SQL_NULL_DATA)
+      continue;
+    /* a second column makes the index unique only in combination */
+    if (position != 1) {
+      if (pending != NULL && strcmp ((char*) idxName, (char*) lastIdx) == 0)
+        pending_ix = 1;
+      continue;
+    }
+    if (pending != NULL) {
+      addIndexColumn (entry, pending, pending_ix);
+      db2free (pending);
+    }
+    /* column names in db2Table are quoted */
+    pending    = db2CopyText ((char*) colName, strlen ((char*) colName), 1);
+    pending_ix = (ind_unique != SQL_NULL_DATA && non_unique == SQL_FALSE) ? 2 : 1;
+    strcpy ((char*) lastIdx, (char*) idxName);
+  }
+  if (pending != NULL) {
+    addIndexColumn (entry, pending, pending_ix);
+    db2free (pending);
+  }
+  db2FreeStmtHdl(stmthp, session->connp);
+  db2Debug1("< readIndexes - returns: %d columns", entry->ncols);
+  return entry;
+}
+
+/** addIndexColumn
+ *   Add column "colName" to "entry", or raise its "indexed" level
+ *   if it leads another index already.
+ */
+void addIndexColumn (IndexEntry* entry, const char* colName, int indexed) {
+  int i;
+
+  for (i = 0; i < entry->ncols; ++i) {
+    if (strcmp (entry->colName[i], colName) == 0) {
+      if (indexed > entry->indexed[i])
+        entry->indexed[i] = indexed;
+      return;
+    }
+  }
+  entry->colName = realloc (entry->colName, (entry->ncols + 1) * sizeof (char*));
+  entry->indexed = realloc (entry->indexed, (entry->ncols + 1) * sizeof (int));
+  if (entry->colName == NULL || entry->indexed == NULL) {
+    db2Error_d (FDW_OUT_OF_MEMORY, "error describing remote table:", " failed to allocate memory for %d index columns", entry->ncols + 1);
+  }
+  entry->colName[entry->ncols] = strdup (colName);
+  entry->indexed[entry->ncols] = indexed;
+  ++entry->ncols;
+}
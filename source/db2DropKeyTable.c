@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sqlcli1.h>
+#include <postgres_ext.h>
+#include "db2_fdw.h"
+
+/** global variables */
+
+/** external variables */
+
+/** external prototypes */
+extern void         db2Debug1            (const char* message, ...);
+extern void         db2Debug2            (const char* message, ...);
+extern SQLRETURN    db2CheckErr          (SQLRETURN status, SQLHANDLE handle, SQLSMALLINT handleType, int line, char* file);
+extern HdlEntry*    db2AllocStmtHdl      (SQLSMALLINT type, DB2ConnEntry* connp, db2error error, const char* errmsg);
+extern void         db2FreeStmtHdl       (HdlEntry* handlep, DB2ConnEntry* connp);
+
+/** internal prototypes */
+void                db2DropKeyTable      (DB2Session* session, const char* tabname);
+
+/** db2DropKeyTable
+ *   Drop the key table "tabname" declared by db2DeclareKeyTable.
+ *   Errors are ignored, the table is gone with the DB2 session anyway.
+ */
+void db2DropKeyTable (DB2Session* session, const char* tabname) {
+  HdlEntry* stmtp = NULL;
+  SQLRETURN rc    = 0;
+  char      stmt[256];
+  KeyTableEntry** entry = NULL;
+
+  db2Debug1("> db2DropKeyTable");
+  snprintf (stmt, sizeof (stmt), "DROP TABLE %s", tabname);
+  db2Debug2("  stmt: '%s'", stmt);
+  stmtp = db2AllocStmtHdl (SQL_HANDLE_STMT, session->connp, FDW_UNABLE_TO_CREATE_EXECUTION, "error dropping key table: failed to allocate statement handle");
+  rc = SQLExecDirect (stmtp->hsql, (SQLCHAR*) stmt, SQL_NTS);
+  rc = db2CheckErr (rc, stmtp->hsql, stmtp->type, __LINE__, __FILE__);
+  if (rc != SQL_SUCCESS) {
+    db2Debug2("  key table could not be dropped: %d", rc);
+  }
+  db2FreeStmtHdl (stmtp, session->connp);
+  /* the table need not be dropped at the end of the transaction any more */
+  for (entry = &session->connp->keytablelist; *entry != NULL; entry = &(*entry)->next) {
+    if (strcmp ((*entry)->tabname, tabname) == 0) {
+      KeyTableEntry* next = (*entry)->next;
+
+      free ((*entry)->tabname);
+      free (*entry);
+      *entry = next;
+      break;
+    }
+  }
+  db2Debug1("< db2DropKeyTable");
+}
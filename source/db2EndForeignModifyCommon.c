@@ -17,6 +17,7 @@ extern regproc* output_funcs;
 
 /** external prototypes */
 extern void         db2CloseStatement    (DB2Session* session);
+extern int          db2EndLoad           (DB2Session* session, long* loaded, long* rejected);
 extern void         db2free              (void* p);
 extern void         db2Debug1            (const char* message, ...);
 extern void         db2Debug2            (const char* message, ...);
@@ -36,9 +37,22 @@ void db2EndForeignModifyCommon(EState *estate, ResultRelInfo *rinfo) {
     return;
   }
 
-  /* If you’re batching for COPY, flush any remaining rows here */
-  if (fdw_state->session && fdw_state->db2Table) {
-        /* e.g. db2FlushBatch(fdw_state->session, fdw_state->db2Table); */
+  /* finish a running LOAD, this commits the loaded rows */
+  if (fdw_state->session && fdw_state->load_mode != LOAD_OFF) {
+    long loaded   = 0;
+    long rejected = 0;
+
+    if (db2EndLoad (fdw_state->session, &loaded, &rejected)) {
+      if (rejected > 0)
+        ereport ( WARNING
+                , ( errmsg ("DB2 LOAD into table %s rejected %ld rows", fdw_state->db2Table->name, rejected)
+                  , errdetail ("%ld rows were loaded.", loaded)
+                  , fdw_state->load_messages ? errhint ("The reasons are in the message file \"%s\".", fdw_state->load_messages) : 0
+                  )
+                );
+      else
+        elog (DEBUG1, "db2_fdw: DB2 LOAD into table %s loaded %ld rows", fdw_state->db2Table->name, loaded);
+    }
   }
 
   /* Finish statement / cursor, if you keep a handle there */
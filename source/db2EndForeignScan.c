@@ -14,6 +14,7 @@
 
 /** external prototypes */
 extern void            db2CloseStatement         (DB2Session* session);
+extern void            db2DropKeyTable           (DB2Session* session, const char* tabname);
 extern void            db2free                   (void* p);
 extern void            db2Debug1                 (const char* message, ...);
 
@@ -25,8 +26,32 @@ void db2EndForeignScan(ForeignScanState* node);
  */
 void db2EndForeignScan (ForeignScanState* node) {
   DB2FdwState* fdw_state = (DB2FdwState*) node->fdw_state;
+  ParamDesc*   param;
 
   db2Debug1("> db2EndForeignScan");
+  /* release the materialized result */
+  if (fdw_state->rescan_store != NULL) {
+    tuplestore_end (fdw_state->rescan_store);
+    fdw_state->rescan_store = NULL;
+  }
+  if (fdw_state->rescan_slot != NULL) {
+    ExecDropSingleTupleTableSlot (fdw_state->rescan_slot);
+    fdw_state->rescan_slot = NULL;
+  }
+  if (fdw_state->full_slot != NULL) {
+    ExecDropSingleTupleTableSlot (fdw_state->full_slot);
+    fdw_state->full_slot = NULL;
+  }
+  /* release the full result together with its rows */
+  if (fdw_state->lookup_cxt != NULL) {
+    MemoryContextDelete (fdw_state->lookup_cxt);
+    fdw_state->lookup_cxt   = NULL;
+    fdw_state->full_cache   = NULL;
+  }
+  /* drop the key tables of array parameters */
+  for (param = fdw_state->paramList; param; param = param->next)
+    if (param->keytable != NULL)
+      db2DropKeyTable (fdw_state->session, param->keytable);
   /* release the DB2 session */
   db2CloseStatement(fdw_state->session);
   // check fdw_state->session for dangling references that need to be freed
@@ -0,0 +1,51 @@
+#include <stdlib.h>
+#include <sqlcli1.h>
+#include <postgres_ext.h>
+#include "db2_fdw.h"
+
+/** global variables */
+
+/** external variables */
+extern char         db2Message[ERRBUFSIZE];/* contains DB2 error messages, set by db2CheckErr()             */
+
+/** external prototypes */
+extern void         db2Debug1            (const char* message, ...);
+extern void         db2Debug2            (const char* message, ...);
+extern SQLRETURN    db2CheckErr          (SQLRETURN status, SQLHANDLE handle, SQLSMALLINT handleType, int line, char* file);
+extern void         db2Error_d           (db2error sqlstate, const char* message, const char* detail, ...);
+
+/** internal prototypes */
+int                 db2EndLoad           (DB2Session* session, long* loaded, long* rejected);
+
+/** db2EndLoad
+ *   Finish the LOAD started with db2BeginLoad, which commits the loaded rows.
+ *   Stores the numbers of rows loaded and rejected in "loaded" and "rejected".
+ *   Returns 0 if no LOAD was running, 1 otherwise.
+ */
+int db2EndLoad (DB2Session* session, long* loaded, long* rejected) {
+  HdlEntry*   stmtp = session->stmtp;
+  SQLRETURN   rc    = 0;
+
+  db2Debug1("> db2EndLoad");
+  *loaded   = 0;
+  *rejected = 0;
+  if (stmtp == NULL || stmtp->load_mode == 0) {
+    db2Debug1("< db2EndLoad - returns: 0");
+    return 0;
+  }
+  stmtp->load_mode = 0;
+  rc = SQLSetStmtAttr (stmtp->hsql, SQL_ATTR_USE_LOAD_API, (SQLPOINTER) SQL_USE_LOAD_OFF, 0);
+  rc = db2CheckErr (rc, stmtp->hsql, stmtp->type, __LINE__, __FILE__);
+  if (rc != SQL_SUCCESS) {
+    db2Error_d (FDW_UNABLE_TO_CREATE_EXECUTION, "error ending load: SQLSetStmtAttr failed to finish the LOAD utility", db2Message);
+  }
+  *loaded   = (long) stmtp->load_loaded;
+  *rejected = (long) stmtp->load_rejected;
+  db2Debug2("  rows loaded: %ld, rejected: %ld", *loaded, *rejected);
+  if (stmtp->load_info != NULL) {
+    free (stmtp->load_info);
+    stmtp->load_info = NULL;
+  }
+  db2Debug1("< db2EndLoad - returns: 1");
+  return 1;
+}
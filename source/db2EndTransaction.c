@@ -1,3 +1,5 @@
+#include <stdio.h>
+#include <stdlib.h>
 #include <sqlcli1.h>
 #include <postgres_ext.h>
 #include "db2_fdw.h"
@@ -16,11 +18,14 @@ extern void      db2FreeStmtHdl       (HdlEntry* handlep, DB2ConnEntry* connp);
 
 /** local prototypes */
 void             db2EndTransaction    (void* arg, int is_commit, int noerror);
+void             dropKeyTables        (DB2ConnEntry* connp);
 
 /** db2EndTransaction
  *   Commit or rollback the transaction.
  *   The first argument must be a connEntry.
  *   If "noerror" is true, don't throw errors.
+ *   Key tables that are still declared, because the scan that used them
+ *   ended with an error, are dropped afterwards.
  */
 void db2EndTransaction (void* arg, int is_commit, int noerror) {
   DB2ConnEntry* connp = NULL;
@@ -71,7 +76,41 @@ void db2EndTransaction (void* arg, int is_commit, int noerror) {
       db2Error_d (FDW_UNABLE_TO_CREATE_EXECUTION, "error rolling back transaction: SQLEndTran failed", db2Message);
     }
   }
+  if (connp->keytablelist != NULL)
+    dropKeyTables (connp);
   connp->xact_level = 0;
   db2Debug2("  connp->xact_level: %d",connp->xact_level);
   db2Debug1("< db2EndTransaction");
 }
+
+/** dropKeyTables
+ *   Drop all key tables remembered at the connection and commit that.
+ *   This runs while the PostgreSQL transaction ends, so errors are ignored;
+ *   a table declared in the rolled back transaction is gone already.
+ */
+void dropKeyTables (DB2ConnEntry* connp) {
+  SQLHSTMT  hstmt = SQL_NULL_HSTMT;
+  SQLRETURN rc    = 0;
+  char      stmt[256];
+
+  db2Debug1("> dropKeyTables");
+  while (connp->keytablelist != NULL) {
+    KeyTableEntry* entry = connp->keytablelist;
+
+    snprintf (stmt, sizeof (stmt), "DROP TABLE %s", entry->tabname);
+    db2Debug2("  stmt: '%s'", stmt);
+    rc = SQLAllocHandle (SQL_HANDLE_STMT, connp->hdbc, &hstmt);
+    if (rc == SQL_SUCCESS) {
+      rc = SQLExecDirect (hstmt, (SQLCHAR*) stmt, SQL_NTS);
+      SQLFreeHandle (SQL_HANDLE_STMT, hstmt);
+    }
+    if (rc != SQL_SUCCESS) {
+      db2Debug2("  key table could not be dropped: %d", rc);
+    }
+    connp->keytablelist = entry->next;
+    free (entry->tabname);
+    free (entry);
+  }
+  SQLEndTran (SQL_HANDLE_DBC, connp->hdbc, SQL_COMMIT);
+  db2Debug1("< dropKeyTables");
+}
@@ -2,12 +2,15 @@
 
 #if PG_VERSION_NUM >= 140000
 #include <nodes/makefuncs.h>
+#include "db2_fdw.h"
+#include "DB2FdwState.h"
 
 /** external variables */
 
 /** external prototypes */
 extern void            db2Debug1                 (const char* message, ...);
 extern TupleTableSlot* db2ExecForeignInsert      (EState* estate, ResultRelInfo* rinfo, TupleTableSlot* slot, TupleTableSlot* planSlot);
+extern void            loadSlots                 (DB2FdwState* fdw_state, TupleTableSlot** slots, TupleTableSlot** planSlots, int nslots);
 
 /** local prototypes */
 TupleTableSlot**       db2ExecForeignBatchInsert (EState *estate, ResultRelInfo *rinfo, TupleTableSlot **slots, TupleTableSlot **planSlots, int *numSlots);
@@ -16,15 +19,22 @@ TupleTableSlot**       db2ExecForeignBatchInsert (EState *estate, ResultRelInfo
  * db2ExecForeignBatchInsert
  *
  * Called when the executor wants to insert multiple rows in one go.
- * For now we just loop and reuse db2ExecForeignInsert for each slot.
+ * A LOAD takes all rows in one execution with parameter arrays,
+ * otherwise we just loop and reuse db2ExecForeignInsert for each slot.
  *
  * The executor expects the returned array to point to slots containing
  * the inserted rows (or RETURNING results). We simply reuse the input
  * slots array.
  */
 TupleTableSlot ** db2ExecForeignBatchInsert(EState *estate, ResultRelInfo *rinfo, TupleTableSlot **slots, TupleTableSlot **planSlots, int *numSlots) {
+  DB2FdwState* fdw_state = (DB2FdwState*) rinfo->ri_FdwState;
   int i;
   db2Debug1("> db2ExecForeignBatchInsert");
+  if (fdw_state->load_mode != LOAD_OFF) {
+    loadSlots (fdw_state, slots, planSlots, *numSlots);
+    db2Debug1("< db2ExecForeignBatchInsert slots: %x", slots);
+    return slots;
+  }
   /*
    * According to the FDW API, this is *not* used when there is
    * a RETURNING clause, so normally these inserts don't need to
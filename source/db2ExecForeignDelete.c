@@ -1,5 +1,11 @@
 #include <postgres.h>
+#if PG_VERSION_NUM < 130000
+#include <access/tuptoaster.h>
+#else
+#include <access/detoast.h>
+#endif
 #include <commands/explain.h>
+#include <mb/pg_wchar.h>
 #if PG_VERSION_NUM < 120000
 #include <nodes/relation.h>
 #include <optimizer/var.h>
@@ -29,6 +35,7 @@ extern void*           db2alloc                  (const char* type, size_t size)
 TupleTableSlot* db2ExecForeignDelete (EState* estate, ResultRelInfo* rinfo, TupleTableSlot* slot, TupleTableSlot* planSlot);
 #ifdef WRITE_API
 void            setModifyParameters       (ParamDesc* paramList, TupleTableSlot* newslot, TupleTableSlot* oldslot, DB2Table* db2Table, DB2Session* session);
+long            db2ReadLob                (void* lob, long offset, long length, char* buf, int text);
 #endif
 
 /** db2ExecForeignDelete
@@ -157,16 +164,35 @@ void setModifyParameters (ParamDesc *paramList, TupleTableSlot * newslot, TupleT
       break;
       case BIND_LONG:
       case BIND_LONGRAW:
+        param->lob = NULL;
         if (isnull) {
-          param->value = NULL;
+          param->value     = NULL;
+          param->value_len = 0;
+          break;
+        }
+        /*
+         * A value stored out of line without compression is sent to DB2
+         * in pieces at execution, read slice by slice from the TOAST table.
+         * Compressed values would have to be decompressed from the start
+         * for every slice, so they are detoasted at once like short ones.
+         */
+        if (VARATT_IS_EXTERNAL_ONDISK (DatumGetPointer (datum))
+        &&  toast_datum_size (datum) == toast_raw_datum_size (datum) - VARHDRSZ) {
+          param->lob       = DatumGetPointer (datum);
+          param->value     = NULL;
+          param->value_len = (long) (toast_raw_datum_size (datum) - VARHDRSZ);
+          db2Debug2("  streaming %ld bytes at execution", param->value_len);
           break;
         }
         /* detoast it if necessary */
         datum = (Datum) PG_DETOAST_DATUM (datum);
         /* the first 4 bytes contain the length */
         value_len = VARSIZE (datum) - VARHDRSZ;
-        param->value = db2alloc("param->value", value_len);
+        /* binary values are bound with their length, strings need the terminating zero */
+        param->value = db2alloc("param->value", value_len + 1);
         memcpy (param->value, VARDATA(datum), value_len);
+        param->value[value_len] = '\0';
+        param->value_len = value_len;
       break;
       case BIND_OUTPUT:
       break;
@@ -175,4 +201,22 @@ void setModifyParameters (ParamDesc *paramList, TupleTableSlot * newslot, TupleT
   }
   db2Debug1("< setModifyParameters");
 }
+
+/** db2ReadLob
+ *   Copy "length" bytes at "offset" of the out of line value "lob" into "buf",
+ *   only the TOAST chunks of that slice are read. For text, a piece that
+ *   would end inside a character is shortened to the last whole one.
+ *   Returns the number of bytes copied. Called from db2PutData.
+ */
+long db2ReadLob (void* lob, long offset, long length, char* buf, int text) {
+  struct varlena* slice = pg_detoast_datum_slice ((struct varlena*) lob, (int32) offset, (int32) length);
+  long            n     = (long) VARSIZE_ANY_EXHDR (slice);
+
+  memcpy (buf, VARDATA_ANY (slice), n);
+  if (slice != (struct varlena*) lob)
+    pfree (slice);
+  if (text && n == length)
+    n = pg_mbcliplen (buf, n, n);
+  return n;
+}
 #endif /* WRITE_API */
@@ -18,14 +18,17 @@ extern bool dml_in_transaction;
 
 /** external prototypes */
 extern int             db2ExecuteInsert          (DB2Session* session, const DB2Table* db2Table, ParamDesc* paramList);
+extern int             db2LoadRows               (DB2Session* session, const DB2Table* db2Table, ParamDesc* paramList, int nrows, char** values, long* lengths);
 extern void            db2Debug1                 (const char* message, ...);
 #ifdef WRITE_API
 extern void            setModifyParameters       (ParamDesc* paramList, TupleTableSlot* newslot, TupleTableSlot* oldslot, DB2Table* db2Table, DB2Session* session);
+extern long            db2ReadLob                (void* lob, long offset, long length, char* buf, int text);
 #endif
 extern void            convertTuple              (DB2FdwState* fdw_state, Datum* values, bool* nulls, bool trunc_lob) ;
 
 /** local prototypes */
 TupleTableSlot* db2ExecForeignInsert(EState* estate, ResultRelInfo* rinfo, TupleTableSlot* slot, TupleTableSlot* planSlot);
+void            loadSlots           (DB2FdwState* fdw_state, TupleTableSlot** slots, TupleTableSlot** planSlots, int nslots);
 
 /** db2ExecForeignInsert
  *   Set the parameter values from the slots and execute the INSERT statement.
@@ -39,6 +42,13 @@ TupleTableSlot* db2ExecForeignInsert (EState* estate, ResultRelInfo* rinfo, Tupl
   db2Debug1("> db2ExecForeignInsert");
   elog (DEBUG2, "  relid: %d", RelationGetRelid (rinfo->ri_RelationDesc));
 
+  /* a LOAD takes the row as it is, there is no RETURNING clause */
+  if (fdw_state->load_mode != LOAD_OFF) {
+    loadSlots (fdw_state, &slot, &planSlot, 1);
+    db2Debug1("< db2ExecForeignInsert");
+    return slot;
+  }
+
   ++fdw_state->rowcount;
   dml_in_transaction = true;
 
@@ -68,3 +78,54 @@ TupleTableSlot* db2ExecForeignInsert (EState* estate, ResultRelInfo* rinfo, Tupl
   db2Debug1("< db2ExecForeignInsert");
   return slot;
 }
+
+/** loadSlots
+ *   Hand the rows in "slots" to the DB2 LOAD utility in one execution.
+ *   Values that stay in TOAST storage for db2ExecuteInsert are read here,
+ *   because a LOAD takes no data sent at execution.
+ */
+void loadSlots (DB2FdwState* fdw_state, TupleTableSlot** slots, TupleTableSlot** planSlots, int nslots) {
+  ParamDesc*    param;
+  char**        values;
+  long*         lengths;
+  int           nparams = 0;
+  int           rows, i, n;
+  MemoryContext oldcontext;
+
+  db2Debug1("> loadSlots");
+  dml_in_transaction = true;
+
+  MemoryContextReset (fdw_state->temp_cxt);
+  oldcontext = MemoryContextSwitchTo (fdw_state->temp_cxt);
+
+  for (param = fdw_state->paramList; param != NULL; param = param->next)
+    ++nparams;
+  values  = (char**) palloc ((nparams * nslots + 1) * sizeof (char*));
+  lengths = (long*)  palloc ((nparams * nslots + 1) * sizeof (long));
+
+  /* collect the values of each parameter, row by row */
+  for (i = 0; i < nslots; ++i) {
+    setModifyParameters (fdw_state->paramList, slots[i], planSlots ? planSlots[i] : NULL, fdw_state->db2Table, fdw_state->session);
+    for (param = fdw_state->paramList, n = 0; param != NULL; param = param->next, ++n) {
+      char* value  = param->value;
+      long  length = 0;
+
+      if (param->lob != NULL) {
+        value  = palloc (param->value_len + 1);
+        length = db2ReadLob (param->lob, 0, param->value_len, value, 0);
+      } else if (value != NULL) {
+        length = (param->bindType == BIND_LONGRAW) ? param->value_len : (long) strlen (value);
+      }
+      values [n * nslots + i] = value;
+      lengths[n * nslots + i] = length;
+    }
+  }
+
+  rows = db2LoadRows (fdw_state->session, fdw_state->db2Table, fdw_state->paramList, nslots, values, lengths);
+  if (rows != nslots)
+    ereport (ERROR, (errcode (ERRCODE_FDW_UNABLE_TO_CREATE_EXECUTION), errmsg ("LOAD into DB2 table took %d rows instead of %d after row %lu", rows, nslots, fdw_state->rowcount)));
+  fdw_state->rowcount += nslots;
+
+  MemoryContextSwitchTo (oldcontext);
+  db2Debug1("< loadSlots");
+}
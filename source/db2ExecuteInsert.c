@@ -20,6 +20,7 @@ extern SQLRETURN    db2CheckErr          (SQLRETURN status, SQLHANDLE handle, SQ
 extern void         db2Error_d           (db2error sqlstate, const char* message, const char* detail, ...);
 extern SQLSMALLINT  param2c              (SQLSMALLINT fcType);
 extern void         parse2num_struct     (const char* s, SQL_NUMERIC_STRUCT* ns);
+extern SQLRETURN    db2PutData           (DB2Session* session);
 
 /** internal prototypes */
 int                 db2ExecuteInsert     (DB2Session* session, const DB2Table* db2Table, ParamDesc* paramList);
@@ -46,7 +47,7 @@ int db2ExecuteInsert (DB2Session* session, const DB2Table* db2Table, ParamDesc*
   }
   db2Debug2("  paramcount: %d",param_count);
   /* allocate a temporary array of indicators */
-  indicators = db2alloc ("indicators", param_count * sizeof (SQLLEN));
+  indicators = db2alloc ("indicators", (param_count + 1) * sizeof (SQLLEN));
 
   /* bind the parameters */
   param_count = 0;
@@ -140,24 +141,32 @@ int db2ExecuteInsert (DB2Session* session, const DB2Table* db2Table, ParamDesc*
       break;
       case BIND_LONGRAW: {
         db2Debug3("  param->bindType: BIND_LONGRAW");
-        indicators[param_count] = (SQLLEN) ((param->value == NULL) ? SQL_NULL_DATA : SQL_NTS);
+        /* the bytes of the bytea as they are, with their length, or sent in pieces by db2PutData */
+        if (param->lob != NULL)
+          indicators[param_count] = SQL_LEN_DATA_AT_EXEC (param->value_len);
+        else
+          indicators[param_count] = (SQLLEN) ((param->value == NULL) ? SQL_NULL_DATA : param->value_len);
         db2Debug2("  param_ind       : %d",indicators[param_count]);
         rc = SQLBindParameter( session->stmtp->hsql
                              , param->colnum+1
                              , SQL_PARAM_INPUT
                              , SQL_C_BINARY
-                             , SQL_LONGVARBINARY
+                             , db2Table->cols[param->colnum]->colType
                              , db2Table->cols[param->colnum]->colSize
                              , 0
-                             , (SQLPOINTER) param->value
-                             , 0
+                             , (param->lob != NULL) ? (SQLPOINTER) param : (SQLPOINTER) param->value
+                             , (param->lob != NULL) ? 0 : param->value_len
                              , &indicators[param_count]
                              );
       }
       break;
       case BIND_LONG: {
         db2Debug3("  param->bindType: BIND_LONG");
-        indicators[param_count] = (SQLLEN) ((param->value == NULL) ? SQL_NULL_DATA : SQL_NTS);
+        /* the string, or sent in pieces by db2PutData */
+        if (param->lob != NULL)
+          indicators[param_count] = SQL_LEN_DATA_AT_EXEC (param->value_len);
+        else
+          indicators[param_count] = (SQLLEN) ((param->value == NULL) ? SQL_NULL_DATA : SQL_NTS);
         db2Debug2("  param_ind       : %d",indicators[param_count]);
         db2Debug2("  param->value    : '%s'",param->value);
         rc = SQLBindParameter( session->stmtp->hsql
@@ -167,7 +176,7 @@ int db2ExecuteInsert (DB2Session* session, const DB2Table* db2Table, ParamDesc*
                              , SQL_LONGVARCHAR
                              , db2Table->cols[param->colnum]->colSize
                              , 0
-                             , (SQLPOINTER) param->value
+                             , (param->lob != NULL) ? (SQLPOINTER) param : (SQLPOINTER) param->value
                              , 0
                              , &indicators[param_count]
                              );
@@ -215,6 +224,9 @@ int db2ExecuteInsert (DB2Session* session, const DB2Table* db2Table, ParamDesc*
   }
   db2Debug2("  cursor name: '%s'", cname);
   rc = SQLExecute (session->stmtp->hsql);
+  /* send the values bound for data at execution */
+  if (rc == SQL_NEED_DATA)
+    rc = db2PutData (session);
   rc = db2CheckErr(rc, session->stmtp->hsql, session->stmtp->type, __LINE__, __FILE__);
   if (rc != SQL_SUCCESS && rc != SQL_NO_DATA) {
     /* use the correct SQLSTATE for serialization failures */
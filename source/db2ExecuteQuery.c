@@ -1,3 +1,4 @@
+#include <stdlib.h>
 #include <string.h>
 #include <sqlcli1.h>
 #include <postgres_ext.h>
@@ -11,8 +12,6 @@ extern char         db2Message[ERRBUFSIZE];/* contains DB2 error messages, set b
 extern int          err_code;              /* error code, set by db2CheckErr()                              */
 
 /** external prototypes */
-extern void*        db2alloc             (const char* type, size_t size);
-extern void         db2free              (void* p);
 extern void         db2Debug1            (const char* message, ...);
 extern void         db2Debug2            (const char* message, ...);
 extern void         db2Debug3            (const char* message, ...);
@@ -20,204 +19,71 @@ extern SQLRETURN    db2CheckErr          (SQLRETURN status, SQLHANDLE handle, SQ
 extern void         db2Error_d           (db2error sqlstate, const char* message, const char* detail, ...);
 extern SQLSMALLINT  param2c              (SQLSMALLINT fcType);
 extern void         parse2num_struct     (const char* s, SQL_NUMERIC_STRUCT* ns);
+extern SQLRETURN    db2PutData           (DB2Session* session);
 
 /** internal prototypes */
 int                 db2ExecuteQuery      (DB2Session* session, const DB2Table* db2Table, ParamDesc* paramList);
+void                bindParamValue       (HdlEntry* stmtp, const DB2Table* db2Table, ParamDesc* param, char* value, int pos);
+SQLRETURN           bindParamBuf         (HdlEntry* stmtp, SQLUSMALLINT pos, SQLSMALLINT inout, SQLSMALLINT ctype, SQLSMALLINT sqltype, SQLULEN colsize, SQLSMALLINT digits, SQLPOINTER ptr, SQLLEN buflen);
+SQLCHAR*            fillParamBuf         (ParamBuf* buf, const char* value);
 
 /** db2ExecuteQuery
  *   Execute a prepared statement and fetches the first result row.
  *   The parameters ("bind variables") are filled from paramList.
  *   Returns the count of processed rows.
  *   This can be called several times for a prepared SQL statement.
+ *   The parameter buffers stay bound to the statement handle, on repeated
+ *   executions they are only refilled with the new values.
+ *   An array parameter fills as many consecutive markers as the
+ *   statement was prepared with.
  */
 int db2ExecuteQuery (DB2Session* session, const DB2Table* db2Table, ParamDesc* paramList) {
-  SQLLEN*     indicators   = NULL;
+  HdlEntry*   stmtp        = session->stmtp;
   ParamDesc*  param        = NULL;
   SQLRETURN   rc           = 0;
   SQLINTEGER  rowcount_val = 0;
   SQLSMALLINT outlen       = 0;
+  SQLSMALLINT ncols        = 0;
   SQLCHAR     cname[256]   = {0};  /* 256 is usually plenty; see note below */
   int         rowcount     = 0;
   int         param_count  = 0;
   
   db2Debug1("> db2ExecureQuery");
   for (param = paramList; param != NULL; param = param->next) {
-    ++param_count;
+    param_count += (param->isarray) ? ((param->nmarkers > 0) ? param->nmarkers : 0) : 1;
   }
   db2Debug2("  paramcount: %d",param_count);
-  /* allocate a temporary array of indicators */
-  indicators = db2alloc ("indicators", param_count * sizeof (SQLLEN));
+  /* a previous execution might still have an open result set */
+  if (stmtp->cursor_open) {
+    rc = SQLFreeStmt (stmtp->hsql, SQL_CLOSE);
+    rc = db2CheckErr(rc, stmtp->hsql, stmtp->type, __LINE__, __FILE__);
+    if (rc != SQL_SUCCESS) {
+      db2Error_d(FDW_UNABLE_TO_CREATE_EXECUTION, "error executing query: SQLFreeStmt failed to close cursor", db2Message);
+    }
+    stmtp->cursor_open = 0;
+  }
+  /* allocate the parameter buffers on first execution, they live as long as the statement handle */
+  if (stmtp->param_buf == NULL && param_count > 0) {
+    if ((stmtp->param_buf = calloc (param_count, sizeof (ParamBuf))) == NULL) {
+      db2Error_d (FDW_OUT_OF_MEMORY, "error executing query:"," failed to allocate %d bytes of memory", param_count * sizeof (ParamBuf));
+    }
+    stmtp->param_cnt = param_count;
+  } else if (stmtp->param_cnt != param_count) {
+    db2Error_d(FDW_ERROR, "error executing query: parameter count changed", "Internal error: statement was prepared with %d parameters, got %d", stmtp->param_cnt, param_count);
+  }
 
-  /* bind the parameters */
+  /* fill and bind the parameters, an array parameter fills all of its markers */
   param_count = 0;
   for (param = paramList; param; param = param->next) {
-    ++param_count;
-    db2Debug2("  paramcount      : %d",param_count);
-    db2Debug2("  param->value    : %s",param->value);
-    db2Debug2("  param->colnum   : %d",param->colnum);
-    db2Debug2("  param->bindType : %d",param->bindType);
-    db2Debug2("  param_count     : %d",param_count);
-    if (param->colnum >= 0) {
-      db2Debug2("  colName         : %s",db2Table->cols[param->colnum]->colName);
-    }
-    switch (param->bindType) {
-      case BIND_NUMBER: {
-        /* For SELECT query parameters (colnum == -1), use SQL_NUMERIC as default */
-        SQLSMALLINT colType = (param->colnum >= 0) ? db2Table->cols[param->colnum]->colType : SQL_DOUBLE;
-        db2Debug3("  param->bindType: BIND_NUMBER");
-        indicators[param_count] = (SQLLEN) ((param->value == NULL) ? SQL_NULL_DATA : 0);
-        db2Debug2("  param_ind       : %d",indicators[param_count]);
-        switch (colType){
-          case SQL_SMALLINT:{
-            char* end = NULL;
-            SQLSMALLINT sqlint = strtol(param->value,&end,10);
-            db2Debug2("  sqlint: %d",sqlint);
-            db2Debug2("  param->bindType: SQL_SMALLINT");
-            rc = SQLBindParameter( session->stmtp->hsql
-                                 , param_count
-                                 , SQL_PARAM_INPUT
-                                 , SQL_C_SSHORT
-                                 , colType
-                                 , 0
-                                 , 0
-                                 , &sqlint
-                                 , 0
-                                 , &indicators[param_count]
-                                 );
-          }
-          break;
-          case SQL_INTEGER: {
-            char* end = NULL;
-            SQLINTEGER sqlint = strtol(param->value,&end,10);
-            db2Debug2("  sqlint: %d",sqlint);
-            db2Debug2("  param->bindType: SQL_INTEGER");
-            rc = SQLBindParameter( session->stmtp->hsql
-                                 , param_count
-                                 , SQL_PARAM_INPUT
-                                 , SQL_C_SLONG
-                                 , colType
-                                 , 0
-                                 , 0
-                                 , &sqlint
-                                 , 0
-                                 , &indicators[param_count]
-                                 );
-          }
-          break;
-          default: {
-            SQL_NUMERIC_STRUCT num = {0};
-            parse2num_struct(param->value, &num);
-            db2Debug2("  param->bindType: SQL_NUMERIC");
-            db2Debug2("  num: '%s'",num);
-            rc = SQLBindParameter( session->stmtp->hsql
-                                 , param_count
-                                 , SQL_PARAM_INPUT
-                                 , SQL_C_NUMERIC
-                                 , colType
-                                 , num.precision
-                                 , num.scale
-                                 , &num
-                                 , sizeof(num)
-                                 , &indicators[param_count]
-                                 );
-          }
-          break;
-        }
-      }
-      break;
-      case BIND_STRING: {
-        /* For SELECT query parameters (colnum == -1), use a default size */
-        SQLINTEGER colSize = (param->colnum >= 0) ? db2Table->cols[param->colnum]->colSize : 4000;
-        db2Debug3("  param->bindType: BIND_STRING");
-        indicators[param_count] = (SQLLEN) ((param->value == NULL) ? SQL_NULL_DATA : SQL_NTS);
-        db2Debug2("  param_ind       : %d",indicators[param_count]);
-        rc = SQLBindParameter( session->stmtp->hsql
-                             , param_count
-                             , SQL_PARAM_INPUT
-                             , SQL_C_CHAR
-                             , SQL_VARCHAR
-                             , colSize
-                             , 0
-                             , (SQLPOINTER) param->value
-                             , 0
-                             , &indicators[param_count]
-                             );
-      }
-      break;
-      case BIND_LONGRAW: {
-        /* For SELECT query parameters (colnum == -1), use a default size */
-        SQLINTEGER colSize = (param->colnum >= 0) ? db2Table->cols[param->colnum]->colSize : 32767;
-        db2Debug3("  param->bindType: BIND_LONGRAW");
-        indicators[param_count] = (SQLLEN) ((param->value == NULL) ? SQL_NULL_DATA : SQL_NTS);
-        db2Debug2("  param_ind       : %d",indicators[param_count]);
-        rc = SQLBindParameter( session->stmtp->hsql
-                             , param_count
-                             , SQL_PARAM_INPUT
-                             , SQL_C_BINARY
-                             , SQL_LONGVARBINARY
-                             , colSize
-                             , 0
-                             , (SQLPOINTER) param->value
-                             , 0
-                             , &indicators[param_count]
-                             );
-      }
-      break;
-      case BIND_LONG: {
-        SQLINTEGER colSize = (param->colnum >= 0) ? db2Table->cols[param->colnum]->colSize : 32700;
-        db2Debug3("  param->bindType: BIND_LONG");
-        indicators[param_count] = (SQLLEN) ((param->value == NULL) ? SQL_NULL_DATA : SQL_NTS);
-        db2Debug2("  param_ind       : %d",indicators[param_count]);
-        db2Debug2("  param->value    : '%s'",param->value);
-        /* For SELECT query parameters (colnum == -1), use a default size */
-        rc = SQLBindParameter( session->stmtp->hsql
-                             , param_count
-                             , SQL_PARAM_INPUT
-                             , SQL_C_CHAR
-                             , SQL_LONGVARCHAR
-                             , colSize
-                             , 0
-                             , (SQLPOINTER) param->value
-                             , 0
-                             , &indicators[param_count]
-                             );
-      }
-      break;
-      case BIND_OUTPUT: {
-        SQLSMALLINT fcType;
-        SQLSMALLINT fParamType;
-        db2Debug2("  param->bindType: BIND_OUTPUT");
-        indicators[param_count] = (SQLLEN) ((param->value == NULL) ? SQL_NULL_DATA : 0);
-        db2Debug2("  param_ind       : %d",indicators[param_count]);
-        /* BIND_OUTPUT should only be used for DML operations, so colnum must be >= 0 */
-        if (param->colnum < 0) {
-          db2Error_d(FDW_UNABLE_TO_CREATE_EXECUTION, "error executing query: BIND_OUTPUT parameter with invalid colnum", "Internal error: BIND_OUTPUT requires valid colnum");
-        }
-        if (db2Table->cols[param->colnum]->pgtype == UUIDOID) {
-          /* the type input function will interpret the string value correctly */
-          fcType = SQL_CHAR;
-        } else {
-          fcType = db2Table->cols[param->colnum]->colType;
-        }
-        fParamType = param2c(fcType);
-        rc = SQLBindParameter( session->stmtp->hsql
-                             , param_count
-                             , SQL_PARAM_OUTPUT
-                             , fParamType
-                             , fcType
-                             , db2Table->cols[param->colnum]->colSize
-                             , 0
-                             , (SQLPOINTER) param->value
-                             , db2Table->cols[param->colnum]->val_size
-                             , &indicators[param_count]
-                             );
+    if (param->isarray) {
+      int i;
+      for (i = 0; i < param->nmarkers; ++i) {
+        /* pad the list by repeating the last element, that does not change the result of IN */
+        char* value = (param->nelems == 0) ? NULL : param->elems[(i < param->nelems) ? i : param->nelems - 1];
+        bindParamValue (stmtp, db2Table, param, value, ++param_count);
       }
-      break;
-    }
-    /* bind the value to the parameter */
-    rc = db2CheckErr(rc,  session->stmtp->hsql, session->stmtp->type, __LINE__, __FILE__);
-    if (rc != SQL_SUCCESS) {
-      db2Error_d(FDW_UNABLE_TO_CREATE_EXECUTION, "error executing query: SQLBindParameter failed to bind parameter", db2Message);
+    } else {
+      bindParamValue (stmtp, db2Table, param, param->value, ++param_count);
     }
   }
   /* execute the query and get the first result row */
@@ -229,12 +95,19 @@ int db2ExecuteQuery (DB2Session* session, const DB2Table* db2Table, ParamDesc* p
   }
   db2Debug2("  cursor name: '%s'", cname);
   rc = SQLExecute (session->stmtp->hsql);
+  /* send the values bound for data at execution */
+  if (rc == SQL_NEED_DATA)
+    rc = db2PutData (session);
   rc = db2CheckErr(rc, session->stmtp->hsql, session->stmtp->type, __LINE__, __FILE__);
   if (rc != SQL_SUCCESS && rc != SQL_NO_DATA) {
     /* use the correct SQLSTATE for serialization failures */
     db2Error_d(err_code == 8177 ? FDW_SERIALIZATION_FAILURE : FDW_UNABLE_TO_CREATE_EXECUTION, "error executing query: SQLExecute failed to execute remote query", db2Message);
   }
-  db2free(indicators);
+  /* remember whether the execution opened a result set */
+  if (rc == SQL_SUCCESS && SQLNumResultCols (session->stmtp->hsql, &ncols) == SQL_SUCCESS && ncols > 0) {
+    session->stmtp->cursor_open = 1;
+  }
+  db2Debug2("  cursor_open: %d",session->stmtp->cursor_open);
   if (rc == SQL_NO_DATA) {
     db2Debug3("  SQL_NO_DATA");
     db2Debug1("< db2ExecureQuery - returns: 0");
@@ -252,3 +125,189 @@ int db2ExecuteQuery (DB2Session* session, const DB2Table* db2Table, ParamDesc* p
   db2Debug1("< db2ExecureQuery - returns: %d",rowcount);
   return rowcount;
 }
+
+/** bindParamValue
+ *   Fill the parameter buffer at position "pos" with "value" and bind it
+ *   according to the bind type of "param".
+ */
+void bindParamValue (HdlEntry* stmtp, const DB2Table* db2Table, ParamDesc* param, char* value, int pos) {
+  ParamBuf*   buf = &stmtp->param_buf[pos - 1];
+  SQLRETURN   rc  = 0;
+
+  db2Debug2("  > bindParamValue");
+  db2Debug2("  pos             : %d",pos);
+  db2Debug2("  value           : %s",value);
+  db2Debug2("  param->colnum   : %d",param->colnum);
+  db2Debug2("  param->bindType : %d",param->bindType);
+  if (param->colnum >= 0) {
+    db2Debug2("  colName         : %s",db2Table->cols[param->colnum]->colName);
+  }
+  switch (param->bindType) {
+    case BIND_NUMBER: {
+      /* For SELECT query parameters (colnum == -1), use SQL_NUMERIC as default */
+      SQLSMALLINT colType = (param->colnum >= 0) ? db2Table->cols[param->colnum]->colType : SQL_DOUBLE;
+      db2Debug3("  param->bindType: BIND_NUMBER");
+      buf->ind = (SQLLEN) ((value == NULL) ? SQL_NULL_DATA : 0);
+      db2Debug2("  param_ind       : %d",buf->ind);
+      switch (colType){
+        case SQL_SMALLINT:{
+          char* end = NULL;
+          buf->sval = (value == NULL) ? 0 : strtol(value,&end,10);
+          db2Debug2("  sqlint: %d",buf->sval);
+          db2Debug2("  param->bindType: SQL_SMALLINT");
+          rc = bindParamBuf(stmtp, pos, SQL_PARAM_INPUT, SQL_C_SSHORT, colType, 0, 0, &buf->sval, 0);
+        }
+        break;
+        case SQL_INTEGER: {
+          char* end = NULL;
+          buf->ival = (value == NULL) ? 0 : strtol(value,&end,10);
+          db2Debug2("  sqlint: %d",buf->ival);
+          db2Debug2("  param->bindType: SQL_INTEGER");
+          rc = bindParamBuf(stmtp, pos, SQL_PARAM_INPUT, SQL_C_SLONG, colType, 0, 0, &buf->ival, 0);
+        }
+        break;
+        default: {
+          memset(&buf->nval, 0, sizeof(buf->nval));
+          if (value != NULL)
+            parse2num_struct(value, &buf->nval);
+          db2Debug2("  param->bindType: SQL_NUMERIC");
+          rc = bindParamBuf(stmtp, pos, SQL_PARAM_INPUT, SQL_C_NUMERIC, colType, buf->nval.precision, buf->nval.scale, &buf->nval, sizeof(buf->nval));
+        }
+        break;
+      }
+    }
+    break;
+    case BIND_STRING: {
+      /* For SELECT query parameters (colnum == -1), use a default size */
+      SQLINTEGER colSize = (param->colnum >= 0) ? db2Table->cols[param->colnum]->colSize : 4000;
+      db2Debug3("  param->bindType: BIND_STRING");
+      buf->ind = (SQLLEN) ((value == NULL) ? SQL_NULL_DATA : SQL_NTS);
+      db2Debug2("  param_ind       : %d",buf->ind);
+      rc = bindParamBuf(stmtp, pos, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_VARCHAR, colSize, 0, fillParamBuf(buf, value), 0);
+    }
+    break;
+    case BIND_LONGRAW: {
+      /* For SELECT query parameters (colnum == -1), use a default size */
+      SQLINTEGER colSize = (param->colnum >= 0) ? db2Table->cols[param->colnum]->colSize : 32767;
+      SQLSMALLINT colType = (param->colnum >= 0) ? db2Table->cols[param->colnum]->colType : SQL_LONGVARBINARY;
+      db2Debug3("  param->bindType: BIND_LONGRAW");
+      if (param->lob != NULL) {
+        /* sent in pieces by db2PutData, the parameter is the token */
+        buf->ind = SQL_LEN_DATA_AT_EXEC (param->value_len);
+        rc = bindParamBuf(stmtp, pos, SQL_PARAM_INPUT, SQL_C_BINARY, colType, colSize, 0, (SQLPOINTER) param, 0);
+        break;
+      }
+      /* the bytes of the bytea as they are, with their length */
+      buf->ind = (SQLLEN) ((value == NULL) ? SQL_NULL_DATA : param->value_len);
+      db2Debug2("  param_ind       : %d",buf->ind);
+      rc = bindParamBuf(stmtp, pos, SQL_PARAM_INPUT, SQL_C_BINARY, colType, colSize, 0, (SQLPOINTER) value, param->value_len);
+    }
+    break;
+    case BIND_LONG: {
+      SQLINTEGER colSize = (param->colnum >= 0) ? db2Table->cols[param->colnum]->colSize : 32700;
+      db2Debug3("  param->bindType: BIND_LONG");
+      if (param->lob != NULL) {
+        /* sent in pieces by db2PutData, the parameter is the token */
+        buf->ind = SQL_LEN_DATA_AT_EXEC (param->value_len);
+        rc = bindParamBuf(stmtp, pos, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_LONGVARCHAR, colSize, 0, (SQLPOINTER) param, 0);
+        break;
+      }
+      buf->ind = (SQLLEN) ((value == NULL) ? SQL_NULL_DATA : SQL_NTS);
+      db2Debug2("  param_ind       : %d",buf->ind);
+      db2Debug2("  value           : '%s'",value);
+      /* For SELECT query parameters (colnum == -1), use a default size */
+      rc = bindParamBuf(stmtp, pos, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_LONGVARCHAR, colSize, 0, (SQLPOINTER) value, 0);
+    }
+    break;
+    case BIND_OUTPUT: {
+      SQLSMALLINT fcType;
+      SQLSMALLINT fParamType;
+      db2Debug2("  param->bindType: BIND_OUTPUT");
+      buf->ind = (SQLLEN) ((value == NULL) ? SQL_NULL_DATA : 0);
+      db2Debug2("  param_ind       : %d",buf->ind);
+      /* BIND_OUTPUT should only be used for DML operations, so colnum must be >= 0 */
+      if (param->colnum < 0) {
+        db2Error_d(FDW_UNABLE_TO_CREATE_EXECUTION, "error executing query: BIND_OUTPUT parameter with invalid colnum", "Internal error: BIND_OUTPUT requires valid colnum");
+      }
+      if (db2Table->cols[param->colnum]->pgtype == UUIDOID) {
+        /* the type input function will interpret the string value correctly */
+        fcType = SQL_CHAR;
+      } else {
+        fcType = db2Table->cols[param->colnum]->colType;
+      }
+      fParamType = param2c(fcType);
+      rc = bindParamBuf(stmtp, pos, SQL_PARAM_OUTPUT, fParamType, fcType, db2Table->cols[param->colnum]->colSize, 0, (SQLPOINTER) param->value, db2Table->cols[param->colnum]->val_size);
+    }
+    break;
+  }
+  /* bind the value to the parameter */
+  rc = db2CheckErr(rc,  stmtp->hsql, stmtp->type, __LINE__, __FILE__);
+  if (rc != SQL_SUCCESS) {
+    db2Error_d(FDW_UNABLE_TO_CREATE_EXECUTION, "error executing query: SQLBindParameter failed to bind parameter", db2Message);
+  }
+  db2Debug2("  < bindParamValue");
+}
+
+/** bindParamBuf
+ *   Bind a parameter buffer to the statement.
+ *   SQLBindParameter is only called if the binding differs from the one
+ *   used in the previous execution, otherwise the refilled buffer is used as is.
+ */
+SQLRETURN bindParamBuf (HdlEntry* stmtp, SQLUSMALLINT pos, SQLSMALLINT inout, SQLSMALLINT ctype, SQLSMALLINT sqltype, SQLULEN colsize, SQLSMALLINT digits, SQLPOINTER ptr, SQLLEN buflen) {
+  ParamBuf* buf = &stmtp->param_buf[pos - 1];
+  SQLRETURN rc  = SQL_SUCCESS;
+  db2Debug2("  > bindParamBuf");
+  if (buf->ptr != ptr || buf->inout != inout || buf->ctype != ctype || buf->sqltype != sqltype || buf->colsize != colsize || buf->digits != digits || buf->buflen != buflen) {
+    db2Debug3("    bind parameter %d", pos);
+    rc = SQLBindParameter( stmtp->hsql
+                         , pos
+                         , inout
+                         , ctype
+                         , sqltype
+                         , colsize
+                         , digits
+                         , ptr
+                         , buflen
+                         , &buf->ind
+                         );
+    if (rc == SQL_SUCCESS) {
+      buf->inout   = inout;
+      buf->ctype   = ctype;
+      buf->sqltype = sqltype;
+      buf->colsize = colsize;
+      buf->digits  = digits;
+      buf->ptr     = ptr;
+      buf->buflen  = buflen;
+    } else {
+      /* force a new binding on the next execution */
+      buf->ptr     = NULL;
+    }
+  } else {
+    db2Debug3("    parameter %d already bound", pos);
+  }
+  db2Debug2("  < bindParamBuf - returns: %d", rc);
+  return rc;
+}
+
+/** fillParamBuf
+ *   Copy a character value into the parameter buffer, growing it if necessary.
+ *   Returns the address of the buffer.
+ */
+SQLCHAR* fillParamBuf (ParamBuf* buf, const char* value) {
+  SQLLEN len = (value == NULL) ? 0 : strlen (value);
+  db2Debug2("  > fillParamBuf");
+  if (buf->cval == NULL || buf->cval_size < len + 1) {
+    SQLLEN    size = (len + 1 < 256) ? 256 : len + 1;
+    SQLCHAR*  cval = realloc (buf->cval, size);
+    if (cval == NULL) {
+      db2Error_d (FDW_OUT_OF_MEMORY, "error executing query:"," failed to allocate %d bytes of memory", size);
+    }
+    buf->cval      = cval;
+    buf->cval_size = size;
+  }
+  if (value != NULL)
+    memcpy (buf->cval, value, len);
+  buf->cval[len] = '\0';
+  db2Debug2("  < fillParamBuf - returns: %x", buf->cval);
+  return buf->cval;
+}
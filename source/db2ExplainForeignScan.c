@@ -21,6 +21,7 @@ extern void*        db2alloc                  (const char* type, size_t size);
 extern void         db2free                   (void* p);
 extern void         db2Debug1                 (const char* message, ...);
 extern void         db2Debug2                 (const char* message, ...);
+extern unsigned int budgetPrefetch            (DB2FdwState* fdw_state);
 
 /** local prototypes */
 void db2ExplainForeignScan(ForeignScanState* node, ExplainState* es);
@@ -29,12 +30,29 @@ void db2Explain           (void* fdw, ExplainState* es);
 /** db2ExplainForeignScan
  *   Produce extra output for EXPLAIN:
  *   the DB2 query and, if VERBOSE was given, the execution plan.
+ *   With ANALYZE, a parameterized scan that switched from lookups
+ *   to the full result also shows the query for that.
+ *   The memory for the fetched values of a row is shown as well,
+ *   and the number of prefetched rows if "fetch_memory" is set.
  */
 void db2ExplainForeignScan (ForeignScanState* node, ExplainState* es) {
   DB2FdwState* fdw_state = (DB2FdwState*) node->fdw_state;
   db2Debug1("> db2ExplainForeignScan");
   elog (DEBUG1, "db2_fdw: explain foreign table scan");
   ExplainPropertyText ("DB2 query", fdw_state->query, es);
+  if (fdw_state->full_cache != NULL)
+    ExplainPropertyText ("DB2 full scan", fdw_state->full_query, es);
+#if PG_VERSION_NUM < 110000
+  ExplainPropertyLong ("DB2 fetch buffers", (long) fdw_state->db2Table->buffers_size, es);
+#else
+  ExplainPropertyInteger ("DB2 fetch buffers", "bytes", (int64) fdw_state->db2Table->buffers_size, es);
+#endif
+  if (fdw_state->fetch_memory > 0)
+#if PG_VERSION_NUM < 110000
+    ExplainPropertyLong ("DB2 prefetch", (long) budgetPrefetch (fdw_state), es);
+#else
+    ExplainPropertyInteger ("DB2 prefetch", "rows", (int64) budgetPrefetch (fdw_state), es);
+#endif
   db2Explain (fdw_state, es);
   db2Debug1("< db2ExplainForeignScan");
 }
@@ -48,6 +48,18 @@ void db2FreeStmtHdl (HdlEntry* handlep, DB2ConnEntry* connp) {
     prev_entryp->next = handlep->next;
     db2Debug3("  prev_entryp->next: '%x'", prev_entryp->next);
   }
+  /* release the parameter buffers bound to the statement */
+  if (entryp->param_buf != NULL) {
+    int i;
+    for (i = 0; i < entryp->param_cnt; i++) {
+      if (entryp->param_buf[i].cval != NULL)
+        free (entryp->param_buf[i].cval);
+    }
+    free (entryp->param_buf);
+  }
+  /* release the description of an unfinished LOAD */
+  if (entryp->load_info != NULL)
+    free (entryp->load_info);
   db2Debug1("  HdlEntry freeed: %x",entryp);
   free (entryp);
   db2Debug1("< db2FreeStmtHdl");
@@ -1,5 +1,6 @@
 #include <postgres.h>
 #include <foreign/foreign.h>
+#include <utils/guc.h>
 #include <utils/lsyscache.h>
 #if PG_VERSION_NUM < 120000
 #include <nodes/relation.h>
@@ -24,6 +25,7 @@ extern void         db2Debug2                 (const char* message, ...);
 extern void         db2Debug3                 (const char* message, ...);
 extern void*        db2alloc                  (const char* type, size_t size);
 extern char*        db2strdup                 (const char* source);
+extern void         buildAttrMap              (DB2Table* db2Table);
 
 /** local prototypes */
 DB2FdwState* db2GetFdwState(Oid foreigntableid, double* sample_percent, bool describe);
@@ -51,6 +53,15 @@ DB2FdwState* db2GetFdwState (Oid foreigntableid, double *sample_percent, bool de
   char*        fetch    = NULL;
   char*        noencerr = NULL;
   char*        batchsz  = NULL;
+  char*        rescan   = NULL;
+  char*        keytab   = NULL;
+  char*        collate  = NULL;
+  char*        bindcons = NULL;
+  char*        fetchmem = NULL;
+  char*        colbuf   = NULL;
+  char*        load     = NULL;
+  char*        loadsave = NULL;
+  int          i;
   long max_long;
 
   db2Debug1("> db2GetFdwState");
@@ -85,6 +96,24 @@ DB2FdwState* db2GetFdwState (Oid foreigntableid, double *sample_percent, bool de
       noencerr = STRVAL(def->arg);
     if (strcmp (def->defname, OPT_BATCH_SIZE) == 0)
       batchsz  = STRVAL(def->arg);
+    if (strcmp (def->defname, OPT_RESCAN_CACHE) == 0)
+      rescan   = STRVAL(def->arg);
+    if (strcmp (def->defname, OPT_KEY_TABLE) == 0)
+      keytab   = STRVAL(def->arg);
+    if (strcmp (def->defname, OPT_COLLATION) == 0)
+      collate  = STRVAL(def->arg);
+    if (strcmp (def->defname, OPT_BIND_CONSTANTS) == 0)
+      bindcons = STRVAL(def->arg);
+    if (strcmp (def->defname, OPT_FETCH_MEMORY) == 0)
+      fetchmem = STRVAL(def->arg);
+    if (strcmp (def->defname, OPT_COLUMN_BUFFER) == 0)
+      colbuf   = STRVAL(def->arg);
+    if (strcmp (def->defname, OPT_LOAD) == 0)
+      load     = STRVAL(def->arg);
+    if (strcmp (def->defname, OPT_LOAD_SAVECOUNT) == 0)
+      loadsave = STRVAL(def->arg);
+    if (strcmp (def->defname, OPT_LOAD_MESSAGES) == 0)
+      fdwState->load_messages = STRVAL(def->arg);
   }
 
   /* convert "max_long" option to number or use default */
@@ -107,6 +136,34 @@ DB2FdwState* db2GetFdwState (Oid foreigntableid, double *sample_percent, bool de
   else
     fdwState->prefetch = (unsigned int) strtoul (fetch, NULL, 0);
 
+  /* a memory budget for the prefetched rows overrides "prefetch" */
+  fdwState->fetch_memory = 0;
+  if (fetchmem != NULL && !parse_int (fetchmem, &fdwState->fetch_memory, GUC_UNIT_BYTE, NULL))
+    fdwState->fetch_memory = 0;
+
+  /* "column_buffer" limits the result buffers of long character columns */
+  fdwState->column_buffer = 0;
+  if (colbuf != NULL && !parse_int (colbuf, &fdwState->column_buffer, GUC_UNIT_BYTE, NULL))
+    fdwState->column_buffer = 0;
+
+  /* "rescan_cache" is off by default */
+  fdwState->rescan_cache = (rescan != NULL && optionIsTrue (rescan));
+
+  /* arrays are never shipped into a key table by default */
+  fdwState->key_table_min = (keytab == NULL) ? 0 : (int) strtol (keytab, NULL, 0);
+
+  /* constants are written into the query by default */
+  fdwState->bind_constants = (bindcons != NULL && optionIsTrue (bindcons));
+
+  /* INSERTs do not use the LOAD utility by default */
+  if (load != NULL && pg_strcasecmp (load, "insert") == 0)
+    fdwState->load_mode = LOAD_INSERT;
+  else if (load != NULL && pg_strcasecmp (load, "replace") == 0)
+    fdwState->load_mode = LOAD_REPLACE;
+  else
+    fdwState->load_mode = LOAD_OFF;
+  fdwState->load_savecount = (loadsave == NULL) ? 0 : (int) strtol (loadsave, NULL, 0);
+
   /* check if options are ok */
   if (table == NULL)
     ereport (ERROR, (errcode (ERRCODE_FDW_OPTION_NAME_NOT_FOUND), errmsg ("required option \"%s\" in foreign table \"%s\" missing", OPT_TABLE, pgtablename)));
@@ -121,6 +178,10 @@ DB2FdwState* db2GetFdwState (Oid foreigntableid, double *sample_percent, bool de
     /* get remote table description */
     fdwState->db2Table = db2Describe (fdwState->session, schema, table, pgtablename, max_long, noencerr, batchsz);
 
+    /* DB2 collates strings differently unless declared otherwise, columns can override that */
+    for (i = 0; i < fdwState->db2Table->ncols; ++i)
+      fdwState->db2Table->cols[i]->colCollate = (collate != NULL && optionIsTrue (collate));
+
     /* add PostgreSQL data to table description */
     getColumnData (fdwState->db2Table, foreigntableid);
   }
@@ -131,7 +192,7 @@ DB2FdwState* db2GetFdwState (Oid foreigntableid, double *sample_percent, bool de
 
 /** getColumnData
  *   Get PostgreSQL column name and number, data type and data type modifier.
- *   Set db2Table->npgcols.
+ *   Set db2Table->npgcols and build the map from attribute numbers to columns.
  *   For PostgreSQL 9.2 and better, find the primary key columns and mark them in db2Table.
  */
 void getColumnData (DB2Table* db2Table, Oid foreigntableid) {
@@ -179,10 +240,16 @@ void getColumnData (DB2Table* db2Table, Oid foreigntableid) {
       if (strcmp (def->defname, OPT_NO_ENCODING_ERROR) == 0) {
         db2Table->cols[index - 1]->noencerr = optionIsTrue((STRVAL(def->arg))) ? NO_ENC_ERR_TRUE : NO_ENC_ERR_FALSE; 
       }
+      /* is it the "collation_compatible" option set */
+      if (strcmp (def->defname, OPT_COLLATION) == 0) {
+        db2Table->cols[index - 1]->colCollate = optionIsTrue ((STRVAL(def->arg)));
+      }
     }
   }
 
   table_close (rel, NoLock);
+  /* find columns by attribute number from now on */
+  buildAttrMap (db2Table);
   db2Debug2("  < getColumnData");
 }
 
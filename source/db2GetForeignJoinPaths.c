@@ -18,6 +18,7 @@ extern void         db2Debug1                 (const char* message, ...);
 extern char*        deparseExpr               (DB2Session* session, RelOptInfo * foreignrel, Expr* expr, const DB2Table* db2Table, List** params);
 extern char*        db2strdup                 (const char* source);
 extern void*        db2alloc                  (const char* type, size_t size);
+extern void         buildAttrMap              (DB2Table* db2Table);
 
 /** local prototypes */
 void db2GetForeignJoinPaths(PlannerInfo* root, RelOptInfo* joinrel, RelOptInfo* outerrel, RelOptInfo* innerrel, JoinType jointype, JoinPathExtraData* extra);
@@ -235,6 +236,30 @@ bool foreign_join_ok (PlannerInfo * root, RelOptInfo * joinrel, JoinType jointyp
     fdwState->prefetch = fdwState_o->prefetch;
   else
     fdwState->prefetch = fdwState_i->prefetch;
+  /* the smaller memory budget, if any */
+  if (fdwState_o->fetch_memory == 0 || (fdwState_i->fetch_memory != 0 && fdwState_i->fetch_memory < fdwState_o->fetch_memory))
+    fdwState->fetch_memory = fdwState_i->fetch_memory;
+  else
+    fdwState->fetch_memory = fdwState_o->fetch_memory;
+  /* the smaller column buffer limit, if any */
+  if (fdwState_o->column_buffer == 0 || (fdwState_i->column_buffer != 0 && fdwState_i->column_buffer < fdwState_o->column_buffer))
+    fdwState->column_buffer = fdwState_i->column_buffer;
+  else
+    fdwState->column_buffer = fdwState_o->column_buffer;
+
+  /* cache the join result for rescans only if both sides allow it */
+  fdwState->rescan_cache = fdwState_o->rescan_cache && fdwState_i->rescan_cache;
+
+  /* use key tables only if both sides allow it, with the higher threshold */
+  if (fdwState_o->key_table_min == 0 || fdwState_i->key_table_min == 0)
+    fdwState->key_table_min = 0;
+  else if (fdwState_o->key_table_min > fdwState_i->key_table_min)
+    fdwState->key_table_min = fdwState_o->key_table_min;
+  else
+    fdwState->key_table_min = fdwState_i->key_table_min;
+
+  /* bind constants if either side wants stable statement texts */
+  fdwState->bind_constants = fdwState_o->bind_constants || fdwState_i->bind_constants;
 
   /* copy outerrel's infomation to fdwstate */
   fdwState->dbserver = fdwState_o->dbserver;
@@ -318,6 +343,7 @@ bool foreign_join_ok (PlannerInfo * root, RelOptInfo * joinrel, JoinType jointyp
   }
 
   fdwState->db2Table->npgcols = fdwState->db2Table->ncols;
+  buildAttrMap (fdwState->db2Table);
 
   db2Debug1("< foreign_join_ok");
   return true;
@@ -1,6 +1,11 @@
 #include <postgres.h>
+#include <access/skey.h>
+#include <nodes/makefuncs.h>
 #include <nodes/nodeFuncs.h>
 #include <optimizer/pathnode.h>
+#include <optimizer/paths.h>
+#include <optimizer/restrictinfo.h>
+#include <utils/lsyscache.h>
 #if PG_VERSION_NUM < 120000
 #include <nodes/relation.h>
 #include <optimizer/var.h>
@@ -15,87 +20,32 @@
 
 /** external prototypes */
 extern void         db2Debug1                 (const char* message, ...);
+extern void         db2Debug2                 (const char* message, ...);
 extern char*        deparseExpr               (DB2Session* session, RelOptInfo * foreignrel, Expr* expr, const DB2Table* db2Table, List** params);
+extern bool         collationIsCompatible     (RelOptInfo* foreignrel, Expr* expr, Oid collid, const DB2Table* db2Table);
+extern int          db2ColumnIndex            (const DB2Table* db2Table, int attnum);
 
 /** local prototypes */
 void  db2GetForeignPaths  (PlannerInfo* root, RelOptInfo* baserel, Oid foreigntableid);
 Expr* find_em_expr_for_rel(EquivalenceClass * ec, RelOptInfo * rel);
+List* getUsefulPathkeys   (PlannerInfo* root, RelOptInfo* baserel);
+char* deparseOrderBy      (RelOptInfo* baserel, DB2FdwState* fdwState, List* pathkeys);
+void  addParameterizedPaths(PlannerInfo* root, RelOptInfo* baserel, DB2FdwState* fdwState);
+int   isIndexedEquality   (RestrictInfo* rinfo, RelOptInfo* baserel, DB2Table* db2Table);
+bool  ec_member_matches_column(PlannerInfo* root, RelOptInfo* rel, EquivalenceClass* ec, EquivalenceMember* em, void* arg);
 
 /** db2GetForeignPaths
- *   Create a ForeignPath node and add it as only possible path.
+ *   Create a ForeignPath node for a scan of the whole table, sorted
+ *   ForeignPath nodes for each useful sort order that DB2 can produce,
+ *   and parameterized ForeignPath nodes for index lookups by join clauses.
+ *   The ORDER BY clause of a sorted path is kept in its fdw_private.
  */
 void db2GetForeignPaths(PlannerInfo* root, RelOptInfo* baserel, Oid foreigntableid) {
   DB2FdwState* fdwState = (DB2FdwState*) baserel->fdw_private;
-
-  /*
-   * Determine whether we can potentially push query pathkeys to the remote
-   * side, avoiding a local sort.
-   */
-  StringInfoData orderedquery;
-  List*          usable_pathkeys = NIL;
-  ListCell*      cell;
-  char*          delim = " ";
+  ListCell*    cell;
 
   db2Debug1("> db2GetForeignPaths");
-  initStringInfo (&orderedquery);
-
-  foreach (cell, root->query_pathkeys) {
-    PathKey*           pathkey    = (PathKey *) lfirst (cell);
-    EquivalenceClass*  pathkey_ec = pathkey->pk_eclass;
-    Expr*              em_expr    = NULL;
-    char*              sort_clause;
-    Oid                em_type;
-    bool               can_pushdown;
-
-    /** deparseExpr would detect volatile expressions as well, but
-     * ec_has_volatile saves some cycles.
-     */
-    can_pushdown = !pathkey_ec->ec_has_volatile && ((em_expr = find_em_expr_for_rel (pathkey_ec, baserel)) != NULL);
-
-    if (can_pushdown) {
-      em_type = exprType ((Node *) em_expr);
-
-      /* expressions of a type different from this are not safe to push down into ORDER BY clauses */
-      if (em_type != INT8OID   && em_type != INT2OID    && em_type  != INT4OID    && em_type != OIDOID       &&  em_type != FLOAT4OID
-      &&  em_type != FLOAT8OID && em_type != NUMERICOID && em_type  != DATEOID    && em_type != TIMESTAMPOID && em_type  != TIMESTAMPTZOID
-      &&  em_type != TIMEOID   && em_type != TIMETZOID  &&  em_type != INTERVALOID)
-        can_pushdown = false;
-    }
-
-    if (can_pushdown && ((sort_clause = deparseExpr (fdwState->session, baserel, em_expr, fdwState->db2Table, &(fdwState->params))) != NULL)) {
-      /* keep usable_pathkeys for later use. */
-      usable_pathkeys = lappend (usable_pathkeys, pathkey);
-
-      /* create orderedquery */
-      appendStringInfoString (&orderedquery, delim);
-      appendStringInfoString (&orderedquery, sort_clause);
-      delim = ", ";
-
-      #if PG_VERSION_NUM >= 180000
-      appendStringInfoString (&orderedquery, (pathkey->pk_cmptype == COMPARE_LT) ? " ASC" : " DESC");
-      #else
-      appendStringInfoString (&orderedquery, (pathkey->pk_strategy == BTLessStrategyNumber) ? " ASC" : " DESC");
-      #endif
-      appendStringInfoString (&orderedquery, (pathkey->pk_nulls_first) ? " NULLS FIRST" : " NULLS LAST");
-    } else {
-      /*
-       * The planner and executor don't have any clever strategy for
-       * taking data sorted by a prefix of the query's pathkeys and
-       * getting it to be sorted by all of those pathekeys.  We'll just
-       * end up resorting the entire data set.  So, unless we can push
-       * down all of the query pathkeys, forget it.
-       */
-      list_free (usable_pathkeys);
-      usable_pathkeys = NIL;
-      break;
-    }
-  }
-
-  /* set order clause */
-  if (usable_pathkeys != NIL)
-    fdwState->order_clause = orderedquery.data;
-
-  /* add the only path */
+  /* add the unsorted path */
   add_path (baserel, (Path *) create_foreignscan_path (root
                                                       ,baserel
   #if PG_VERSION_NUM >= 90600
@@ -107,7 +57,7 @@ void db2GetForeignPaths(PlannerInfo* root, RelOptInfo* baserel, Oid foreigntable
   #endif  /* PG_VERSION_NUM */
                                                       ,fdwState->startup_cost
                                                       ,fdwState->total_cost
-                                                      ,usable_pathkeys
+                                                      ,NIL   /* no pathkeys */
                                                       ,baserel->lateral_relids
   #if PG_VERSION_NUM >= 90500
                                                       ,NULL  /* no extra plan */
@@ -118,9 +68,306 @@ void db2GetForeignPaths(PlannerInfo* root, RelOptInfo* baserel, Oid foreigntable
                                                       ,NIL
                                                       )
     );
+
+  /*
+   * Add a path for each sort order that can save a local sort, if DB2 can
+   * sort by it. Sorting costs DB2 time before it can return the first row.
+   */
+  foreach (cell, getUsefulPathkeys (root, baserel)) {
+    List* pathkeys    = (List*) lfirst (cell);
+    char* orderClause = deparseOrderBy (baserel, fdwState, pathkeys);
+
+    if (orderClause == NULL)
+      continue;
+    db2Debug2("  sorted path: ORDER BY%s", orderClause);
+    add_path (baserel, (Path *) create_foreignscan_path (root
+                                                        ,baserel
+    #if PG_VERSION_NUM >= 90600
+                                                        ,NULL  /* default pathtarget */
+    #endif  /* PG_VERSION_NUM */
+                                                        ,baserel->rows
+    #if PG_VERSION_NUM >= 180000
+                                                        ,0  /* no disabled plan nodes */
+    #endif  /* PG_VERSION_NUM */
+                                                        ,fdwState->total_cost * DB2_SORT_MULTIPLIER - (fdwState->total_cost - fdwState->startup_cost)
+                                                        ,fdwState->total_cost * DB2_SORT_MULTIPLIER
+                                                        ,pathkeys
+                                                        ,baserel->lateral_relids
+    #if PG_VERSION_NUM >= 90500
+                                                        ,NULL  /* no extra plan */
+    #endif  /* PG_VERSION_NUM */
+    #if PG_VERSION_NUM >= 170000
+                                                        ,NIL   /* no fdw_restrictinfo */
+    #endif  /* PG_VERSION_NUM */
+                                                        ,list_make1 (makeString (orderClause))
+                                                        )
+      );
+  }
+
+  /* add paths that look up rows by the values of other relations */
+  addParameterizedPaths (root, baserel, fdwState);
   db2Debug1("< db2GetForeignPaths");
 }
 
+/** getUsefulPathkeys
+ *   Return a list of pathkey lists the scan result could usefully be sorted by:
+ *   the query's ORDER BY, the GROUP BY clause, and for each equivalence class
+ *   that joins this relation with another one, the single key a merge join
+ *   on it would need.
+ */
+List* getUsefulPathkeys (PlannerInfo* root, RelOptInfo* baserel) {
+  List*     result = NIL;
+  ListCell* cell;
+
+  db2Debug1("> getUsefulPathkeys");
+  if (root->query_pathkeys != NIL)
+    result = lappend (result, root->query_pathkeys);
+  if (root->group_pathkeys != NIL && !list_member (result, root->group_pathkeys))
+    result = lappend (result, root->group_pathkeys);
+#if PG_VERSION_NUM >= 90600
+  /* merge join keys */
+  if (baserel->has_eclass_joins) {
+    foreach (cell, root->eq_classes) {
+      EquivalenceClass* ec = (EquivalenceClass*) lfirst (cell);
+      ListCell*         lm;
+      bool              joins = false;
+      PathKey*          pathkey;
+      List*             pathkeys;
+
+      if (ec->ec_has_volatile || ec->ec_has_const || list_length (ec->ec_members) < 2 || !bms_is_member (baserel->relid, ec->ec_relids))
+        continue;
+      if (find_em_expr_for_rel (ec, baserel) == NULL)
+        continue;
+      /* the class must have a member of another relation */
+      foreach (lm, ec->ec_members) {
+        EquivalenceMember* em = (EquivalenceMember*) lfirst (lm);
+
+        if (!em->em_is_const && !bms_is_empty (em->em_relids) && !bms_is_subset (em->em_relids, baserel->relids))
+          joins = true;
+      }
+      if (!joins)
+        continue;
+#if PG_VERSION_NUM >= 180000
+      pathkey  = make_canonical_pathkey (root, ec, linitial_oid (ec->ec_opfamilies), COMPARE_LT, false);
+#else
+      pathkey  = make_canonical_pathkey (root, ec, linitial_oid (ec->ec_opfamilies), BTLessStrategyNumber, false);
+#endif /* PG_VERSION_NUM */
+      pathkeys = list_make1 (pathkey);
+      /* already covered if an ORDER BY or GROUP BY starts with it */
+      if (!list_member (result, pathkeys))
+        result = lappend (result, pathkeys);
+    }
+  }
+#endif /* PG_VERSION_NUM */
+  db2Debug1("< getUsefulPathkeys - returns: %d lists", list_length (result));
+  return result;
+}
+
+/** deparseOrderBy
+ *   Return the ORDER BY clause (without the keywords) for "pathkeys",
+ *   or NULL if not all of them can be sorted by in DB2.
+ *   The planner and executor don't have any clever strategy for taking
+ *   data sorted by a prefix of the pathkeys and getting it to be sorted
+ *   by all of them, so a prefix is of no use.
+ */
+char* deparseOrderBy (RelOptInfo* baserel, DB2FdwState* fdwState, List* pathkeys) {
+  StringInfoData orderedquery;
+  ListCell*      cell;
+  char*          delim = " ";
+
+  db2Debug1("> deparseOrderBy");
+  initStringInfo (&orderedquery);
+  foreach (cell, pathkeys) {
+    PathKey*          pathkey    = (PathKey *) lfirst (cell);
+    EquivalenceClass* pathkey_ec = pathkey->pk_eclass;
+    Expr*             em_expr    = NULL;
+    char*             sort_clause;
+    Oid               em_type;
+
+    /** deparseExpr would detect volatile expressions as well, but
+     * ec_has_volatile saves some cycles.
+     */
+    if (pathkey_ec->ec_has_volatile || (em_expr = find_em_expr_for_rel (pathkey_ec, baserel)) == NULL) {
+      db2Debug1("< deparseOrderBy - returns: NULL");
+      return NULL;
+    }
+    em_type = exprType ((Node *) em_expr);
+    /* expressions of a type different from this are not safe to push down into ORDER BY clauses */
+    if (em_type != INT8OID   && em_type != INT2OID    && em_type  != INT4OID    && em_type != OIDOID       &&  em_type != FLOAT4OID
+    &&  em_type != FLOAT8OID && em_type != NUMERICOID && em_type  != DATEOID    && em_type != TIMESTAMPOID && em_type  != TIMESTAMPTZOID
+    &&  em_type != TIMEOID   && em_type != TIMETZOID  &&  em_type != INTERVALOID
+    /* strings only if DB2 sorts them like PostgreSQL */
+    && !((em_type == TEXTOID || em_type == VARCHAROID || em_type == BPCHAROID)
+         && collationIsCompatible (baserel, em_expr, pathkey_ec->ec_collation, fdwState->db2Table))) {
+      db2Debug1("< deparseOrderBy - returns: NULL");
+      return NULL;
+    }
+    if ((sort_clause = deparseExpr (fdwState->session, baserel, em_expr, fdwState->db2Table, &(fdwState->params))) == NULL) {
+      db2Debug1("< deparseOrderBy - returns: NULL");
+      return NULL;
+    }
+    appendStringInfoString (&orderedquery, delim);
+    appendStringInfoString (&orderedquery, sort_clause);
+    delim = ", ";
+#if PG_VERSION_NUM >= 180000
+    appendStringInfoString (&orderedquery, (pathkey->pk_cmptype == COMPARE_LT) ? " ASC" : " DESC");
+#else
+    appendStringInfoString (&orderedquery, (pathkey->pk_strategy == BTLessStrategyNumber) ? " ASC" : " DESC");
+#endif
+    appendStringInfoString (&orderedquery, (pathkey->pk_nulls_first) ? " NULLS FIRST" : " NULLS LAST");
+  }
+  db2Debug1("< deparseOrderBy - returns: '%s'", orderedquery.data);
+  return orderedquery.data;
+}
+
+/** addParameterizedPaths
+ *   Add parameterized paths for join clauses that can be pushed down,
+ *   so that a nested loop can look up the DB2 rows for each outer row.
+ *   Only join clauses that compare a column leading a DB2 index (or a
+ *   column with the "key" option) for equality are considered, since
+ *   without an index every lookup would scan the remote table.
+ *   A lookup costs a round trip plus the rows it returns, the outer
+ *   values are bound as parameters. A lookup by the only column of a
+ *   unique index returns at most one row.
+ */
+void addParameterizedPaths (PlannerInfo* root, RelOptInfo* baserel, DB2FdwState* fdwState) {
+  List*     candidates = NIL;
+  List*     ppi_list   = NIL;
+  List*     params     = NIL;
+  ListCell* cell;
+  int       i;
+
+  db2Debug1("> addParameterizedPaths");
+  /* join clauses that are not part of an equivalence class */
+  foreach (cell, baserel->joininfo) {
+    RestrictInfo* rinfo = (RestrictInfo*) lfirst (cell);
+    if (!join_clause_is_movable_to (rinfo, baserel))
+      continue;
+    if (!isIndexedEquality (rinfo, baserel, fdwState->db2Table))
+      continue;
+    if (deparseExpr (NULL, baserel, rinfo->clause, fdwState->db2Table, &params) == NULL)
+      continue;
+    candidates = lappend (candidates, rinfo);
+  }
+  /* equality join clauses derived from equivalence classes on indexed columns */
+  if (baserel->has_eclass_joins) {
+    for (i = 0; i < fdwState->db2Table->ncols; ++i) {
+      DB2Column* col = fdwState->db2Table->cols[i];
+      List*      clauses;
+      if (col->pgattnum <= 0 || !(col->colIndexed || col->pkey))
+        continue;
+      clauses = generate_implied_equalities_for_column (root, baserel, ec_member_matches_column, (void*) col, baserel->lateral_referencers);
+      foreach (cell, clauses) {
+        RestrictInfo* rinfo = (RestrictInfo*) lfirst (cell);
+        if (!join_clause_is_movable_to (rinfo, baserel))
+          continue;
+        if (deparseExpr (NULL, baserel, rinfo->clause, fdwState->db2Table, &params) == NULL)
+          continue;
+        candidates = lappend (candidates, rinfo);
+      }
+    }
+  }
+  /* collect the distinct parameterizations */
+  foreach (cell, candidates) {
+    RestrictInfo* rinfo          = (RestrictInfo*) lfirst (cell);
+    Relids        required_outer = bms_union (rinfo->clause_relids, baserel->lateral_relids);
+    required_outer = bms_del_member (required_outer, baserel->relid);
+    if (bms_is_empty (required_outer))
+      continue;
+    ppi_list = list_append_unique_ptr (ppi_list, get_baserel_parampathinfo (root, baserel, required_outer));
+  }
+  /* create a path for each of them */
+  foreach (cell, ppi_list) {
+    ParamPathInfo* param_info = (ParamPathInfo*) lfirst (cell);
+    double         rows;
+    Cost           startup    = 100.0;
+    Cost           total;
+    ListCell*      lc;
+
+    /*
+     * A lookup by a unique column returns at most one row. The estimate is
+     * lowered in the ParamPathInfo, which all paths of this parameterization
+     * share, so that they agree on the number of rows.
+     */
+    foreach (lc, param_info->ppi_clauses) {
+      if (isIndexedEquality ((RestrictInfo*) lfirst (lc), baserel, fdwState->db2Table) == 2)
+        param_info->ppi_rows = Min (param_info->ppi_rows, 1.0);
+    }
+    rows  = clamp_row_est (param_info->ppi_rows);
+    total = startup + rows * 10.0;
+
+    db2Debug2("  parameterized path: %d clauses, %.0f rows, cost %.2f..%.2f", list_length (param_info->ppi_clauses), rows, startup, total);
+    add_path (baserel, (Path *) create_foreignscan_path (root
+                                                        ,baserel
+    #if PG_VERSION_NUM >= 90600
+                                                        ,NULL  /* default pathtarget */
+    #endif  /* PG_VERSION_NUM */
+                                                        ,rows
+    #if PG_VERSION_NUM >= 180000
+                                                        ,0  /* no disabled plan nodes */
+    #endif  /* PG_VERSION_NUM */
+                                                        ,startup
+                                                        ,total
+                                                        ,NIL   /* no pathkeys */
+                                                        ,param_info->ppi_req_outer
+    #if PG_VERSION_NUM >= 90500
+                                                        ,NULL  /* no extra plan */
+    #endif  /* PG_VERSION_NUM */
+    #if PG_VERSION_NUM >= 170000
+                                                        ,NIL   /* no fdw_restrictinfo */
+    #endif  /* PG_VERSION_NUM */
+                                                        ,NIL
+                                                        )
+      );
+  }
+  db2Debug1("< addParameterizedPaths");
+}
+
+/** isIndexedEquality
+ *   Return nonzero if the clause is an equality comparison between a column
+ *   of "baserel" that leads a DB2 index (or is a "key" column) and something else:
+ *   2 if the column is the only column of a unique index, 1 otherwise.
+ */
+int isIndexedEquality (RestrictInfo* rinfo, RelOptInfo* baserel, DB2Table* db2Table) {
+  OpExpr*   oper   = (OpExpr*) rinfo->clause;
+  int       result = 0;
+  ListCell* cell;
+  int       index;
+
+  if (!IsA (oper, OpExpr) || list_length (oper->args) != 2)
+    return 0;
+  if (!op_mergejoinable (oper->opno, exprType ((Node*) linitial (oper->args))))
+    return 0;
+  foreach (cell, oper->args) {
+    Expr* arg = (Expr*) lfirst (cell);
+    while (arg != NULL && IsA (arg, RelabelType))
+      arg = ((RelabelType*) arg)->arg;
+    if (arg == NULL || !IsA (arg, Var) || ((Var*) arg)->varno != baserel->relid || ((Var*) arg)->varlevelsup != 0)
+      continue;
+    if ((index = db2ColumnIndex (db2Table, ((Var*) arg)->varattno)) >= 0) {
+      DB2Column* col = db2Table->cols[index];
+
+      if (col->colIndexed > result)
+        result = col->colIndexed;
+      else if (result == 0 && col->pkey)
+        result = 1;
+    }
+  }
+  return result;
+}
+
+/** ec_member_matches_column
+ *   Callback for generate_implied_equalities_for_column:
+ *   does the equivalence member match the DB2Column passed as "arg"?
+ */
+bool ec_member_matches_column (PlannerInfo* root, RelOptInfo* rel, EquivalenceClass* ec, EquivalenceMember* em, void* arg) {
+  DB2Column* col  = (DB2Column*) arg;
+  Expr*      expr = em->em_expr;
+  while (expr != NULL && IsA (expr, RelabelType))
+    expr = ((RelabelType*) expr)->arg;
+  return (expr != NULL && IsA (expr, Var) && ((Var*) expr)->varno == rel->relid && ((Var*) expr)->varattno == col->pgattnum && ((Var*) expr)->varlevelsup == 0);
+}
+
 #ifndef OLD_FDW_API
 /** find_em_expr_for_rel
  *   Find an equivalence class member expression, all of whose Vars come from
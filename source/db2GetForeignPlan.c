@@ -4,9 +4,18 @@
 #else
 #include <common/md5.h>
 #endif /* PG_VERSION_NUM */
+#include <access/htup_details.h>
+#include <access/skey.h>
+#include <catalog/pg_namespace.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <optimizer/clauses.h>
+#include <optimizer/cost.h>
 #include <optimizer/planmain.h>
 #include <optimizer/tlist.h>
 #include <parser/parsetree.h>
+#include <utils/lsyscache.h>
+#include <utils/typcache.h>
 #if PG_VERSION_NUM < 120000
 #include <nodes/relation.h>
 #include <optimizer/var.h>
@@ -23,11 +32,15 @@
 extern List*        serializePlanData         (DB2FdwState* fdwState);
 extern char*        deparseExpr               (DB2Session* session, RelOptInfo * foreignrel, Expr* expr, const DB2Table* db2Table, List** params);
 extern void         checkDataType             (short db2type, int scale, Oid pgtype, const char* tablename, const char* colname);
+extern void         buildAttrMap              (DB2Table* db2Table);
+extern int          db2ColumnIndex            (const DB2Table* db2Table, int attnum);
+extern bool         setResultColumn           (RelOptInfo* baserel, const DB2Table* db2Table, Expr* expr, Oid type, int maxchars, DB2Column* col);
+extern void*        db2alloc                  (const char* type, size_t size);
+extern char*        db2strdup                 (const char* source);
 extern void         db2Debug1                 (const char* message, ...);
 extern void         db2Debug2                 (const char* message, ...);
 extern void         db2Debug3                 (const char* message, ...);
 extern void         db2free                   (void* p);
-extern char*        db2strdup                 (const char* p);
 
 /** local prototypes */
 const char*  get_jointype_name     (JoinType jointype);
@@ -36,12 +49,34 @@ void         getUsedColumns        (Expr* expr, DB2Table* db2Table, int foreignr
 void         appendConditions      (List* exprs, StringInfo buf, RelOptInfo* joinrel, List** params_list);
 char*        createQuery           (DB2FdwState* fdwState, RelOptInfo* foreignrel, bool modify, List* query_pathkeys);
 void         deparseFromExprForRel (DB2FdwState* fdwState, StringInfo buf, RelOptInfo* foreignrel, List** params_list);
+void         addWhereCondition     (DB2FdwState* fdwState, const char* where);
+void         addJoinKeyFilters     (PlannerInfo* root, RelOptInfo* baserel, DB2FdwState* fdwState);
+Expr*        deriveKeyFilter       (Expr* clause, Expr* otherexpr, Expr* ourexpr, List* opfamilies);
+bool         isKeyFilterValue      (Node* node);
+Var*         lookupKeyColumn       (Expr* clause, RelOptInfo* baserel, Expr** outerexpr);
+void         addFullScanQuery      (DB2FdwState* fdwState, RelOptInfo* foreignrel, ForeignPath* best_path, List* keys, List* outers, char* base_where);
+List*        addRemoteExpressions  (PlannerInfo* root, RelOptInfo* foreignrel, DB2FdwState* fdwState, List* tlist, List* local_exprs);
+List*        addColumnProjection   (RelOptInfo* foreignrel, DB2FdwState* fdwState, List* tlist, List* local_exprs);
+List*        buildProjection       (RelOptInfo* foreignrel, DB2FdwState* fdwState, List* vars, List* exprs, List* sqls);
+int          exprMaxChars          (Expr* expr);
 ForeignScan* db2GetForeignPlan     (PlannerInfo* root, RelOptInfo* foreignrel, Oid foreigntableid, ForeignPath* best_path, List* tlist, List* scan_clauses , Plan* outer_plan);
 
 /** db2GetForeignPlan
  *   Construct a ForeignScan node containing the serialized DB2FdwState,
  *   the RestrictInfo clauses not handled entirely by DB2 and the list
  *   of parameters we need for execution.
+ *   For a parameterized path, the join clauses it is parameterized by are
+ *   added to the remote WHERE clause, the outer values become parameters.
+ *   Otherwise, conditions derived from the restrictions of join partners
+ *   are added (see addJoinKeyFilters).
+ *   If the join clauses of a parameterized path are all equalities between
+ *   a column and an outer value, the query without them is kept as well,
+ *   so that the scan can switch to fetching the full result once
+ *   (see addFullScanQuery).
+ *   Expressions of the SELECT list are computed by DB2 if that reduces
+ *   the data to transfer (see addRemoteExpressions).
+ *   Otherwise, if the query needs only some of the columns, the scan returns
+ *   tuples of these columns only (see addColumnProjection).
  */
 ForeignScan* db2GetForeignPlan (PlannerInfo* root, RelOptInfo* foreignrel, Oid foreigntableid, ForeignPath* best_path, List* tlist, List* scan_clauses , Plan* outer_plan) {
   DB2FdwState* fdwState    = (DB2FdwState*) foreignrel->fdw_private;
@@ -52,7 +87,13 @@ ForeignScan* db2GetForeignPlan (PlannerInfo* root, RelOptInfo* foreignrel, Oid f
                has_trigger;
   Relation     rel;
   Index        scan_relid;                               /* will be 0 for join relations */
-  List*        local_exprs    = fdwState->local_conds;
+  List*        local_exprs    = list_copy (fdwState->local_conds);
+  ListCell*    cell;
+  char*        where;
+  char*        base_where     = NULL;
+  List*        keys           = NIL;
+  List*        outers         = NIL;
+  bool         all_keys       = true;
   List*        fdw_scan_tlist = NIL;
   ForeignScan* result         = NULL;
 
@@ -61,6 +102,8 @@ ForeignScan* db2GetForeignPlan (PlannerInfo* root, RelOptInfo* foreignrel, Oid f
   if (IS_SIMPLE_REL (foreignrel)) {
     /* for base relations, set scan_relid as the relid of the relation */
     scan_relid = foreignrel->relid;
+    /* a sorted path carries its ORDER BY clause */
+    fdwState->order_clause = (best_path->fdw_private != NIL) ? strVal (linitial (best_path->fdw_private)) : NULL;
     /* check if the foreign scan is for an UPDATE or DELETE */
 #if PG_VERSION_NUM < 140000
     if (foreignrel->relid == root->parse->resultRelation && (root->parse->commandType == CMD_UPDATE || root->parse->commandType == CMD_DELETE)) {
@@ -101,15 +144,63 @@ ForeignScan* db2GetForeignPlan (PlannerInfo* root, RelOptInfo* foreignrel, Oid f
         }
       }
     }
+    /*
+     * scan_clauses contain the restriction clauses, which have been classified
+     * in db2GetForeignRelSize, and for a parameterized path the join clauses
+     * that are to be enforced by the scan. Push down the latter if possible,
+     * the Vars of the outer relations are replaced by parameters.
+     * The join clauses belong to this path only, so they are added to a copy
+     * of the relation's state, whose WHERE clause and parameters stay unchanged.
+     */
+    if (best_path->path.param_info != NULL) {
+      DB2FdwState* copy = (DB2FdwState*) db2alloc ("parameterized fdw_state", sizeof (DB2FdwState));
+
+      memcpy (copy, fdwState, sizeof (DB2FdwState));
+      copy->params = list_copy (fdwState->params);
+      fdwState     = copy;
+    }
+    base_where = fdwState->where_clause;
+    foreach (cell, scan_clauses) {
+      RestrictInfo* rinfo = (RestrictInfo*) lfirst (cell);
+      if (list_member_ptr (foreignrel->baserestrictinfo, rinfo))
+        continue;
+      where = deparseExpr (fdwState->session, foreignrel, rinfo->clause, fdwState->db2Table, &(fdwState->params));
+      if (where != NULL) {
+        Expr* outerexpr = NULL;
+        Var*  key       = lookupKeyColumn (rinfo->clause, foreignrel, &outerexpr);
+
+        addWhereCondition (fdwState, where);
+        db2Debug2("  parameterized condition pushed down: '%s'", where);
+        /* remember the join key, it must be fetched for the full scan */
+        if (key != NULL) {
+          keys   = lappend (keys, key);
+          outers = lappend (outers, outerexpr);
+          getUsedColumns ((Expr*) key, fdwState->db2Table, foreignrel->relid);
+        } else {
+          all_keys = false;
+        }
+      } else {
+        local_exprs = lappend (local_exprs, rinfo->clause);
+      }
+    }
+    /* filter the join keys by the restrictions of their join partners */
+    if (best_path->path.param_info == NULL)
+      addJoinKeyFilters (root, foreignrel, fdwState);
+    /* let DB2 compute expressions of the SELECT list if that pays off */
+    if (!for_update && !has_trigger && best_path->path.param_info == NULL)
+      fdw_scan_tlist = addRemoteExpressions (root, foreignrel, fdwState, tlist, local_exprs);
+    /* the join keys of a parameterized scan refer to the table's tuple */
+    if (fdw_scan_tlist == NIL && !for_update && !has_trigger && keys == NIL)
+      fdw_scan_tlist = addColumnProjection (foreignrel, fdwState, tlist, local_exprs);
   } else {
-    /* we have a join relation, so set scan_relid to 0 */
+    /* we have a join or window relation, so set scan_relid to 0 */
     scan_relid = 0;
     /*
      * create_scan_plan() and create_foreignscan_plan() pass
      * rel->baserestrictinfo + parameterization clauses through
-     * scan_clauses. For a join rel->baserestrictinfo is NIL and we are
-     * not considering parameterization right now, so there should be no
-     * scan_clauses for a joinrel.
+     * scan_clauses. For a join or upper rel->baserestrictinfo is NIL and we
+     * are not considering parameterization right now, so there should be no
+     * scan_clauses for them.
      */
     Assert (!scan_clauses);
     /* Build the list of columns to be fetched from the foreign server. */
@@ -142,6 +233,9 @@ ForeignScan* db2GetForeignPlan (PlannerInfo* root, RelOptInfo* foreignrel, Oid f
   /* create remote query */
   fdwState->query = createQuery (fdwState, foreignrel, for_update, best_path->path.pathkeys);
   db2Debug2("  db2_fdw: remote query is: %s", fdwState->query);
+  /* the alternative to many lookups is a single scan */
+  if (fdwState->rescan_cache && !for_update && all_keys && keys != NIL)
+    addFullScanQuery (fdwState, foreignrel, best_path, keys, outers, base_where);
   /* get PostgreSQL column data types, check that they match DB2's */
   for (i = 0; i < fdwState->db2Table->ncols; ++i) {
     if (fdwState->db2Table->cols[i]->used) {
@@ -168,6 +262,489 @@ ForeignScan* db2GetForeignPlan (PlannerInfo* root, RelOptInfo* foreignrel, Oid f
   return result;
 }
 
+/** addWhereCondition
+ *   Append the deparsed condition "where" to the WHERE clause of the remote query.
+ */
+void addWhereCondition (DB2FdwState* fdwState, const char* where) {
+  StringInfoData where_clause;
+
+  initStringInfo (&where_clause);
+  appendStringInfo (&where_clause, "%s %s %s", (fdwState->where_clause != NULL) ? fdwState->where_clause : "", (fdwState->where_clause != NULL && fdwState->where_clause[0] != '\0') ? "AND" : "WHERE", where);
+  fdwState->where_clause = where_clause.data;
+}
+
+/** addJoinKeyFilters
+ *   If a column of the foreign table is joined by equality with a column of
+ *   another relation, every restriction of that column to a range or a list
+ *   of values also holds for our column in each join result row.
+ *   Such derived conditions are pushed down, so that DB2 does not send rows
+ *   that cannot find a join partner. Date-range and id-range restrictions on
+ *   the local side of a hash or merge join thus shrink the remote scan.
+ *   Parameters in the conditions are bound when the query is executed.
+ */
+void addJoinKeyFilters (PlannerInfo* root, RelOptInfo* baserel, DB2FdwState* fdwState) {
+  ListCell* lc;
+  List*     added = NIL;
+
+  db2Debug1("> addJoinKeyFilters");
+  foreach (lc, root->eq_classes) {
+    EquivalenceClass* ec      = (EquivalenceClass*) lfirst (lc);
+    Expr*             ourexpr = NULL;
+    ListCell*         lm;
+
+    /* equalities with constants are handled by the planner already */
+    if (ec->ec_has_const || ec->ec_has_volatile || list_length (ec->ec_members) < 2 || !bms_is_member (baserel->relid, ec->ec_relids))
+      continue;
+#if PG_VERSION_NUM < 160000
+    if (ec->ec_below_outer_join)
+      continue;
+#endif /* PG_VERSION_NUM */
+    /* find the column of our relation */
+    foreach (lm, ec->ec_members) {
+      EquivalenceMember* em = (EquivalenceMember*) lfirst (lm);
+
+      if (IsA (em->em_expr, Var) && ((Var*) em->em_expr)->varno == baserel->relid && bms_equal (em->em_relids, baserel->relids)) {
+        ourexpr = em->em_expr;
+        break;
+      }
+    }
+    if (ourexpr == NULL)
+      continue;
+    /* look at the restrictions of the other columns */
+    foreach (lm, ec->ec_members) {
+      EquivalenceMember* em = (EquivalenceMember*) lfirst (lm);
+      RelOptInfo*        otherrel;
+      ListCell*          lr;
+
+      if (em->em_is_const || !IsA (em->em_expr, Var) || ((Var*) em->em_expr)->varlevelsup != 0 || ((Var*) em->em_expr)->varno == baserel->relid)
+        continue;
+      if (exprType ((Node*) em->em_expr) != exprType ((Node*) ourexpr) || exprCollation ((Node*) em->em_expr) != exprCollation ((Node*) ourexpr))
+        continue;
+      otherrel = root->simple_rel_array[((Var*) em->em_expr)->varno];
+      if (otherrel == NULL)
+        continue;
+      foreach (lr, otherrel->baserestrictinfo) {
+        RestrictInfo* rinfo   = (RestrictInfo*) lfirst (lr);
+        Expr*         derived = deriveKeyFilter (rinfo->clause, em->em_expr, ourexpr, ec->ec_opfamilies);
+        char*         where;
+
+        if (derived == NULL)
+          continue;
+        where = deparseExpr (fdwState->session, baserel, derived, fdwState->db2Table, &(fdwState->params));
+        /* the same condition might come from several join partners */
+        if (where != NULL && !list_member (added, makeString (where))) {
+          added = lappend (added, makeString (where));
+          addWhereCondition (fdwState, where);
+          db2Debug2("  join key filter pushed down: '%s'", where);
+        }
+      }
+    }
+  }
+  db2Debug1("< addJoinKeyFilters");
+}
+
+/** deriveKeyFilter
+ *   If "clause" compares "otherexpr" with a value by an ordering operator,
+ *   or with a list of values by equality, in one of "opfamilies",
+ *   return a copy of the clause with "otherexpr" replaced by "ourexpr".
+ *   Returns NULL otherwise.
+ */
+Expr* deriveKeyFilter (Expr* clause, Expr* otherexpr, Expr* ourexpr, List* opfamilies) {
+  ListCell* lc;
+
+  if (IsA (clause, OpExpr) && list_length (((OpExpr*) clause)->args) == 2) {
+    OpExpr* op       = (OpExpr*) clause;
+    bool    varleft;
+    bool    ordering = false;
+
+    if (equal (linitial (op->args), otherexpr) && isKeyFilterValue (lsecond (op->args)))
+      varleft = true;
+    else if (equal (lsecond (op->args), otherexpr) && isKeyFilterValue (linitial (op->args)))
+      varleft = false;
+    else
+      return NULL;
+    foreach (lc, opfamilies) {
+      int strategy = get_op_opfamily_strategy (op->opno, lfirst_oid (lc));
+
+      if (strategy == BTLessStrategyNumber || strategy == BTLessEqualStrategyNumber || strategy == BTGreaterEqualStrategyNumber || strategy == BTGreaterStrategyNumber)
+        ordering = true;
+    }
+    if (!ordering)
+      return NULL;
+    op = (OpExpr*) copyObject (op);
+    if (varleft)
+      linitial (op->args) = copyObject (ourexpr);
+    else
+      lsecond (op->args) = copyObject (ourexpr);
+    return (Expr*) op;
+  }
+  if (IsA (clause, ScalarArrayOpExpr)) {
+    ScalarArrayOpExpr* arrayoper = (ScalarArrayOpExpr*) clause;
+    bool               equality  = false;
+
+    if (!arrayoper->useOr || !equal (linitial (arrayoper->args), otherexpr) || !isKeyFilterValue (lsecond (arrayoper->args)))
+      return NULL;
+    foreach (lc, opfamilies) {
+      if (get_op_opfamily_strategy (arrayoper->opno, lfirst_oid (lc)) == BTEqualStrategyNumber)
+        equality = true;
+    }
+    if (!equality)
+      return NULL;
+    arrayoper = (ScalarArrayOpExpr*) copyObject (arrayoper);
+    linitial (arrayoper->args) = copyObject (ourexpr);
+    return (Expr*) arrayoper;
+  }
+  return NULL;
+}
+
+/** isKeyFilterValue
+ *   A value for a join key filter must not depend on any relation
+ *   and must not change during the scan.
+ */
+bool isKeyFilterValue (Node* node) {
+  return !contain_var_clause (node) && !contain_volatile_functions (node) && !contain_subplans (node);
+}
+
+/** lookupKeyColumn
+ *   If "clause" compares a column of "baserel" with a column of another
+ *   relation by the default equality operator of the column's data type,
+ *   and that type can be hashed, return the Var of our column and set
+ *   "outerexpr" to the other one. Returns NULL otherwise.
+ */
+Var* lookupKeyColumn (Expr* clause, RelOptInfo* baserel, Expr** outerexpr) {
+  OpExpr*         op = (OpExpr*) clause;
+  Var*            key;
+  Var*            outer;
+  TypeCacheEntry* typentry;
+
+  if (!IsA (clause, OpExpr) || list_length (op->args) != 2 || !IsA (linitial (op->args), Var) || !IsA (lsecond (op->args), Var))
+    return NULL;
+  key   = (Var*) linitial (op->args);
+  outer = (Var*) lsecond (op->args);
+  if (key->varno != baserel->relid) {
+    key   = (Var*) lsecond (op->args);
+    outer = (Var*) linitial (op->args);
+  }
+  if (key->varno != baserel->relid || outer->varno == baserel->relid || key->varlevelsup != 0 || key->varattno < 1)
+    return NULL;
+  if (key->vartype != outer->vartype || key->varcollid != outer->varcollid)
+    return NULL;
+  typentry = lookup_type_cache (key->vartype, TYPECACHE_EQ_OPR | TYPECACHE_HASH_PROC);
+  if (op->opno != typentry->eq_opr || !OidIsValid (typentry->hash_proc))
+    return NULL;
+  *outerexpr = (Expr*) outer;
+  return key;
+}
+
+/** addFullScanQuery
+ *   A parameterized scan sends a query to DB2 for every outer row.
+ *   If the number of outer rows was underestimated, fetching the complete
+ *   result once and looking up the join keys locally is cheaper.
+ *   Store the query without the parameterized join conditions "keys" = "outers"
+ *   (that is, with WHERE clause "base_where") and the attribute numbers of
+ *   the join keys by parameter position, so that the executor can switch.
+ *   The switch happens after as many lookups as the full scan is estimated
+ *   to cost, and only if the full result is expected to fit into work_mem.
+ */
+void addFullScanQuery (DB2FdwState* fdwState, RelOptInfo* foreignrel, ForeignPath* best_path, List* keys, List* outers, char* base_where) {
+  List*     params = fdwState->params;
+  char*     where  = fdwState->where_clause;
+  ListCell* cell;
+  ListCell* lk;
+  double    width;
+  int       i = 0;
+
+  db2Debug1("> addFullScanQuery");
+  /* every parameter must be the outer value of exactly one join key */
+  if (list_length (params) != list_length (keys)) {
+    db2Debug1("< addFullScanQuery - other parameters");
+    return;
+  }
+  forboth (cell, params, lk, outers) {
+    if (lfirst (cell) == NULL || !equal (lfirst (cell), lfirst (lk))) {
+      db2Debug1("< addFullScanQuery - parameters do not match join keys");
+      return;
+    }
+  }
+#if PG_VERSION_NUM < 90600
+  width = foreignrel->width;
+#else
+  width = foreignrel->reltarget->width;
+#endif /* PG_VERSION_NUM */
+  if (foreignrel->rows * (width + MAXALIGN (SizeofMinimalTupleHeader)) > (double) work_mem * 1024.0) {
+    db2Debug1("< addFullScanQuery - result too large for work_mem");
+    return;
+  }
+  /* the query with the restrictions of the relation only */
+  fdwState->where_clause = base_where;
+  fdwState->params       = NIL;
+  fdwState->full_query   = createQuery (fdwState, foreignrel, false, NIL);
+  if (fdwState->params != NIL)
+    fdwState->full_query = NULL;
+  fdwState->where_clause = where;
+  fdwState->params       = params;
+  if (fdwState->full_query == NULL) {
+    db2Debug1("< addFullScanQuery - full scan needs parameters");
+    return;
+  }
+  foreach (cell, keys)
+    fdwState->full_keys = lappend_int (fdwState->full_keys, ((Var*) lfirst (cell))->varattno);
+  /* switch when the lookups so far have cost as much as the full scan */
+  if (best_path->path.total_cost > 0)
+    i = (int) (fdwState->total_cost / best_path->path.total_cost) + 1;
+  fdwState->full_after = Max (i, 2);
+  db2Debug2("  full scan after %d lookups: '%s'", fdwState->full_after, fdwState->full_query);
+  db2Debug1("< addFullScanQuery");
+}
+
+/** addRemoteExpressions
+ *   If the foreign table is the only relation of a query without grouping,
+ *   the scan computes the expressions of the SELECT list, and DB2 can do
+ *   that instead. An expression is pushed down if that is cheaper than
+ *   fetching the columns it needs and computing it locally, that is, if
+ *   the bytes saved by not transferring the columns only it needs, plus
+ *   the local evaluation, outweigh the bytes of its result.
+ *   A row is estimated to cost 10.0 to transfer (see db2GetForeignRelSize),
+ *   which gives the cost of a byte.
+ *   String results are only pushed down if their length is limited, since
+ *   DB2 needs a buffer of that size (see exprMaxChars).
+ *   If an expression is pushed down, the returned target list becomes
+ *   fdw_scan_tlist (see buildProjection). Returns NIL otherwise.
+ */
+List* addRemoteExpressions (PlannerInfo* root, RelOptInfo* foreignrel, DB2FdwState* fdwState, List* tlist, List* local_exprs) {
+  Query*      parse      = root->parse;
+  PathTarget* target;
+  List*       needed     = NIL;    /* columns that have to be fetched */
+  List*       candidates = NIL;    /* expressions DB2 can compute */
+  List*       candvars   = NIL;    /* the columns of each candidate */
+  List*       pushed     = NIL;    /* expressions DB2 computes */
+  List*       sqls       = NIL;    /* their DB2 SQL */
+  List*       result;
+  ListCell*   lc;
+  ListCell*   lv;
+  double      byte_cost;
+
+  db2Debug1("> addRemoteExpressions");
+  /* the scan only computes the final target if there is nothing in between */
+  target = root->upper_targets[UPPERREL_GROUP_AGG];
+  if (target == NULL || parse->commandType != CMD_SELECT || parse->hasAggs || parse->groupClause != NIL || parse->groupingSets != NIL
+  || root->hasHavingQual || parse->hasTargetSRFs || !bms_equal (foreignrel->relids, root->all_baserels)) {
+    db2Debug1("< addRemoteExpressions - returns: NIL");
+    return NIL;
+  }
+  foreach (lc, target->exprs) {
+    Expr* expr   = (Expr*) lfirst (lc);
+    List* vars   = pull_var_clause ((Node*) expr, PVC_INCLUDE_PLACEHOLDERS);
+    bool  remote = !IsA (expr, Var) && !contain_volatile_functions ((Node*) expr);
+
+    foreach (lv, vars) {
+      Var* var = (Var*) lfirst (lv);
+
+      if (!IsA (var, Var) || var->varno != foreignrel->relid || var->varlevelsup != 0 || var->varattno < 1) {
+        db2Debug1("< addRemoteExpressions - returns: NIL");
+        return NIL;
+      }
+    }
+    if (remote) {
+      candidates = lappend (candidates, expr);
+      candvars   = lappend (candvars, list_union (NIL, vars));
+    } else {
+      needed = list_union (needed, vars);
+    }
+  }
+  needed = list_union (needed, pull_var_clause ((Node*) local_exprs, PVC_RECURSE_PLACEHOLDERS));
+  /* a target list that doesn't compute the expressions needs its columns */
+  needed = list_union (needed, pull_var_clause ((Node*) tlist, PVC_RECURSE_PLACEHOLDERS));
+  if (candidates == NIL) {
+    db2Debug1("< addRemoteExpressions - returns: NIL");
+    return NIL;
+  }
+
+  /* decide for each candidate */
+  byte_cost = 10.0 / Max (foreignrel->reltarget->width, 1);
+  forboth (lc, candidates, lv, candvars) {
+    Expr*      expr     = (Expr*) lfirst (lc);
+    List*      vars     = (List*) lfirst (lv);
+    Oid        type     = exprType ((Node*) expr);
+    int        maxchars = exprMaxChars (expr);
+    DB2Column  col;
+    QualCost   cost;
+    double     freed    = 0.0;
+    double     width;
+    char*      sql;
+    ListCell*  lvar;
+
+    memset (&col, 0, sizeof (DB2Column));
+    if ((sql = deparseExpr (fdwState->session, foreignrel, expr, fdwState->db2Table, &(fdwState->params))) == NULL
+    || !setResultColumn (foreignrel, fdwState->db2Table, NULL, type, maxchars, &col)) {
+      needed = list_union (needed, vars);
+      continue;
+    }
+    /* the columns only candidates need, shared among them */
+    foreach (lvar, vars) {
+      Var*      var   = (Var*) lfirst (lvar);
+      int       users = 0;
+      int32     varwidth;
+      ListCell* lother;
+
+      if (list_member (needed, var))
+        continue;
+      foreach (lother, candvars) {
+        if (list_member ((List*) lfirst (lother), var))
+          ++users;
+      }
+      varwidth = foreignrel->attr_widths[var->varattno - foreignrel->min_attr];
+      if (varwidth <= 0)
+        varwidth = get_typavgwidth (var->vartype, var->vartypmod);
+      freed += (double) varwidth / Max (users, 1);
+    }
+    width = get_typavgwidth (type, exprTypmod ((Node*) expr));
+    if (maxchars > 0 && maxchars < width)
+      width = maxchars;
+    cost_qual_eval_node (&cost, (Node*) expr, root);
+    db2Debug2("  expression '%s': %.0f bytes instead of %.0f, local cost %.4f", sql, width, freed, cost.per_tuple);
+    if ((freed - width) * byte_cost + cost.per_tuple > 0.0) {
+      pushed = lappend (pushed, expr);
+      sqls   = lappend (sqls, sql);
+    } else {
+      needed = list_union (needed, vars);
+    }
+  }
+  if (pushed == NIL) {
+    db2Debug1("< addRemoteExpressions - returns: NIL");
+    return NIL;
+  }
+
+  result = buildProjection (foreignrel, fdwState, needed, pushed, sqls);
+  db2Debug1("< addRemoteExpressions - %d expressions pushed down", (result != NIL) ? list_length (pushed) : 0);
+  return result;
+}
+
+/** addColumnProjection
+ *   Let the scan return tuples of the needed columns only, rather than
+ *   tuples of the whole table that are NULL except for these columns.
+ *   That way the work per row depends on the number of columns fetched,
+ *   not on the width of the table.
+ *   The needed columns are those of the target list of the relation, of
+ *   the plan's target list (which may be the physical target list), and
+ *   of the conditions checked locally.
+ *   Returns the target list of the scan, or NIL if there is nothing to save.
+ */
+List* addColumnProjection (RelOptInfo* foreignrel, DB2FdwState* fdwState, List* tlist, List* local_exprs) {
+  List*     needed;
+  List*     result = NIL;
+  ListCell* lc;
+
+  db2Debug1("> addColumnProjection");
+  #if PG_VERSION_NUM < 90600
+  needed = pull_var_clause ((Node*) foreignrel->reltargetlist, PVC_INCLUDE_PLACEHOLDERS);
+  #else
+  needed = pull_var_clause ((Node*) foreignrel->reltarget->exprs, PVC_INCLUDE_PLACEHOLDERS);
+  #endif
+  needed = list_union (needed, pull_var_clause ((Node*) tlist, PVC_INCLUDE_PLACEHOLDERS));
+  needed = list_union (needed, pull_var_clause ((Node*) local_exprs, PVC_INCLUDE_PLACEHOLDERS));
+  foreach (lc, needed) {
+    Var* var = (Var*) lfirst (lc);
+
+    /* whole-row references and system columns need the table's tuple */
+    if (!IsA (var, Var) || var->varno != foreignrel->relid || var->varlevelsup != 0 || var->varattno < 1) {
+      db2Debug1("< addColumnProjection - returns: NIL");
+      return NIL;
+    }
+  }
+  if (needed != NIL && list_length (needed) < fdwState->db2Table->npgcols)
+    result = buildProjection (foreignrel, fdwState, needed, NIL, NIL);
+  db2Debug1("< addColumnProjection - %d of %d columns", (result != NIL) ? list_length (needed) : fdwState->db2Table->npgcols, fdwState->db2Table->npgcols);
+  return result;
+}
+
+/** buildProjection
+ *   Replace the db2Table of the scan by one with a column for each of the
+ *   Vars in "vars" and each of the expressions in "exprs" that DB2 computes
+ *   as "sqls", in that order, and return the matching target list.
+ *   The target list becomes fdw_scan_tlist, so the scan tuple consists of
+ *   exactly these columns.
+ *   Returns NIL and leaves the db2Table alone if a Var has no DB2 column.
+ */
+List* buildProjection (RelOptInfo* foreignrel, DB2FdwState* fdwState, List* vars, List* exprs, List* sqls) {
+  DB2Table* db2Table;
+  List*     tlist = NIL;
+  ListCell* lc;
+  ListCell* lv;
+  int       i;
+
+  db2Debug1("> buildProjection");
+  db2Table          = (DB2Table*) db2alloc ("fdw_state->db2Table", sizeof (DB2Table));
+  db2Table->name    = fdwState->db2Table->name;
+  db2Table->pgname  = fdwState->db2Table->pgname;
+  db2Table->batchsz = fdwState->db2Table->batchsz;
+  db2Table->ncols   = 0;
+  db2Table->cols    = (DB2Column**) db2alloc ("fdw_state->db2Table->cols[]", sizeof (DB2Column*) * (list_length (vars) + list_length (exprs)));
+  foreach (lc, vars) {
+    Var*       var    = (Var*) lfirst (lc);
+    DB2Column* newcol = (DB2Column*) db2alloc ("fdw_state->db2Table->cols[idx]", sizeof (DB2Column));
+
+    if ((i = db2ColumnIndex (fdwState->db2Table, var->varattno)) < 0) {
+      db2Debug1("< buildProjection - column %d not in DB2 table, returns: NIL", var->varattno);
+      return NIL;
+    }
+    memcpy (newcol, fdwState->db2Table->cols[i], sizeof (DB2Column));
+    newcol->pgattnum = db2Table->ncols + 1;
+    newcol->used     = 1;
+    db2Table->cols[db2Table->ncols++] = newcol;
+    tlist = lappend (tlist, makeTargetEntry ((Expr*) var, newcol->pgattnum, NULL, false));
+  }
+  forboth (lc, exprs, lv, sqls) {
+    Expr*      expr   = (Expr*) lfirst (lc);
+    DB2Column* newcol = (DB2Column*) db2alloc ("fdw_state->db2Table->cols[idx]", sizeof (DB2Column));
+
+    setResultColumn (foreignrel, fdwState->db2Table, NULL, exprType ((Node*) expr), exprMaxChars (expr), newcol);
+    /* the column is an expression of the SELECT list, no qualifier */
+    newcol->colName  = (char*) lfirst (lv);
+    newcol->colNulls = 1;
+    newcol->pgname   = db2strdup ("?column?");
+    newcol->pgtype   = exprType ((Node*) expr);
+    newcol->pgtypmod = exprTypmod ((Node*) expr);
+    newcol->pgattnum = db2Table->ncols + 1;
+    newcol->used     = 1;
+    newcol->varno    = 0;
+    db2Table->cols[db2Table->ncols++] = newcol;
+    tlist = lappend (tlist, makeTargetEntry (expr, newcol->pgattnum, NULL, false));
+  }
+  db2Table->npgcols    = db2Table->ncols;
+  buildAttrMap (db2Table);
+  fdwState->db2Table   = db2Table;
+  fdwState->scan_tlist = tlist;
+  db2Debug1("< buildProjection - %d columns", db2Table->ncols);
+  return tlist;
+}
+
+/** exprMaxChars
+ *   Return the maximal number of characters of a string expression,
+ *   or 0 if it is not known. It is known for strings of limited length
+ *   and for substrings of a constant length.
+ */
+int exprMaxChars (Expr* expr) {
+  Oid       type   = exprType ((Node*) expr);
+  int32     typmod = exprTypmod ((Node*) expr);
+  FuncExpr* func   = (FuncExpr*) expr;
+  Const*    len    = NULL;
+  char*     name;
+
+  if ((type == VARCHAROID || type == BPCHAROID) && typmod > VARHDRSZ)
+    return typmod - VARHDRSZ;
+  if (!IsA (expr, FuncExpr) || get_func_namespace (func->funcid) != PG_CATALOG_NAMESPACE)
+    return 0;
+  name = get_func_name (func->funcid);
+  if ((strcmp (name, "substr") == 0 || strcmp (name, "substring") == 0) && list_length (func->args) == 3)
+    len = (Const*) lthird (func->args);
+  else if ((strcmp (name, "left") == 0 || strcmp (name, "right") == 0) && list_length (func->args) == 2)
+    len = (Const*) lsecond (func->args);
+  if (len == NULL || !IsA (len, Const) || len->constisnull || len->consttype != INT4OID || DatumGetInt32 (len->constvalue) < 0)
+    return 0;
+  return DatumGetInt32 (len->constvalue);
+}
+
 /** createQuery
  *   Construct a query string for DB2 that
  *   a) contains only the necessary columns in the SELECT list
@@ -181,9 +758,10 @@ char* createQuery (DB2FdwState* fdwState, RelOptInfo* foreignrel, bool modify, L
   ListCell*      cell;
   bool           in_quote = false;
   int            i, index;
-  char*          wherecopy, *p, md5[33], parname[10], *separator = "";
+  char*          p, md5[33], *separator = "";
   StringInfoData query, result;
   List*          columnlist, *conditions = foreignrel->baserestrictinfo;
+  List*          params = NIL;
   #if PG_VERSION_NUM >= 150000
   const char*    errstr = NULL;
   #endif
@@ -196,7 +774,8 @@ char* createQuery (DB2FdwState* fdwState, RelOptInfo* foreignrel, bool modify, L
   columnlist = foreignrel->reltarget->exprs;
   #endif
 
-  if (IS_SIMPLE_REL (foreignrel)) {
+  /* a computed target list defines the used columns itself */
+  if (IS_SIMPLE_REL (foreignrel) && fdwState->scan_tlist == NIL) {
     db2Debug3("  IS_SIMPLE_REL");
     /* find all the columns to include in the select list */
     /* examine each SELECT list entry for Var nodes */
@@ -220,8 +799,9 @@ char* createQuery (DB2FdwState* fdwState, RelOptInfo* foreignrel, bool modify, L
     if (fdwState->db2Table->cols[i]->used) {
       StringInfoData alias;
       initStringInfo (&alias);
-      /* table alias is created from range table index */
-      ADD_REL_QUALIFIER (&alias, fdwState->db2Table->cols[i]->varno);
+      /* table alias is created from range table index, window functions have none */
+      if (fdwState->db2Table->cols[i]->varno > 0)
+        ADD_REL_QUALIFIER (&alias, fdwState->db2Table->cols[i]->varno);
 
       /* add qualified column name */
       appendStringInfo (&query, "%s%s%s", separator, alias.data, fdwState->db2Table->cols[i]->colName);
@@ -241,8 +821,9 @@ char* createQuery (DB2FdwState* fdwState, RelOptInfo* foreignrel, bool modify, L
    * For inner joins, all conditions that are pushed down get added
    * to fdwState->joinclauses and have already been added above,
    * so there is no extra WHERE clause.
+   * Window functions are computed over the rows of the table scan.
    */
-  if (IS_SIMPLE_REL (foreignrel)) {
+  if (IS_SIMPLE_REL (foreignrel) || foreignrel->reloptkind == RELOPT_UPPER_REL) {
     /* append WHERE clauses */
     if (fdwState->where_clause)
       appendStringInfo (&query, "%s", fdwState->where_clause);
@@ -256,27 +837,28 @@ char* createQuery (DB2FdwState* fdwState, RelOptInfo* foreignrel, bool modify, L
   if (modify)
     appendStringInfo (&query, " FOR UPDATE");
 
-  /* get a copy of the where clause without single quoted string literals */
-  wherecopy = db2strdup (query.data);
-  for (p = wherecopy; *p != '\0'; ++p) {
+  /*
+   * Build the list of parameter expressions in the order in which their
+   * markers occur in the query (outside of string literals), so that they
+   * can be bound by position. A parameter that occurs more than once is
+   * listed more than once, parameters that do not occur are dropped.
+   * A NULL entry stands for the transaction timestamp marker ":now".
+   * Array parameters (":a1" etc.) share the numbering with the others.
+   */
+  for (p = query.data; *p != '\0'; ++p) {
     if (*p == '\'')
       in_quote = !in_quote;
-    if (in_quote)
-      *p = ' ';
-  }
-
-  /* remove all parameters that do not actually occur in the query */
-  index = 0;
-  foreach (cell, fdwState->params) {
-    ++index;
-    snprintf (parname, 10, ":p%d", index);
-    if (strstr (wherecopy, parname) == NULL) {
-      /* set the element to NULL to indicate it's gone */
-      lfirst (cell) = NULL;
+    if (in_quote || *p != '?')
+      continue;
+    if (strncmp (p, "?/*:now*/", 9) == 0) {
+      params = lappend (params, NULL);
+    } else if (strncmp (p, "?/*:p", 5) == 0 || strncmp (p, "?/*:a", 5) == 0) {
+      index = atoi (p + 5);
+      Assert (index > 0 && index <= list_length (fdwState->params));
+      params = lappend (params, list_nth (fdwState->params, index - 1));
     }
   }
-
-  db2free (wherecopy);
+  fdwState->params = params;
 
   /*
    * Calculate MD5 hash of the query string so far.
@@ -303,7 +885,8 @@ if (!pg_md5_hash (query.data, strlen (query.data), md5)) {
 /** deparseFromExprForRel
  *   Construct FROM clause for given relation.
  *   The function constructs ... JOIN ... ON ... for join relation. For a base
- *   relation it just returns the table name.
+ *   relation it just returns the table name, for a window relation the FROM
+ *   clause of the table it is computed from.
  *   All tables get an alias based on the range table index.
  */
 void deparseFromExprForRel (DB2FdwState* fdwState, StringInfo buf, RelOptInfo* foreignrel, List** params_list) {
@@ -313,6 +896,9 @@ void deparseFromExprForRel (DB2FdwState* fdwState, StringInfo buf, RelOptInfo* f
     appendStringInfo (buf, "%s", fdwState->db2Table->name);
 
     appendStringInfo (buf, " %s%d", REL_ALIAS_PREFIX, foreignrel->relid);
+  } else if (foreignrel->reloptkind == RELOPT_UPPER_REL) {
+    /* window relation */
+    deparseFromExprForRel ((DB2FdwState*) fdwState->outerrel->fdw_private, buf, fdwState->outerrel, params_list);
   } else {
     /* join relation */
     RelOptInfo *rel_o = fdwState->outerrel;
@@ -413,10 +999,7 @@ void getUsedColumns (Expr* expr, DB2Table* db2Table, int foreignrelid) {
           break;
         }
         /* get db2Table column index corresponding to this column (-1 if none) */
-        index = db2Table->ncols - 1;
-        while (index >= 0 && db2Table->cols[index]->pgattnum != variable->varattno) {
-          --index;
-        }
+        index = db2ColumnIndex (db2Table, variable->varattno);
         if (index == -1) {
           ereport (WARNING, (errcode (ERRCODE_WARNING),errmsg ("column number %d of foreign table \"%s\" does not exist in foreign DB2 table, will be replaced by NULL", variable->varattno, db2Table->pgname)));
         } else {
@@ -597,13 +1180,19 @@ void getUsedColumns (Expr* expr, DB2Table* db2Table, int foreignrelid) {
 /** Build the targetlist for given relation to be deparsed as SELECT clause.
  *
  * The output targetlist contains the columns that need to be fetched from the
- * foreign server for the given relation.
+ * foreign server for the given relation, for a window relation also the
+ * window functions.
  */
 List* build_tlist_to_deparse (RelOptInfo* foreignrel) {
   List*        tlist    = NIL;
   DB2FdwState* fdwState = (DB2FdwState*) foreignrel->fdw_private;
 
   db2Debug1("> build_tlist_to_deparse");
+  /* a target with window functions or other expressions is computed by DB2 as a whole */
+  if (fdwState->scan_tlist != NIL) {
+    db2Debug1("< build_tlist_to_deparse");
+    return fdwState->scan_tlist;
+  }
   /*
    * We require columns specified in foreignrel->reltarget->exprs and those
    * required for evaluating the local conditions.
@@ -0,0 +1,504 @@
+#include <postgres.h>
+#include <catalog/pg_namespace.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <optimizer/cost.h>
+#include <optimizer/pathnode.h>
+#include <optimizer/tlist.h>
+#include <utils/lsyscache.h>
+#include <utils/typcache.h>
+#if PG_VERSION_NUM < 120000
+#include <nodes/relation.h>
+#include <optimizer/var.h>
+#include <utils/tqual.h>
+#else
+#include <nodes/pathnodes.h>
+#include <optimizer/optimizer.h>
+#include <access/heapam.h>
+#endif
+#include "db2_fdw.h"
+#include "DB2FdwState.h"
+
+/** external prototypes */
+extern void         db2Debug1                 (const char* message, ...);
+extern void         db2Debug2                 (const char* message, ...);
+extern char*        deparseExpr               (DB2Session* session, RelOptInfo * foreignrel, Expr* expr, const DB2Table* db2Table, List** params);
+extern bool         collationIsCompatible     (RelOptInfo* foreignrel, Expr* expr, Oid collid, const DB2Table* db2Table);
+extern bool         setResultColumn           (RelOptInfo* baserel, const DB2Table* db2Table, Expr* expr, Oid type, int maxchars, DB2Column* col);
+extern char*        db2strdup                 (const char* source);
+extern void*        db2alloc                  (const char* type, size_t size);
+extern void         buildAttrMap              (DB2Table* db2Table);
+extern int          db2ColumnIndex            (const DB2Table* db2Table, int attnum);
+
+/** local prototypes */
+void         db2GetForeignUpperPaths(PlannerInfo* root, UpperRelationKind stage, RelOptInfo* input_rel, RelOptInfo* output_rel, void* extra);
+DB2FdwState* foreign_window_ok      (PlannerInfo* root, RelOptInfo* input_rel, PathTarget* target);
+char*        deparseWindowFunc      (PlannerInfo* root, RelOptInfo* baserel, DB2FdwState* fdwState, WindowFunc* wfunc, DB2Column* col);
+char*        deparseWindowSpec      (PlannerInfo* root, RelOptInfo* baserel, DB2FdwState* fdwState, WindowClause* wc, bool frame);
+char*        deparseFrameBound      (int options, Node* offset, bool start);
+bool         isWindowKey            (RelOptInfo* baserel, DB2FdwState* fdwState, Expr* expr, Oid collid);
+
+/** db2GetForeignUpperPaths
+ *   Add a ForeignPath to the window relation if all window functions of the
+ *   query can be computed by DB2 with an OLAP specification.
+ *   DB2 then sorts the rows by partition and order, and PostgreSQL does
+ *   not have to fetch and sort the complete partitions before it can
+ *   compute running sums or row numbers.
+ *   Only window functions over a single foreign table are pushed down.
+ */
+void db2GetForeignUpperPaths (PlannerInfo* root, UpperRelationKind stage, RelOptInfo* input_rel, RelOptInfo* output_rel, void* extra) {
+  DB2FdwState* fdwState   = NULL;
+  DB2FdwState* fdwState_i = (DB2FdwState*) input_rel->fdw_private;
+  PathTarget*  target     = NULL;
+  ForeignPath* windowpath = NULL;
+  ListCell*    lc;
+  int          nfuncs     = 0;
+  double       rows;
+  Cost         startup_cost;
+  Cost         total_cost;
+
+  db2Debug1("> db2GetForeignUpperPaths");
+  /* only window functions of queries without row locks are pushed down */
+  if (stage != UPPERREL_WINDOW || root->parse->commandType != CMD_SELECT || root->parse->rowMarks != NIL) {
+    db2Debug1("< db2GetForeignUpperPaths - not a window stage of a SELECT");
+    return;
+  }
+  /*
+   * The window functions must be applied to all rows of the table,
+   * so no condition must be left for PostgreSQL to check.
+   */
+  if (input_rel->reloptkind != RELOPT_BASEREL || fdwState_i == NULL || fdwState_i->local_conds != NIL) {
+    db2Debug1("< db2GetForeignUpperPaths - input is no foreign table scan with remote conditions only");
+    return;
+  }
+  /* skip if this window relation has been considered already */
+  if (output_rel->fdw_private) {
+    db2Debug1("< db2GetForeignUpperPaths - already considered");
+    return;
+  }
+  target = root->upper_targets[UPPERREL_WINDOW];
+  if ((fdwState = foreign_window_ok (root, input_rel, target)) == NULL) {
+    db2Debug1("< db2GetForeignUpperPaths - window functions cannot be pushed down");
+    return;
+  }
+  output_rel->fdw_private = fdwState;
+
+  foreach (lc, target->exprs) {
+    if (IsA (lfirst (lc), WindowFunc))
+      ++nfuncs;
+  }
+  /*
+   * DB2 returns as many rows as the table scan, it sorts them and computes
+   * the window functions while they are sent. Charge the function calls
+   * like a local WindowAgg does, but no local sort.
+   */
+  rows         = input_rel->rows;
+  startup_cost = fdwState_i->startup_cost;
+  total_cost   = fdwState_i->total_cost + rows * cpu_operator_cost * nfuncs;
+  fdwState->startup_cost = startup_cost;
+  fdwState->total_cost   = total_cost;
+  db2Debug2("  window path: %d functions, %.0f rows, cost %.2f..%.2f", nfuncs, rows, startup_cost, total_cost);
+
+  /* create the window path */
+#if PG_VERSION_NUM < 120000
+  windowpath = create_foreignscan_path ( root
+#else
+  windowpath = create_foreign_upper_path(root
+#endif  /* PG_VERSION_NUM */
+                                       , output_rel
+                                       , target
+                                       , rows
+#if PG_VERSION_NUM >= 180000
+                                       , 0     /* no disabled plan nodes */
+#endif  /* PG_VERSION_NUM */
+                                       , startup_cost
+                                       , total_cost
+                                       , NIL   /* no pathkeys */
+#if PG_VERSION_NUM < 120000
+                                       , NULL  /* no required outer relids */
+#endif  /* PG_VERSION_NUM */
+                                       , NULL  /* no epq_path */
+#if PG_VERSION_NUM >= 170000
+                                       , NIL   /* no fdw_restrictinfo */
+#endif  /* PG_VERSION_NUM */
+                                       , NIL   /* no fdw_private */
+                                       );
+  /* add generated path to the window relation */
+  add_path (output_rel, (Path*) windowpath);
+  db2Debug1("< db2GetForeignUpperPaths");
+}
+
+/** foreign_window_ok
+ *   Check if every expression of the window relation's target is a column
+ *   of the foreign table, a window function or another expression that DB2
+ *   can compute.
+ *   Returns the DB2FdwState of the window relation with a db2Table that
+ *   describes the result columns, in the order of the target, or NULL.
+ *   The query is built from the state of the table scan, see createQuery.
+ */
+DB2FdwState* foreign_window_ok (PlannerInfo* root, RelOptInfo* input_rel, PathTarget* target) {
+  DB2FdwState* fdwState_i = (DB2FdwState*) input_rel->fdw_private;
+  DB2Table*    db2Table_i = fdwState_i->db2Table;
+  DB2FdwState* fdwState   = NULL;
+  DB2Table*    db2Table   = NULL;
+  ListCell*    lc;
+  int          i;
+
+  db2Debug1("> foreign_window_ok");
+#if PG_VERSION_NUM >= 150000 && PG_VERSION_NUM < 170000
+  /* a run condition might have replaced a qual that is not checked otherwise */
+  foreach (lc, root->parse->windowClause) {
+    if (((WindowClause*) lfirst (lc))->runCondition != NIL) {
+      db2Debug1("< foreign_window_ok - window clause with run condition");
+      return NULL;
+    }
+  }
+#endif  /* PG_VERSION_NUM */
+  /* start with a copy of the scan's state, the WHERE clause is the same */
+  fdwState = (DB2FdwState*) db2alloc ("window_rel->fdw_private", sizeof (DB2FdwState));
+  memcpy (fdwState, fdwState_i, sizeof (DB2FdwState));
+  fdwState->params       = list_copy (fdwState_i->params);
+  fdwState->remote_conds = NIL;
+  fdwState->local_conds  = NIL;
+  fdwState->order_clause = NULL;
+  fdwState->query        = NULL;
+  fdwState->full_query   = NULL;
+  fdwState->full_keys    = NIL;
+  fdwState->outerrel     = input_rel;
+  fdwState->innerrel     = NULL;
+  fdwState->joinclauses  = NIL;
+  fdwState->scan_tlist   = NIL;
+
+  /* construct db2Table for the result of the window functions */
+  db2Table          = (DB2Table*) db2alloc ("fdw_state->db2Table", sizeof (DB2Table));
+  db2Table->name    = db2strdup (db2Table_i->name);
+  db2Table->pgname  = db2strdup (db2Table_i->pgname);
+  db2Table->batchsz = db2Table_i->batchsz;
+  db2Table->ncols   = 0;
+  db2Table->npgcols = 0;
+  db2Table->cols    = (DB2Column**) db2alloc ("fdw_state->db2Table->cols[]", sizeof (DB2Column*) * (list_length (target->exprs) + 1));
+
+  foreach (lc, target->exprs) {
+    Expr*      expr   = (Expr*) lfirst (lc);
+    DB2Column* newcol = (DB2Column*) db2alloc ("fdw_state->db2Table->cols[idx]", sizeof (DB2Column));
+
+    if (IsA (expr, Var)) {
+      Var* var = (Var*) expr;
+
+      /* system columns and whole-row references are not fetched */
+      if (var->varno != input_rel->relid || var->varlevelsup != 0 || var->varattno < 1) {
+        db2Debug1("< foreign_window_ok - unsupported column reference");
+        return NULL;
+      }
+      if ((i = db2ColumnIndex (db2Table_i, var->varattno)) < 0) {
+        db2Debug1("< foreign_window_ok - column %d not in DB2 table", var->varattno);
+        return NULL;
+      }
+      memcpy (newcol, db2Table_i->cols[i], sizeof (DB2Column));
+    } else if (IsA (expr, WindowFunc)) {
+      WindowFunc* wfunc = (WindowFunc*) expr;
+
+      /* the column is an expression of the SELECT list, no qualifier */
+      if ((newcol->colName = deparseWindowFunc (root, input_rel, fdwState, wfunc, newcol)) == NULL) {
+        db2Debug1("< foreign_window_ok - window function %u cannot be pushed down", wfunc->winfnoid);
+        return NULL;
+      }
+      newcol->pgname         = get_func_name (wfunc->winfnoid);
+      newcol->pgtype         = wfunc->wintype;
+      newcol->pgtypmod       = -1;
+      newcol->colNulls       = 1;
+      newcol->colPrimKeyPart = 0;
+      newcol->colIndexed     = 0;
+      newcol->pkey           = 0;
+      newcol->varno          = 0;
+    } else if ((newcol->colName = deparseExpr (fdwState->session, input_rel, expr, fdwState->db2Table, &(fdwState->params))) != NULL
+           && setResultColumn (input_rel, fdwState->db2Table, expr, exprType ((Node*) expr), 0, newcol)) {
+      /* other expressions of the columns are computed by DB2 as well */
+      newcol->pgname   = db2strdup ("?column?");
+      newcol->pgtype   = exprType ((Node*) expr);
+      newcol->pgtypmod = exprTypmod ((Node*) expr);
+      newcol->colNulls = 1;
+      newcol->varno    = 0;
+    } else {
+      db2Debug1("< foreign_window_ok - unsupported expression of type %d", expr->type);
+      return NULL;
+    }
+    newcol->used     = 1;
+    /* pgattnum is the index in the SELECT clause of the query */
+    newcol->pgattnum = db2Table->ncols + 1;
+    db2Table->cols[db2Table->ncols++] = newcol;
+    /* the scan returns the target as it is */
+    fdwState->scan_tlist = lappend (fdwState->scan_tlist, makeTargetEntry (expr, newcol->pgattnum, NULL, false));
+  }
+  db2Table->npgcols = db2Table->ncols;
+  buildAttrMap (db2Table);
+  /* the expressions above were deparsed with the table's columns */
+  fdwState->db2Table = db2Table;
+  db2Debug1("< foreign_window_ok");
+  return fdwState;
+}
+
+/** deparseWindowFunc
+ *   Return the DB2 OLAP specification for a window function of pg_catalog,
+ *   or NULL if it cannot be pushed down.
+ *   Ranking functions and LAG/LEAD need an ordered window in DB2,
+ *   the aggregates take the frame of the window clause.
+ *   The type of the result column is set in "col".
+ */
+char* deparseWindowFunc (PlannerInfo* root, RelOptInfo* baserel, DB2FdwState* fdwState, WindowFunc* wfunc, DB2Column* col) {
+  WindowClause*  wc      = NULL;
+  Expr*          argexpr = NULL;
+  Oid            argtype = InvalidOid;
+  char*          arg     = NULL;
+  char*          name;
+  char*          spec;
+  bool           frame   = false;
+  StringInfoData result;
+  ListCell*      cell;
+
+  db2Debug1("> deparseWindowFunc");
+  if (get_func_namespace (wfunc->winfnoid) != PG_CATALOG_NAMESPACE || wfunc->aggfilter != NULL) {
+    db2Debug1("< deparseWindowFunc - returns: NULL");
+    return NULL;
+  }
+#if PG_VERSION_NUM >= 170000
+  /* a run condition might have replaced a qual that is not checked otherwise */
+  if (wfunc->runCondition != NIL) {
+    db2Debug1("< deparseWindowFunc - returns: NULL");
+    return NULL;
+  }
+#endif  /* PG_VERSION_NUM */
+  foreach (cell, root->parse->windowClause) {
+    if (((WindowClause*) lfirst (cell))->winref == wfunc->winref)
+      wc = (WindowClause*) lfirst (cell);
+  }
+  if (wc == NULL) {
+    db2Debug1("< deparseWindowFunc - returns: NULL");
+    return NULL;
+  }
+  name = get_func_name (wfunc->winfnoid);
+  if (wfunc->args != NIL) {
+    argexpr = (Expr*) linitial (wfunc->args);
+    argtype = exprType ((Node*) argexpr);
+    if (argtype == BOOLOID || (arg = deparseExpr (fdwState->session, baserel, argexpr, fdwState->db2Table, &(fdwState->params))) == NULL) {
+      db2Debug1("< deparseWindowFunc - returns: NULL");
+      return NULL;
+    }
+  }
+  initStringInfo (&result);
+  if (strcmp (name, "row_number") == 0 || strcmp (name, "rank") == 0 || strcmp (name, "dense_rank") == 0) {
+    /* DB2 ranks only in an ordered window */
+    if (strcmp (name, "row_number") != 0 && wc->orderClause == NIL) {
+      db2Debug1("< deparseWindowFunc - returns: NULL");
+      return NULL;
+    }
+    appendStringInfo (&result, "%s()", (name[0] == 'r') ? ((name[1] == 'o') ? "ROW_NUMBER" : "RANK") : "DENSE_RANK");
+    setResultColumn (baserel, fdwState->db2Table, NULL, INT8OID, 0, col);
+  } else if (strcmp (name, "lag") == 0 || strcmp (name, "lead") == 0) {
+    if (wc->orderClause == NIL || !setResultColumn (baserel, fdwState->db2Table, argexpr, wfunc->wintype, 0, col)) {
+      db2Debug1("< deparseWindowFunc - returns: NULL");
+      return NULL;
+    }
+    appendStringInfo (&result, "%s(%s", (name[1] == 'a') ? "LAG" : "LEAD", arg);
+    if (list_length (wfunc->args) > 1) {
+      Const* offset = (Const*) lsecond (wfunc->args);
+      char*  def;
+
+      /* DB2 takes a positive constant offset only */
+      if (!IsA (offset, Const) || offset->constisnull || DatumGetInt32 (offset->constvalue) < 1) {
+        db2Debug1("< deparseWindowFunc - returns: NULL");
+        return NULL;
+      }
+      appendStringInfo (&result, ", %d", DatumGetInt32 (offset->constvalue));
+      if (list_length (wfunc->args) > 2) {
+        if ((def = deparseExpr (fdwState->session, baserel, (Expr*) lthird (wfunc->args), fdwState->db2Table, &(fdwState->params))) == NULL) {
+          db2Debug1("< deparseWindowFunc - returns: NULL");
+          return NULL;
+        }
+        appendStringInfo (&result, ", %s", def);
+      }
+    }
+    appendStringInfoString (&result, ")");
+  } else if (strcmp (name, "sum") == 0 || strcmp (name, "avg") == 0) {
+    const char* cast;
+
+    /*
+     * Compute with at least the precision of PostgreSQL's result type.
+     * PostgreSQL chooses the scale of a numeric avg from the values,
+     * DB2 cannot reproduce that, so only avg of floating point values
+     * is pushed down.
+     */
+    if (name[0] == 'a' && argtype != FLOAT4OID && argtype != FLOAT8OID) {
+      db2Debug1("< deparseWindowFunc - returns: NULL");
+      return NULL;
+    }
+    switch (argtype) {
+      case INT2OID:
+      case INT4OID:
+        cast = "BIGINT";
+      break;
+      case INT8OID:
+        cast = "DECIMAL(31,0)";
+      break;
+      case NUMERICOID:
+        cast = "DECFLOAT(34)";
+      break;
+      case FLOAT4OID:
+      case FLOAT8OID:
+        cast = "DOUBLE";
+      break;
+      default:
+        db2Debug1("< deparseWindowFunc - returns: NULL");
+        return NULL;
+    }
+    appendStringInfo (&result, "%s(CAST (%s AS %s))", (name[0] == 's') ? "SUM" : "AVG", arg, cast);
+    setResultColumn (baserel, fdwState->db2Table, NULL, wfunc->wintype, 0, col);
+    frame = true;
+  } else if (strcmp (name, "min") == 0 || strcmp (name, "max") == 0) {
+    /* strings only if DB2 compares them like PostgreSQL */
+    if (((argtype == TEXTOID || argtype == VARCHAROID || argtype == BPCHAROID) && !collationIsCompatible (baserel, argexpr, wfunc->inputcollid, fdwState->db2Table))
+    || !setResultColumn (baserel, fdwState->db2Table, argexpr, wfunc->wintype, 0, col)) {
+      db2Debug1("< deparseWindowFunc - returns: NULL");
+      return NULL;
+    }
+    appendStringInfo (&result, "%s(%s)", (name[1] == 'i') ? "MIN" : "MAX", arg);
+    frame = true;
+  } else if (strcmp (name, "count") == 0) {
+    appendStringInfo (&result, "COUNT_BIG(%s)", (wfunc->winstar || arg == NULL) ? "*" : arg);
+    setResultColumn (baserel, fdwState->db2Table, NULL, INT8OID, 0, col);
+    frame = true;
+  } else {
+    db2Debug1("< deparseWindowFunc - returns: NULL");
+    return NULL;
+  }
+  if ((spec = deparseWindowSpec (root, baserel, fdwState, wc, frame)) == NULL) {
+    db2Debug1("< deparseWindowFunc - returns: NULL");
+    return NULL;
+  }
+  appendStringInfo (&result, " %s", spec);
+  db2Debug1("< deparseWindowFunc - returns: '%s'", result.data);
+  return result.data;
+}
+
+/** deparseWindowSpec
+ *   Return "OVER (PARTITION BY ... ORDER BY ... frame)" for a window clause,
+ *   or NULL if its keys or its frame cannot be represented in DB2.
+ *   The frame is only added for aggregates ("frame") and if it is not the
+ *   default, which is the same in DB2 and PostgreSQL.
+ */
+char* deparseWindowSpec (PlannerInfo* root, RelOptInfo* baserel, DB2FdwState* fdwState, WindowClause* wc, bool frame) {
+  StringInfoData result;
+  ListCell*      cell;
+  char*          delim = "PARTITION BY ";
+  char*          key;
+
+  db2Debug1("> deparseWindowSpec");
+  initStringInfo (&result);
+  appendStringInfoString (&result, "OVER (");
+  foreach (cell, wc->partitionClause) {
+    SortGroupClause* sgc  = (SortGroupClause*) lfirst (cell);
+    Expr*            expr = (Expr*) get_sortgroupclause_expr (sgc, root->parse->targetList);
+
+    if (!isWindowKey (baserel, fdwState, expr, exprCollation ((Node*) expr))
+    || (key = deparseExpr (fdwState->session, baserel, expr, fdwState->db2Table, &(fdwState->params))) == NULL) {
+      db2Debug1("< deparseWindowSpec - returns: NULL");
+      return NULL;
+    }
+    appendStringInfo (&result, "%s%s", delim, key);
+    delim = ", ";
+  }
+  delim = (wc->partitionClause != NIL) ? " ORDER BY " : "ORDER BY ";
+  foreach (cell, wc->orderClause) {
+    SortGroupClause* sgc  = (SortGroupClause*) lfirst (cell);
+    Expr*            expr = (Expr*) get_sortgroupclause_expr (sgc, root->parse->targetList);
+    TypeCacheEntry*  typentry;
+    const char*      direction;
+
+    if (!isWindowKey (baserel, fdwState, expr, exprCollation ((Node*) expr))
+    || (key = deparseExpr (fdwState->session, baserel, expr, fdwState->db2Table, &(fdwState->params))) == NULL) {
+      db2Debug1("< deparseWindowSpec - returns: NULL");
+      return NULL;
+    }
+    /* only the default sort order of the type is known to DB2 */
+    typentry = lookup_type_cache (exprType ((Node*) expr), TYPECACHE_LT_OPR | TYPECACHE_GT_OPR);
+    if (sgc->sortop == typentry->lt_opr) {
+      direction = "ASC";
+    } else if (sgc->sortop == typentry->gt_opr) {
+      direction = "DESC";
+    } else {
+      db2Debug1("< deparseWindowSpec - returns: NULL");
+      return NULL;
+    }
+    appendStringInfo (&result, "%s%s %s NULLS %s", delim, key, direction, (sgc->nulls_first) ? "FIRST" : "LAST");
+    delim = ", ";
+  }
+  if (frame && (wc->frameOptions & FRAMEOPTION_NONDEFAULT)) {
+    int   options = wc->frameOptions;
+    char* start   = deparseFrameBound (options, wc->startOffset, true);
+    char* end     = deparseFrameBound (options, wc->endOffset, false);
+
+    /*
+     * DB2 knows neither GROUPS nor exclusions, and a value range
+     * needs the in_range support of the sort key.
+     * Without an ORDER BY, the frame would depend on the order in
+     * which the rows arrive.
+     */
+    if (start == NULL || end == NULL || wc->orderClause == NIL
+    || (options & (FRAMEOPTION_GROUPS | FRAMEOPTION_EXCLUSION))
+    || ((options & FRAMEOPTION_RANGE) && (options & (FRAMEOPTION_START_OFFSET | FRAMEOPTION_END_OFFSET)))) {
+      db2Debug1("< deparseWindowSpec - returns: NULL");
+      return NULL;
+    }
+    appendStringInfo (&result, " %s BETWEEN %s AND %s", (options & FRAMEOPTION_ROWS) ? "ROWS" : "RANGE", start, end);
+  }
+  appendStringInfoString (&result, ")");
+  db2Debug1("< deparseWindowSpec - returns: '%s'", result.data);
+  return result.data;
+}
+
+/** deparseFrameBound
+ *   Return the start or end bound of a window frame in DB2 SQL,
+ *   or NULL if the offset is not a constant.
+ */
+char* deparseFrameBound (int options, Node* offset, bool start) {
+  if (options & (start ? FRAMEOPTION_START_UNBOUNDED_PRECEDING : FRAMEOPTION_END_UNBOUNDED_PRECEDING))
+    return "UNBOUNDED PRECEDING";
+  if (options & (start ? FRAMEOPTION_START_UNBOUNDED_FOLLOWING : FRAMEOPTION_END_UNBOUNDED_FOLLOWING))
+    return "UNBOUNDED FOLLOWING";
+  if (options & (start ? FRAMEOPTION_START_CURRENT_ROW : FRAMEOPTION_END_CURRENT_ROW))
+    return "CURRENT ROW";
+  if (offset == NULL || !IsA (offset, Const) || ((Const*) offset)->constisnull || ((Const*) offset)->consttype != INT8OID)
+    return NULL;
+  return psprintf (INT64_FORMAT " %s", DatumGetInt64 (((Const*) offset)->constvalue), (options & (start ? FRAMEOPTION_START_OFFSET_PRECEDING : FRAMEOPTION_END_OFFSET_PRECEDING)) ? "PRECEDING" : "FOLLOWING");
+}
+
+/** isWindowKey
+ *   Return true if DB2 partitions and sorts by "expr" like PostgreSQL.
+ *   These are the same types as for ORDER BY clauses (see deparseOrderBy).
+ */
+bool isWindowKey (RelOptInfo* baserel, DB2FdwState* fdwState, Expr* expr, Oid collid) {
+  Oid type = exprType ((Node*) expr);
+
+  switch (type) {
+    case INT2OID:
+    case INT4OID:
+    case INT8OID:
+    case OIDOID:
+    case FLOAT4OID:
+    case FLOAT8OID:
+    case NUMERICOID:
+    case DATEOID:
+    case TIMESTAMPOID:
+    case TIMESTAMPTZOID:
+    case TIMEOID:
+    case TIMETZOID:
+    case INTERVALOID:
+      return !contain_volatile_functions ((Node*) expr);
+    case TEXTOID:
+    case VARCHAROID:
+    case BPCHAROID:
+      return !contain_volatile_functions ((Node*) expr) && collationIsCompatible (baserel, expr, collid, fdwState->db2Table);
+    default:
+      return false;
+  }
+}
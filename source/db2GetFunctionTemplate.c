@@ -0,0 +1,233 @@
+#include <postgres.h>
+#include <catalog/pg_namespace.h>
+#include <catalog/pg_proc.h>
+#include <foreign/foreign.h>
+#include <utils/hsearch.h>
+#include <utils/inval.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+#include <utils/syscache.h>
+#include "db2_fdw.h"
+
+/** external prototypes */
+extern void         db2Debug1                 (const char* message, ...);
+extern void         db2Debug2                 (const char* message, ...);
+
+/** local prototypes */
+char*        db2GetFunctionTemplate (Oid serverid, Oid funcid);
+const char*  findTemplate           (List* options, const char* schema, const char* name);
+void         invalidateTemplates    (Datum arg, int cacheid, uint32 hashvalue);
+
+/** FunctionTemplate
+ *   An entry of the cache of DB2 templates by server and function.
+ */
+typedef struct functionTemplate {
+  Oid                 serverid;      // foreign server, hash key
+  Oid                 funcid;        // PostgreSQL function, hash key
+  char*               template;      // DB2 template, NULL if the function cannot be pushed down
+} FunctionTemplate;
+
+/** Functions of pg_catalog that DB2 knows, with their DB2 templates.
+ *   A template is either the name of the DB2 function that takes the
+ *   same arguments, or an SQL expression with $1, $2 ... for the arguments.
+ *   If "nargs" is not -1, the template only applies to the function with
+ *   that many arguments: DB2's TRIM only strips a single character, while
+ *   btrim with two arguments strips any of a set of characters.
+ */
+static const struct { const char* name; int nargs; const char* template; } builtin_templates[] = {
+  {"abs"             , -1, "ABS"                },
+  {"acos"            , -1, "ACOS"               },
+  {"asin"            , -1, "ASIN"               },
+  {"atan"            , -1, "ATAN"               },
+  {"atan2"           , -1, "ATAN2"              },
+  {"btrim"           ,  1, "TRIM"               },
+  {"ceil"            , -1, "CEIL"               },
+  {"ceiling"         , -1, "CEIL"               },
+  {"char_length"     , -1, "LENGTH"             },
+  {"character_length", -1, "LENGTH"             },
+  {"concat"          , -1, "CONCAT"             },
+  {"cos"             , -1, "COS"                },
+  {"date_trunc"      , -1, "DATE_TRUNC($1, $2)" },
+  {"exp"             , -1, "EXP"                },
+  {"floor"           , -1, "FLOOR"              },
+  {"initcap"         , -1, "INITCAP"            },
+  {"left"            , -1, "LEFT"               },
+  {"length"          , -1, "LENGTH"             },
+  {"ln"              , -1, "LN"                 },
+  {"log"             , -1, "LOG10($1)"          },
+  {"lower"           , -1, "LOWER"              },
+  {"lpad"            , -1, "LPAD"               },
+  {"ltrim"           , -1, "LTRIM"              },
+  {"mod"             , -1, "MOD"                },
+  {"octet_length"    , -1, "LENGTHB"            },
+  {"position"        , -1, "INSTR"              },
+  {"pow"             , -1, "POWER"              },
+  {"power"           , -1, "POWER"              },
+  {"regexp_like"     , -1, "REGEXP_LIKE"        },
+  {"replace"         , -1, "REPLACE"            },
+  {"right"           , -1, "RIGHT"              },
+  {"round"           , -1, "ROUND"              },
+  {"rpad"            , -1, "RPAD"               },
+  {"rtrim"           , -1, "RTRIM"              },
+  {"sign"            , -1, "SIGN"               },
+  {"sin"             , -1, "SIN"                },
+  {"sqrt"            , -1, "SQRT"               },
+  {"strpos"          , -1, "INSTR"              },
+  {"substr"          , -1, "SUBSTR"             },
+  {"substring"       , -1, "SUBSTR($1, $2, $3)" },
+  {"tan"             , -1, "TAN"                },
+  {"to_char"         , -1, "TO_CHAR"            },
+  {"to_date"         , -1, "TO_DATE"            },
+  {"to_number"       , -1, "TO_NUMBER"          },
+  {"to_timestamp"    , -1, "TO_TIMESTAMP"       },
+  {"translate"       , -1, "TRANSLATE"          },
+  {"trunc"           , -1, "TRUNC"              },
+  {"upper"           , -1, "UPPER"              }
+};
+
+/** cache of the templates, lives until a foreign server is changed */
+static HTAB*         template_cache = NULL;
+static MemoryContext template_cxt   = NULL;
+
+/** db2GetFunctionTemplate
+ *   Return the DB2 template for function "funcid" on foreign server "serverid",
+ *   or NULL if the function cannot be pushed down to DB2.
+ *   The "function_map" option of the server is searched first, so users can
+ *   add functions of any schema or override the built-in templates of
+ *   pg_catalog functions (an empty template keeps a function local).
+ *   The result is cached by server and function and returned as a copy
+ *   in the current memory context.
+ *   The catalog lookups can invalidate the cache, so the template is
+ *   resolved completely before it is entered.
+ */
+char* db2GetFunctionTemplate (Oid serverid, Oid funcid) {
+  FunctionTemplate* entry;
+  Oid               key[2];
+  bool              found;
+  HeapTuple         tuple;
+  char*             name;
+  char*             schema;
+  Oid               nspid;
+  int               nargs;
+  const char*       template = NULL;
+  List*             options  = NIL;
+  int               i;
+
+  db2Debug1("> db2GetFunctionTemplate");
+  key[0] = serverid;
+  key[1] = funcid;
+  if (template_cache != NULL) {
+    entry = (FunctionTemplate*) hash_search (template_cache, key, HASH_FIND, NULL);
+    if (entry != NULL) {
+      db2Debug1("< db2GetFunctionTemplate - returns: '%s'", entry->template ? entry->template : "(none)");
+      return (entry->template == NULL) ? NULL : pstrdup (entry->template);
+    }
+  }
+
+  tuple = SearchSysCache1 (PROCOID, ObjectIdGetDatum (funcid));
+  if (!HeapTupleIsValid (tuple)) {
+    elog (ERROR, "cache lookup failed for function %u", funcid);
+  }
+  name  = pstrdup (NameStr (((Form_pg_proc) GETSTRUCT (tuple))->proname));
+  nspid = ((Form_pg_proc) GETSTRUCT (tuple))->pronamespace;
+  nargs = ((Form_pg_proc) GETSTRUCT (tuple))->pronargs;
+  ReleaseSysCache (tuple);
+  schema = get_namespace_name (nspid);
+  if (OidIsValid (serverid))
+    options = GetForeignServer (serverid)->options;
+  template = findTemplate (options, schema, name);
+  if (template == NULL && nspid == PG_CATALOG_NAMESPACE) {
+    for (i = 0; i < lengthof (builtin_templates); ++i) {
+      if (strcmp (builtin_templates[i].name, name) == 0
+      &&  (builtin_templates[i].nargs == -1 || builtin_templates[i].nargs == nargs)) {
+        template = builtin_templates[i].template;
+        break;
+      }
+    }
+  }
+  if (template != NULL && template[0] == '\0')
+    template = NULL;
+  db2Debug2("  template for %s.%s: '%s'", schema, name, template ? template : "(none)");
+
+  if (template_cache == NULL) {
+    HASHCTL ctl;
+
+    if (template_cxt == NULL) {
+      template_cxt = AllocSetContextCreate (CacheMemoryContext, "db2_fdw function templates", ALLOCSET_SMALL_MINSIZE, ALLOCSET_SMALL_INITSIZE, ALLOCSET_SMALL_MAXSIZE);
+      /* changed server options invalidate the cache */
+      CacheRegisterSyscacheCallback (FOREIGNSERVEROID, invalidateTemplates, (Datum) 0);
+    }
+    memset (&ctl, 0, sizeof (ctl));
+    ctl.keysize   = sizeof (key);
+    ctl.entrysize = sizeof (FunctionTemplate);
+    ctl.hcxt      = template_cxt;
+    template_cache = hash_create ("db2_fdw function templates", 128, &ctl, HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+  }
+  entry = (FunctionTemplate*) hash_search (template_cache, key, HASH_ENTER, &found);
+  entry->template = (template == NULL) ? NULL : MemoryContextStrdup (template_cxt, template);
+  db2Debug1("< db2GetFunctionTemplate - returns: '%s'", template ? template : "(none)");
+  return (template == NULL) ? NULL : pstrdup (template);
+}
+
+/** findTemplate
+ *   Search the "function_map" option in "options" for function "name"
+ *   in schema "schema". The option is a list of "function=template" entries
+ *   separated by semicolons. The function can be qualified with a schema,
+ *   an unqualified name matches the function in every schema.
+ *   Returns the template (an empty string if the function is mapped to
+ *   nothing) or NULL if the function is not mentioned.
+ */
+const char* findTemplate (List* options, const char* schema, const char* name) {
+  ListCell* cell;
+
+  foreach (cell, options) {
+    DefElem* def = (DefElem*) lfirst (cell);
+    char*    entry;
+
+    if (strcmp (def->defname, OPT_FUNCTION_MAP) != 0)
+      continue;
+    for (entry = pstrdup (STRVAL (def->arg)); entry != NULL && *entry != '\0'; ) {
+      char* next = strchr (entry, ';');
+      char* assign;
+      char* func;
+      char* dot;
+      char* end;
+
+      if (next != NULL)
+        *next++ = '\0';
+      assign = strchr (entry, '=');
+      if (assign == NULL) {
+        entry = next;
+        continue;
+      }
+      *assign++ = '\0';
+      /* ignore blanks around the function name and before the template */
+      for (func = entry; *func == ' '; ++func)
+        ;
+      for (end = func + strlen (func); end > func && end[-1] == ' '; --end)
+        end[-1] = '\0';
+      while (*assign == ' ')
+        ++assign;
+      dot = strchr (func, '.');
+      if (dot != NULL) {
+        *dot = '\0';
+        if (strcmp (func, schema) == 0 && strcmp (dot + 1, name) == 0)
+          return assign;
+      } else if (strcmp (func, name) == 0) {
+        return assign;
+      }
+      entry = next;
+    }
+  }
+  return NULL;
+}
+
+/** invalidateTemplates
+ *   Syscache callback: forget all templates when a foreign server changes.
+ */
+void invalidateTemplates (Datum arg, int cacheid, uint32 hashvalue) {
+  if (template_cache != NULL) {
+    MemoryContextReset (template_cxt);
+    template_cache = NULL;
+  }
+}
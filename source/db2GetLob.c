@@ -11,6 +11,7 @@ extern char         db2Message[ERRBUFSIZE];/* contains DB2 error messages, set b
 /** external prototypes */
 extern void*        db2alloc             (const char* type, size_t size);
 extern void*        db2realloc           (void* p, size_t size);
+extern void         db2free              (void* p);
 extern void         db2Debug1            (const char* message, ...);
 extern void         db2Debug2            (const char* message, ...);
 extern void         db2Debug3            (const char* message, ...);
@@ -22,78 +23,73 @@ void                db2GetLob            (DB2Session* session, DB2Column* column
 
 /** db2GetLob
  *   Get the LOB contents and store them in *value and *value_len.
- *   If "trunc" is nonzero, it contains the number of bytes or characters to get.
+ *   If "trunc" is nonzero, it contains the number of bytes to get.
+ *   Values for bytea columns are read as binary, all others as strings.
+ *   The first read tells the total length, so the value is allocated once
+ *   and the rest is read straight into place. Only if DB2 cannot tell the
+ *   length, the buffer grows by doubling.
+ *   DB2_LOB_HEADER bytes are reserved before *value, so that the caller
+ *   can turn it into a varlena without copying. The memory must be freed
+ *   at *value - DB2_LOB_HEADER. A NULL value is returned as NULL.
  */
 void db2GetLob (DB2Session* session, DB2Column* column, int cidx, char** value, long* value_len, unsigned long trunc) {
-  SQLRETURN      rc  = SQL_SUCCESS;
-  SQLLEN         ind = 0;
-  SQLCHAR        buf[LOB_CHUNK_SIZE+1];
-  int            extend = 0;
+  SQLRETURN      rc     = SQL_SUCCESS;
+  SQLRETURN      status = SQL_SUCCESS;
+  SQLLEN         ind    = 0;
+  char*          base   = NULL;
+  size_t         size   = (trunc > 0 && trunc < LOB_CHUNK_SIZE) ? trunc : LOB_CHUNK_SIZE;
+  size_t         len    = 0;
+  int            binary = (column->pgtype == BYTEAOID);
+  SQLSMALLINT    ctype  = binary ? SQL_C_BINARY : SQL_C_CHAR;
   db2Debug1("> db2GetLob");
   db2Debug2("  column->colName: '%s'",column->colName);
   db2Debug2("  cidx           :  %d ",cidx);
-  /* initialize result buffer length */
+  *value     = NULL;
   *value_len = 0;
-  /* read the LOB in chunks */
-  do {
-    db2Debug2("  value_len: %ld",*value_len);
-    db2Debug2("  reading %d byte chunck of data",sizeof(buf));
-    rc = SQLGetData(session->stmtp->hsql, cidx, SQL_C_CHAR, buf, sizeof(buf), &ind);
-    rc = db2CheckErr(rc,session->stmtp->hsql, session->stmtp->type, __LINE__, __FILE__);
+  base = db2alloc ("lob_value", DB2_LOB_HEADER + size + 1);
+  for (;;) {
+    size_t room = size - len;
+
+    db2Debug2("  reading up to %ld bytes at offset %ld", (long) room, (long) len);
+    /* strings need room for the terminating zero */
+    status = SQLGetData(session->stmtp->hsql, cidx, ctype, base + DB2_LOB_HEADER + len, binary ? room : room + 1, &ind);
+    rc     = db2CheckErr(status, session->stmtp->hsql, session->stmtp->type, __LINE__, __FILE__);
     if (rc == SQL_ERROR) {
       db2Error_d ( FDW_UNABLE_TO_CREATE_EXECUTION, "error fetching result: SQLGetData failed to read LOB chunk", db2Message);
     }
-    if (rc != 100) {
-      switch(ind) {
-        case SQL_NULL_DATA:
-          db2Debug3("  data length is null (SQL_NULL_DATA)");
-          extend = 0;
-        break;
-        case SQL_NO_TOTAL:
-          db2Debug3("  undefined data length (SQL_NO_TOTAL)");
-          extend = LOB_CHUNK_SIZE;
-        break;
-        default:
-          db2Debug3("  bytes still remaining: %d", ind);
-          extend = (ind < LOB_CHUNK_SIZE) ? ind : LOB_CHUNK_SIZE;
-        break;
-      }
-      /* extend result buffer by ind */
-      db2Debug2("  value_len: %ld", *value_len);
-      db2Debug2("  extend   : %d", extend);
-      if (*value_len == 0) {
-        if (extend > 0) {
-          *value = db2alloc ("lob_value", *value_len + extend + 1);
-        } else {
-          *value = NULL;
-          db2Debug3("  not allocating space since the LOB value is apparently NULL");
-        }
-      } else {
-        // do not add another 0 termination byte, since we already have one
-        *value = db2realloc (*value, *value_len + extend);
-      }
-      // append the buffer read to the value excluding 0 termination byte
-      db2Debug2("  *value    : %x", *value);
-      db2Debug2("  *value_len: %x", *value_len);
-      if (*value != NULL) {
-        db2Debug3("  memcpy(%x,%x,%d)",*value+*value_len,buf,extend);
-        memcpy(*value + *value_len, buf, extend);
-        /* update LOB length */
-        *value_len += extend;
-      } else {
-        db2Debug3("  skipping value copy, since value is NULL");
-      }
+    if (status == SQL_NO_DATA)
+      break;
+    if (ind == SQL_NULL_DATA) {
+      db2Debug3("  data length is null (SQL_NULL_DATA)");
+      db2free (base);
+      db2Debug1("< db2GetLob - NULL");
+      return;
+    }
+    if (status != SQL_SUCCESS_WITH_INFO || (ind != SQL_NO_TOTAL && (size_t) ind <= room)) {
+      /* the rest of the value fit into the buffer */
+      if (ind != SQL_NO_TOTAL)
+        len += (size_t) ind;
+      else
+        len += binary ? room : strlen (base + DB2_LOB_HEADER + len);
+      break;
     }
-  } while (rc == SQL_SUCCESS_WITH_INFO);
+    /* the buffer is full, "ind" is the length that was left before this read */
+    db2Debug3("  bytes still remaining: %ld", (long) ind);
+    {
+      size_t total = (ind == SQL_NO_TOTAL) ? 2 * size : len + (size_t) ind;
 
-  /* string end for CLOBs */
-  db2Debug2("  *value   : %x" , *value);
-  db2Debug2("  value_len: %ld", *value_len);
-  if (*value != NULL) {
-    (*value)[*value_len] = '\0';
-    db2Debug2("  strlen of lob: %ld", strlen(*value));
-  } else {
-    db2Debug2("  strlen of lob: 0 since *value is NULL");
+      len = size;
+      if (trunc > 0 && len >= trunc)
+        break;
+      if (trunc > 0 && total > trunc)
+        total = trunc;
+      base = db2realloc (base, DB2_LOB_HEADER + total + 1);
+      size = total;
+    }
   }
+  base[DB2_LOB_HEADER + len] = '\0';
+  *value     = base + DB2_LOB_HEADER;
+  *value_len = (long) len;
+  db2Debug2("  value_len: %ld", *value_len);
   db2Debug1("< db2GetLob");
 }
@@ -13,12 +13,12 @@ extern void          db2Debug1            (const char* message, ...);
 int                  db2IsStatementOpen   (DB2Session* session);
 
 /** db2IsStatementOpen
- *   Return 1 if there is a statement handle, else 0.
+ *   Return 1 if there is a statement handle with an open cursor, else 0.
  */
 int db2IsStatementOpen (DB2Session* session) {
   int result = 0;
   db2Debug1("> db2IsStatementOpen");
-  result = (session->stmtp != NULL && session->stmtp->hsql != SQL_NULL_HSTMT);
+  result = (session->stmtp != NULL && session->stmtp->hsql != SQL_NULL_HSTMT && session->stmtp->cursor_open);
   db2Debug1("< db2IsStatementOpen - result: %d",result);
   return result;
 }
@@ -0,0 +1,25 @@
+#include <sqlcli1.h>
+#include <postgres_ext.h>
+#include "db2_fdw.h"
+
+/** global variables */
+
+/** external variables */
+
+/** external prototypes */
+extern void          db2Debug1            (const char* message, ...);
+
+/** local prototypes */
+int                  db2IsStatementPrepared (DB2Session* session);
+
+/** db2IsStatementPrepared
+ *   Return 1 if there is a prepared statement handle, else 0.
+ *   The statement may or may not have an open cursor.
+ */
+int db2IsStatementPrepared (DB2Session* session) {
+  int result = 0;
+  db2Debug1("> db2IsStatementPrepared");
+  result = (session->stmtp != NULL && session->stmtp->hsql != SQL_NULL_HSTMT);
+  db2Debug1("< db2IsStatementPrepared - result: %d",result);
+  return result;
+}
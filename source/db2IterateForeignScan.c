@@ -2,6 +2,12 @@
 #include <commands/explain.h>
 #include <commands/vacuum.h>
 #include <utils/syscache.h>
+#include <utils/hsearch.h>
+#include <miscadmin.h>
+#include <utils/array.h>
+#include <utils/lsyscache.h>
+#include <utils/timestamp.h>
+#include <utils/typcache.h>
 #if PG_VERSION_NUM < 120000
 #include <nodes/relation.h>
 #include <optimizer/var.h>
@@ -17,49 +23,142 @@
 
 /** external prototypes */
 extern int          db2IsStatementOpen        (DB2Session* session);
+extern int          db2IsStatementPrepared    (DB2Session* session);
 extern void         db2PrepareQuery           (DB2Session* session, const char* query, DB2Table* db2Table, unsigned int prefetch);
 extern int          db2ExecuteQuery           (DB2Session* session, const DB2Table* db2Table, ParamDesc* paramList);
 extern int          db2FetchNext              (DB2Session* session);
+extern void         db2SetPrefetch            (DB2Session* session, unsigned int prefetch);
+extern void         db2CloseCursor            (DB2Session* session);
 extern void         db2CloseStatement         (DB2Session* session);
+extern void         db2DeclareKeyTable        (DB2Session* session, const char* tabname, const char* keytype);
+extern void         db2LoadKeyTable           (DB2Session* session, const char* tabname, char** keys, int nkeys);
 extern void         db2Debug1                 (const char* message, ...);
 extern void         db2Debug2                 (const char* message, ...);
 extern void         db2Debug3                 (const char* message, ...);
 extern void         convertTuple              (DB2FdwState* fdw_state, Datum* values, bool* nulls, bool trunc_lob) ;
+extern unsigned int budgetPrefetch            (DB2FdwState* fdw_state);
 extern char*        deparseDate               (Datum datum);
 extern char*        deparseTimestamp          (Datum datum, bool hasTimezone);
 
 /** local prototypes */
 TupleTableSlot* db2IterateForeignScan(ForeignScanState* node);
 char*           setSelectParameters  (ParamDesc *paramList, ExprContext * econtext);
+char*           paramValueString     (Datum datum, Oid type, Oid typoutput);
+bool            resizeArrayParams    (ParamDesc* paramList, int key_table_min);
+void            keyTableType         (ParamDesc* param, char* keytype, size_t size);
+int             uniqueKeys           (char** keys, int nkeys);
+int             compareKeys          (const void* a, const void* b);
+char*           expandArrayParams    (const char* query, ParamDesc* paramList);
+HTAB*           lookupCreate         (MemoryContext cxt, const char* name);
+bool            fullLoad             (DB2FdwState* fdw_state, TupleTableSlot* slot);
+void            fullLookup           (DB2FdwState* fdw_state, ExprContext* econtext);
+uint32          fullHash             (Datum value, Oid type, Oid collation, uint32 hash);
 
 /** db2IterateForeignScan
- *   On first invocation (if there is no DB2 statement yet),
+ *   On first invocation (if there is no open DB2 cursor yet),
  *   get the actual parameter values and run the remote query against
  *   the DB2 database, retrieving the first result row.
+ *   The statement is only prepared once, after a rescan the prepared
+ *   statement is executed again with the new parameter values.
+ *   Only if an array parameter needs a different number of markers
+ *   for its IN list, the statement is prepared again.
+ *   Arrays with at least "key_table_threshold" elements are shipped into
+ *   a DB2 temporary table before each execution, and the IN list
+ *   selects from that table.
  *   Subsequent invocations will fetch more result rows until there
  *   are no more.
  *   The result is stored as a virtual tuple in the ScanState's
  *   TupleSlot and returned.
+ *   If the result is materialized for rescans, the rows are added to the
+ *   tuplestore, and after a rescan they are read from there.
+ *   Repeated parameter values are not cached here, Memoize does that above
+ *   the scan (PostgreSQL 14 and later).
+ *   Once a parameterized scan has sent as many lookups to DB2 as the plan
+ *   considers the break-even point, it fetches the full result without the
+ *   join conditions and answers all further lookups from that (see fullLoad).
  */
 TupleTableSlot* db2IterateForeignScan (ForeignScanState* node) {
   TupleTableSlot* slot      = node->ss.ss_ScanTupleSlot;
   ExprContext*    econtext  = node->ss.ps.ps_ExprContext;
   int             have_result;
   DB2FdwState*    fdw_state = (DB2FdwState*) node->fdw_state;
+  ParamDesc*      param;
   db2Debug1("> db2IterateForeignScan");
-  if (db2IsStatementOpen (fdw_state->session)) {
-    db2Debug3("  get next row in foreign table scan");
-    /* fetch the next result row */
-    have_result = db2FetchNext (fdw_state->session);
-  } else {
+  if (fdw_state->rescan_read) {
+    db2Debug3("  get next row from rescan cache");
+#if PG_VERSION_NUM < 100000
+    tuplestore_gettupleslot (fdw_state->rescan_store, true, slot);
+#elif PG_VERSION_NUM < 120000
+    tuplestore_gettupleslot (fdw_state->rescan_store, true, false, slot);
+#else
+    if (tuplestore_gettupleslot (fdw_state->rescan_store, true, false, fdw_state->rescan_slot))
+      ExecCopySlot (slot, fdw_state->rescan_slot);
+    else
+      ExecClearTuple (slot);
+#endif /* PG_VERSION_NUM */
+    if (!TupIsNull (slot))
+      ++fdw_state->rowcount;
+    db2Debug1("< db2IterateForeignScan");
+    return slot;
+  }
+  if (!fdw_state->lookup_read && !db2IsStatementOpen (fdw_state->session)) {
     /* fill the parameter list with the actual values */
     char* paramInfo = setSelectParameters (fdw_state->paramList, econtext);
-    /* execute the DB2 statement and fetch the first row */
-    db2Debug3("  execute query in foreign table scan '%s'", paramInfo);
-    db2PrepareQuery (fdw_state->session, fdw_state->query, fdw_state->db2Table, fdw_state->prefetch);
-    have_result = db2ExecuteQuery (fdw_state->session, fdw_state->db2Table, fdw_state->paramList);
-    have_result = db2FetchNext (fdw_state->session);
+    /* the outer side turned out to be large, switch to a single scan */
+    if (fdw_state->full_query != NULL && fdw_state->full_cache == NULL && fdw_state->lookups >= (unsigned long) fdw_state->full_after)
+      fullLoad (fdw_state, slot);
+    if (fdw_state->full_cache != NULL) {
+      db2Debug3("  look up '%s' in full result", paramInfo);
+      fullLookup (fdw_state, econtext);
+    } else {
+      /* execute the DB2 statement and fetch the first row */
+      db2Debug3("  execute query in foreign table scan '%s'", paramInfo);
+      ++fdw_state->lookups;
+      /* the IN lists of array parameters get as many markers as needed, or a key table */
+      if (resizeArrayParams (fdw_state->paramList, fdw_state->key_table_min) && db2IsStatementPrepared (fdw_state->session))
+        db2CloseStatement (fdw_state->session);
+      if (!db2IsStatementPrepared (fdw_state->session)) {
+        for (param = fdw_state->paramList; param; param = param->next)
+          if (param->isarray && param->nmarkers == 0)
+            db2DeclareKeyTable (fdw_state->session, param->keytable, param->keytype);
+        fdw_state->prefetch = budgetPrefetch (fdw_state);
+        db2PrepareQuery (fdw_state->session, expandArrayParams (fdw_state->query, fdw_state->paramList), fdw_state->db2Table, fdw_state->prefetch);
+      } else if (fdw_state->fetch_memory > 0 && fdw_state->fetch_rows > 0) {
+        /* size the prefetch by the rows seen so far */
+        unsigned int prefetch = budgetPrefetch (fdw_state);
+        if (prefetch != fdw_state->prefetch) {
+          db2Debug3("  prefetch %u rows instead of %u", prefetch, fdw_state->prefetch);
+          db2SetPrefetch (fdw_state->session, prefetch);
+          fdw_state->prefetch = prefetch;
+        }
+      }
+      /* ship the distinct elements of large arrays into their key tables */
+      for (param = fdw_state->paramList; param; param = param->next)
+        if (param->isarray && param->nmarkers == 0)
+          db2LoadKeyTable (fdw_state->session, param->keytable, param->elems, uniqueKeys (param->elems, param->nelems));
+      db2ExecuteQuery (fdw_state->session, fdw_state->db2Table, fdw_state->paramList);
+    }
   }
+  if (fdw_state->lookup_read) {
+    db2Debug3("  get next row from full result");
+    ExecClearTuple (slot);
+    if (fdw_state->lookup_next != NULL) {
+      MinimalTuple tuple = (MinimalTuple) lfirst (fdw_state->lookup_next);
+
+      fdw_state->lookup_next = list_next (fdw_state->lookup_entry->tuples, fdw_state->lookup_next);
+#if PG_VERSION_NUM < 120000
+      ExecStoreMinimalTuple (tuple, slot, false);
+#else
+      ExecForceStoreMinimalTuple (tuple, slot, false);
+#endif /* PG_VERSION_NUM */
+      ++fdw_state->rowcount;
+    }
+    db2Debug1("< db2IterateForeignScan");
+    return slot;
+  }
+  db2Debug3("  get next row in foreign table scan");
+  /* fetch the next result row */
+  have_result = db2FetchNext (fdw_state->session);
   /* initialize virtual tuple */
   ExecClearTuple (slot);
   if (have_result) {
@@ -69,14 +168,187 @@ TupleTableSlot* db2IterateForeignScan (ForeignScanState* node) {
     convertTuple (fdw_state, slot->tts_values, slot->tts_isnull, false);
     /* store the virtual tuple */
     ExecStoreVirtualTuple (slot);
+    /* keep a copy for rescans */
+    if (fdw_state->rescan_store != NULL)
+      tuplestore_puttupleslot (fdw_state->rescan_store, slot);
   } else {
-    /* close the statement */
-    db2CloseStatement (fdw_state->session);
+    /* close the cursor, keep the statement prepared for a rescan */
+    db2CloseCursor (fdw_state->session);
+    /* the rescan cache is complete now */
+    if (fdw_state->rescan_store != NULL)
+      fdw_state->rescan_full = true;
   }
   db2Debug1("< db2IterateForeignScan");
   return slot;
 }
 
+/** lookupCreate
+ *   Create a hash table of LookupEntry in memory context "cxt".
+ */
+HTAB* lookupCreate (MemoryContext cxt, const char* name) {
+  HASHCTL ctl;
+
+  memset (&ctl, 0, sizeof (ctl));
+  ctl.keysize   = sizeof (uint32);
+  ctl.entrysize = sizeof (LookupEntry);
+  ctl.hcxt      = cxt;
+  return hash_create (name, 256, &ctl, HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+}
+
+/** fullLoad
+ *   Fetch the result of the query without the parameterized join conditions
+ *   and store the rows in full_cache by the hash of their join keys.
+ *   If the rows do not fit into work_mem, the full result is discarded,
+ *   the scan goes on with lookups and will not try again.
+ *   "slot" is used to convert the rows.
+ *   Returns true if full_cache holds the full result.
+ */
+bool fullLoad (DB2FdwState* fdw_state, TupleTableSlot* slot) {
+  TupleDesc     tupdesc = slot->tts_tupleDescriptor;
+  MemoryContext oldcontext;
+  unsigned long nrows   = 0;
+  bool          fits    = true;
+
+  db2Debug1("> fullLoad");
+  db2Debug2("  %lu lookups, fetching full result: '%s'", fdw_state->lookups, fdw_state->full_query);
+  /* the statement for the lookups is prepared again if needed */
+  db2CloseStatement (fdw_state->session);
+  fdw_state->lookup_used  = 0;
+  fdw_state->full_cache   = lookupCreate (fdw_state->lookup_cxt, "db2_fdw full scan cache");
+  fdw_state->prefetch = budgetPrefetch (fdw_state);
+  db2PrepareQuery (fdw_state->session, fdw_state->full_query, fdw_state->db2Table, fdw_state->prefetch);
+  db2ExecuteQuery (fdw_state->session, fdw_state->db2Table, NULL);
+  while (fits && db2FetchNext (fdw_state->session)) {
+    ParamDesc*   param;
+    LookupEntry* entry;
+    MinimalTuple tuple;
+    uint32       hash = 0;
+    bool         found;
+    bool         isnull = false;
+
+    ExecClearTuple (slot);
+    convertTuple (fdw_state, slot->tts_values, slot->tts_isnull, false);
+    ExecStoreVirtualTuple (slot);
+    ++nrows;
+    /* hash the join keys, a row with a NULL key never matches */
+    for (param = fdw_state->paramList; param && !isnull; param = param->next) {
+      Form_pg_attribute attr = TupleDescAttr (tupdesc, param->keyattno - 1);
+
+      isnull = slot->tts_isnull[param->keyattno - 1];
+      if (!isnull)
+        hash = fullHash (slot->tts_values[param->keyattno - 1], attr->atttypid, attr->attcollation, hash);
+    }
+    if (isnull)
+      continue;
+    entry = (LookupEntry*) hash_search (fdw_state->full_cache, &hash, HASH_ENTER, &found);
+    if (!found)
+      entry->tuples = NIL;
+    oldcontext = MemoryContextSwitchTo (fdw_state->lookup_cxt);
+    tuple         = ExecCopySlotMinimalTuple (slot);
+    entry->tuples = lappend (entry->tuples, tuple);
+    MemoryContextSwitchTo (oldcontext);
+    fdw_state->lookup_used += tuple->t_len;
+    fits = (fdw_state->lookup_used <= (Size) work_mem * 1024L);
+  }
+  ExecClearTuple (slot);
+  db2CloseStatement (fdw_state->session);
+  if (!fits) {
+    /* go on with lookups */
+    db2Debug2("  full result exceeds work_mem after %lu rows, keep looking up", nrows);
+    MemoryContextReset (fdw_state->lookup_cxt);
+    fdw_state->full_cache   = NULL;
+    fdw_state->full_query   = NULL;
+    fdw_state->lookup_used  = 0;
+    db2Debug1("< fullLoad - returns: false");
+    return false;
+  }
+  db2Debug2("  full result of %lu rows uses %lu bytes", nrows, (unsigned long) fdw_state->lookup_used);
+  db2Debug1("< fullLoad - returns: true");
+  return true;
+}
+
+/** fullLookup
+ *   Collect the rows of full_cache whose join keys are equal to the current
+ *   parameter values in full_match and position the scan on them.
+ */
+void fullLookup (DB2FdwState* fdw_state, ExprContext* econtext) {
+  TupleTableSlot* keyslot = fdw_state->full_slot;
+  LookupEntry*    match   = fdw_state->full_match;
+  LookupEntry*    entry   = NULL;
+  ParamDesc*      param;
+  ListCell*       cell;
+  Datum*          values;
+  bool            isnull  = false;
+  uint32          hash    = 0;
+  int             nkeys   = 0;
+  MemoryContext   oldcontext;
+
+  db2Debug1("> fullLookup");
+  list_free (match->tuples);
+  match->tuples = NIL;
+  for (param = fdw_state->paramList; param; param = param->next)
+    ++nkeys;
+  values = (Datum*) palloc (sizeof (Datum) * nkeys);
+  /* evaluate and hash the parameter values */
+  oldcontext = MemoryContextSwitchTo (econtext->ecxt_per_tuple_memory);
+  nkeys = 0;
+  for (param = fdw_state->paramList; param && !isnull; param = param->next) {
+    Form_pg_attribute attr = TupleDescAttr (keyslot->tts_tupleDescriptor, param->keyattno - 1);
+
+#if PG_VERSION_NUM < 100000
+    values[nkeys] = ExecEvalExpr ((ExprState*) (param->node), econtext, &isnull, NULL);
+#else
+    values[nkeys] = ExecEvalExpr ((ExprState*) (param->node), econtext, &isnull);
+#endif /* PG_VERSION_NUM */
+    if (!isnull)
+      hash = fullHash (values[nkeys], attr->atttypid, attr->attcollation, hash);
+    ++nkeys;
+  }
+  MemoryContextSwitchTo (oldcontext);
+  if (!isnull)
+    entry = (LookupEntry*) hash_search (fdw_state->full_cache, &hash, HASH_FIND, NULL);
+  /* compare the keys of the rows with the same hash */
+  if (entry != NULL) {
+    foreach (cell, entry->tuples) {
+      MinimalTuple tuple = (MinimalTuple) lfirst (cell);
+      bool         equal = true;
+
+      ExecStoreMinimalTuple (tuple, keyslot, false);
+      nkeys = 0;
+      for (param = fdw_state->paramList; param && equal; param = param->next) {
+        Form_pg_attribute attr     = TupleDescAttr (keyslot->tts_tupleDescriptor, param->keyattno - 1);
+        TypeCacheEntry*   typentry = lookup_type_cache (attr->atttypid, TYPECACHE_EQ_OPR_FINFO);
+        bool              keynull;
+        Datum             key      = slot_getattr (keyslot, param->keyattno, &keynull);
+
+        equal = !keynull && DatumGetBool (FunctionCall2Coll (&typentry->eq_opr_finfo, attr->attcollation, key, values[nkeys]));
+        ++nkeys;
+      }
+      if (equal) {
+        oldcontext = MemoryContextSwitchTo (fdw_state->lookup_cxt);
+        match->tuples = lappend (match->tuples, tuple);
+        MemoryContextSwitchTo (oldcontext);
+      }
+    }
+    ExecClearTuple (keyslot);
+  }
+  pfree (values);
+  fdw_state->lookup_entry = match;
+  fdw_state->lookup_next  = list_head (match->tuples);
+  fdw_state->lookup_read  = true;
+  db2Debug1("< fullLookup");
+}
+
+/** fullHash
+ *   Combine "hash" with the hash of a join key value of type "type".
+ */
+uint32 fullHash (Datum value, Oid type, Oid collation, uint32 hash) {
+  TypeCacheEntry* typentry = lookup_type_cache (type, TYPECACHE_HASH_PROC_FINFO);
+
+  hash = (hash << 1) | (hash >> 31);
+  return hash ^ DatumGetUInt32 (FunctionCall1Coll (&typentry->hash_proc_finfo, collation, value));
+}
+
 /** setSelectParameters
  *   Set the current values of the parameters into paramList.
  *   Return a string containing the parameters set for a DEBUG message.
@@ -84,8 +356,9 @@ TupleTableSlot* db2IterateForeignScan (ForeignScanState* node) {
 char* setSelectParameters (ParamDesc* paramList, ExprContext* econtext) {
   ParamDesc*     param;
   Datum          datum;
-  HeapTuple      tuple;
   TimestampTz    tstamp;
+  Oid            typoutput;
+  bool           typIsVarlena;
   bool           is_null;
   bool           first_param = true;
 #ifndef OLD_FDW_API
@@ -123,38 +396,40 @@ char* setSelectParameters (ParamDesc* paramList, ExprContext* econtext) {
 #endif /* PG_VERSION_NUM */
     }
 
-    if (is_null) {
-      param->value = NULL;
-    } else {
-      if (param->type == DATEOID)
-        param->value = deparseDate (datum);
-      else if (param->type == TIMESTAMPOID || param->type == TIMESTAMPTZOID)
-        param->value = deparseTimestamp (datum, false/*(param->type == TIMESTAMPTZOID)*/);
-      else if (param->type == TIMEOID || param->type == TIMETZOID)
-        param->value = deparseTimestamp (datum, false/*(param->type == TIMETZOID)*/);
-      else {
-        regproc typoutput;
-
-        /* get the type's output function */
-        tuple = SearchSysCache1 (TYPEOID, ObjectIdGetDatum (param->type));
-        if (!HeapTupleIsValid (tuple)) {
-          elog (ERROR, "cache lookup failed for type %u", param->type);
-        }
-        typoutput = ((Form_pg_type) GETSTRUCT (tuple))->typoutput;
-        ReleaseSysCache (tuple);
+    if (param->isarray) {
+      /* render all elements of the array */
+      param->value  = NULL;
+      param->elems  = NULL;
+      param->nelems = 0;
+      if (!is_null) {
+        Datum* elem_values;
+        bool*  elem_nulls;
+        int16  typlen;
+        bool   typbyval;
+        char   typalign;
+        int    i;
 
-        /* convert the parameter value into a string */
-        param->value = DatumGetCString (OidFunctionCall1 (typoutput, datum));
+        get_typlenbyvalalign (param->type, &typlen, &typbyval, &typalign);
+        deconstruct_array (DatumGetArrayTypeP (datum), param->type, typlen, typbyval, typalign, &elem_values, &elem_nulls, &param->nelems);
+        getTypeOutputInfo (param->type, &typoutput, &typIsVarlena);
+        param->elems = (char**) palloc (sizeof (char*) * (param->nelems + 1));
+        for (i = 0; i < param->nelems; ++i)
+          param->elems[i] = elem_nulls[i] ? NULL : paramValueString (elem_values[i], param->type, typoutput);
       }
+    } else if (is_null) {
+      param->value = NULL;
+    } else {
+      getTypeOutputInfo (param->type, &typoutput, &typIsVarlena);
+      param->value = paramValueString (datum, param->type, typoutput);
     }
 
     /* build a parameter list for the DEBUG message */
-    if (first_param) {
-      first_param = false;
-      appendStringInfo (&info, ", parameters ?=\"%s\"", (param->value ? param->value : "(null)"));
-    } else {
-      appendStringInfo (&info, ", ?=\"%s\"", (param->value ? param->value : "(null)"));
-    }
+    appendStringInfoString (&info, first_param ? ", parameters " : ", ");
+    first_param = false;
+    if (param->isarray)
+      appendStringInfo (&info, "?=array of %d elements", param->nelems);
+    else
+      appendStringInfo (&info, "?=\"%s\"", (param->value ? param->value : "(null)"));
   }
 
 #ifndef OLD_FDW_API
@@ -166,3 +441,255 @@ char* setSelectParameters (ParamDesc* paramList, ExprContext* econtext) {
   return info.data;
 }
 
+/** paramValueString
+ *   Render a parameter value for DB2, "typoutput" is the type's output function.
+ */
+char* paramValueString (Datum datum, Oid type, Oid typoutput) {
+  if (type == DATEOID)
+    return deparseDate (datum);
+  if (type == TIMESTAMPOID || type == TIMESTAMPTZOID)
+    return deparseTimestamp (datum, false/*(type == TIMESTAMPTZOID)*/);
+  if (type == TIMEOID || type == TIMETZOID)
+    return deparseTimestamp (datum, false/*(type == TIMETZOID)*/);
+  /* booleans are compared with 0 in the query */
+  if (type == BOOLOID)
+    return pstrdup (DatumGetBool (datum) ? "1" : "0");
+  if (type == BYTEAOID) {
+    /* hexadecimal digits for HEXTORAW */
+    bytea* value = DatumGetByteaPP (datum);
+    int    len   = VARSIZE_ANY_EXHDR (value);
+    char*  hex   = (char*) palloc (2 * len + 1);
+    int    i;
+
+    for (i = 0; i < len; ++i)
+      sprintf (hex + 2 * i, "%02X", (unsigned char) VARDATA_ANY (value)[i]);
+    hex[2 * len] = '\0';
+    return hex;
+  }
+  if (type == INTERVALOID) {
+    /*
+     * Months with sign in 11 characters, a blank, the microseconds with sign
+     * in 7 characters, a blank and the rest in seconds;
+     * the query adds them as MONTHS, MICROSECONDS and SECONDS durations.
+     */
+    Interval* span  = DatumGetIntervalP (datum);
+    int64     usecs = (int64) span->day * USECS_PER_DAY + span->time;
+    char*     str   = (char*) palloc (64);
+
+    snprintf ( str, 64, "%+011d %+07d " INT64_FORMAT
+             , span->month
+             , (int) (usecs % USECS_PER_SEC)
+             , usecs / USECS_PER_SEC
+             );
+    return str;
+  }
+  /* convert the parameter value into a string */
+  return OidOutputFunctionCall (typoutput, datum);
+}
+
+/** resizeArrayParams
+ *   Set the number of markers of each array parameter to the number of
+ *   its elements, rounded up to the next power of two. Rounding keeps the
+ *   number of distinct statements, and so the load on DB2's statement
+ *   cache, small; the surplus markers repeat the last element.
+ *   An array with at least "key_table_min" elements (if that is not 0)
+ *   gets no markers but a key table, and so does an array whose markers
+ *   would exceed the MAX_MARKERS DB2 accepts in a statement. The rounding
+ *   never goes beyond that limit either. An array with a NULL element only
+ *   uses a key table if it has to, markers treat the NULL exactly like
+ *   PostgreSQL does. An empty array gets -1 markers and is replaced by an
+ *   empty subquery, so that IN is false and NOT IN is true.
+ *   Returns true if any array parameter needs a different number of markers
+ *   or a different key table than before.
+ */
+bool resizeArrayParams (ParamDesc* paramList, int key_table_min) {
+  static int keytable_count = 0;
+  ParamDesc* param;
+  bool       changed = false;
+  int        available = MAX_MARKERS;
+
+  /* every other parameter takes one marker */
+  for (param = paramList; param; param = param->next)
+    if (!param->isarray)
+      --available;
+  for (param = paramList; param; param = param->next) {
+    int  nmarkers = 1;
+    bool has_null = false;
+    int  i;
+
+    if (!param->isarray)
+      continue;
+    for (i = 0; i < param->nelems && !has_null; ++i)
+      has_null = (param->elems[i] == NULL);
+    if (param->elems != NULL && param->nelems == 0) {
+      char keytype[20];
+
+      nmarkers = -1;
+      keyTableType (param, keytype, sizeof (keytype));
+      if (param->keytype == NULL || strcmp (param->keytype, keytype) != 0) {
+        param->keytype = pstrdup (keytype);
+        changed = true;
+      }
+    } else if ((key_table_min > 0 && param->nelems >= key_table_min && !has_null) || param->nelems > available) {
+      char keytype[20];
+
+      nmarkers = 0;
+      keyTableType (param, keytype, sizeof (keytype));
+      if (param->keytable == NULL) {
+        char keytable[40];
+
+        snprintf (keytable, sizeof (keytable), "SESSION.DB2FDW_KEYS_%d", ++keytable_count);
+        param->keytable = pstrdup (keytable);
+      }
+      if (param->keytype == NULL || strcmp (param->keytype, keytype) != 0) {
+        db2Debug2("  key table %s gets column type %s", param->keytable, keytype);
+        param->keytype = pstrdup (keytype);
+        changed = true;
+      }
+    } else {
+      while (nmarkers < param->nelems)
+        nmarkers <<= 1;
+      if (nmarkers > available)
+        nmarkers = available;
+      available -= nmarkers;
+    }
+    if (nmarkers != param->nmarkers) {
+      db2Debug2("  array parameter resized from %d to %d markers", param->nmarkers, nmarkers);
+      param->nmarkers = nmarkers;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+/** keyTableType
+ *   Store the DB2 column type of the key table for an array parameter in "keytype".
+ *   Strings get a VARCHAR long enough for the longest element, rounded up
+ *   to a power of two so that the table need not be redeclared often.
+ */
+void keyTableType (ParamDesc* param, char* keytype, size_t size) {
+  int i;
+  int len = 64;
+
+  switch (param->type) {
+    case INT2OID:
+    case INT4OID:
+    case INT8OID:
+    case OIDOID:
+      snprintf (keytype, size, "BIGINT");
+    break;
+    case FLOAT4OID:
+    case FLOAT8OID:
+      snprintf (keytype, size, "DOUBLE");
+    break;
+    case NUMERICOID:
+      snprintf (keytype, size, "DECFLOAT(34)");
+    break;
+    case DATEOID:
+      snprintf (keytype, size, "DATE");
+    break;
+    case TIMESTAMPOID:
+    case TIMESTAMPTZOID:
+      snprintf (keytype, size, "TIMESTAMP");
+    break;
+    case TIMEOID:
+    case TIMETZOID:
+      snprintf (keytype, size, "TIME");
+    break;
+    default:
+      for (i = 0; i < param->nelems; ++i)
+        while (param->elems[i] != NULL && (int) strlen (param->elems[i]) > len)
+          len <<= 1;
+      snprintf (keytype, size, "VARCHAR(%d)", len);
+    break;
+  }
+}
+
+/** uniqueKeys
+ *   Sort the non-NULL entries of "keys" to the front and remove duplicates.
+ *   If there were NULL entries, a single NULL entry is kept at the end.
+ *   Returns the number of remaining entries.
+ */
+int uniqueKeys (char** keys, int nkeys) {
+  int  i, n = 0;
+  bool has_null = false;
+
+  for (i = 0; i < nkeys; ++i) {
+    if (keys[i] != NULL)
+      keys[n++] = keys[i];
+    else
+      has_null = true;
+  }
+  if (n > 1) {
+    qsort (keys, n, sizeof (char*), compareKeys);
+    nkeys = 1;
+    for (i = 1; i < n; ++i)
+      if (strcmp (keys[i], keys[nkeys - 1]) != 0)
+        keys[nkeys++] = keys[i];
+    n = nkeys;
+  }
+  if (has_null)
+    keys[n++] = NULL;
+  return n;
+}
+
+/** compareKeys
+ *   qsort comparator for uniqueKeys.
+ */
+int compareKeys (const void* a, const void* b) {
+  return strcmp (*(char* const*) a, *(char* const*) b);
+}
+
+/** expandArrayParams
+ *   Return the query with the marker of each array parameter expanded
+ *   to the list of markers for its elements, or to a subquery on its
+ *   key table.
+ *   The parameters in paramList are in the order of the markers in the query.
+ */
+char* expandArrayParams (const char* query, ParamDesc* paramList) {
+  StringInfoData result;
+  ParamDesc*     param;
+  const char*    p;
+  bool           in_quote = false, in_dquote = false;
+  int            i;
+
+  for (param = paramList; param && !param->isarray; param = param->next)
+    ;
+  if (param == NULL)
+    return (char*) query;
+
+  initStringInfo (&result);
+  param = paramList;
+  for (p = query; *p != '\0'; ++p) {
+    /* quotes inside quoted identifiers and string literals do not count */
+    if (*p == '\'' && !in_dquote)
+      in_quote = !in_quote;
+    if (*p == '"' && !in_quote)
+      in_dquote = !in_dquote;
+    if (in_quote || in_dquote || *p != '?' || param == NULL) {
+      appendStringInfoChar (&result, *p);
+      continue;
+    }
+    if (param->isarray) {
+      /* keep the tag comment, then add the markers for the other elements */
+      const char* end = (strncmp (p + 1, "/*:", 3) == 0) ? strstr (p, "*/") : NULL;
+
+      end = (end == NULL) ? p + 1 : end + 2;
+      if (param->nmarkers < 0)
+        appendStringInfo (&result, "SELECT CAST (NULL AS %s) FROM SYSIBM.SYSDUMMY1 WHERE 1 = 0", param->keytype);
+      else if (param->nmarkers == 0)
+        appendStringInfo (&result, "SELECT K FROM %s", param->keytable);
+      else
+        appendStringInfoChar (&result, '?');
+      appendBinaryStringInfo (&result, p + 1, end - p - 1);
+      p = end - 1;
+      for (i = 1; i < param->nmarkers; ++i)
+        appendStringInfoString (&result, ", ?");
+    } else {
+      appendStringInfoChar (&result, *p);
+    }
+    param = param->next;
+  }
+  db2Debug2("  expanded query: '%s'", result.data);
+  return result.data;
+}
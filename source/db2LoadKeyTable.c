@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <string.h>
+#include <sqlcli1.h>
+#include <postgres_ext.h>
+#include "db2_fdw.h"
+
+/** global variables */
+
+/** external variables */
+extern char         db2Message[ERRBUFSIZE];/* contains DB2 error messages, set by db2CheckErr()             */
+
+/** external prototypes */
+extern void*        db2alloc             (const char* type, size_t size);
+extern void         db2free              (void* p);
+extern void         db2Debug1            (const char* message, ...);
+extern void         db2Debug2            (const char* message, ...);
+extern SQLRETURN    db2CheckErr          (SQLRETURN status, SQLHANDLE handle, SQLSMALLINT handleType, int line, char* file);
+extern void         db2Error_d           (db2error sqlstate, const char* message, const char* detail, ...);
+extern HdlEntry*    db2AllocStmtHdl      (SQLSMALLINT type, DB2ConnEntry* connp, db2error error, const char* errmsg);
+extern void         db2FreeStmtHdl       (HdlEntry* handlep, DB2ConnEntry* connp);
+
+/** internal prototypes */
+void                db2LoadKeyTable      (DB2Session* session, const char* tabname, char** keys, int nkeys);
+
+/** db2LoadKeyTable
+ *   Replace the content of the key table "tabname" with "keys".
+ *   NULL entries are inserted as NULL, so that IN yields NULL for keys
+ *   that are not in the table, like a NULL array element in PostgreSQL.
+ *   The keys are inserted as strings with parameter arrays, KEY_TABLE_CHUNK
+ *   rows per execution of the INSERT, DB2 converts them to the column type.
+ */
+void db2LoadKeyTable (DB2Session* session, const char* tabname, char** keys, int nkeys) {
+  HdlEntry*   stmtp  = NULL;
+  SQLRETURN   rc     = 0;
+  SQLCHAR*    values = NULL;
+  SQLLEN*     ind    = NULL;
+  SQLLEN      width  = 1;
+  int         i, n;
+  char        stmt[256];
+
+  db2Debug1("> db2LoadKeyTable");
+  db2Debug2("  tabname: '%s', nkeys: %d", tabname, nkeys);
+  stmtp = db2AllocStmtHdl (SQL_HANDLE_STMT, session->connp, FDW_UNABLE_TO_CREATE_EXECUTION, "error loading key table: failed to allocate statement handle");
+
+  /* remove the keys of the previous execution */
+  snprintf (stmt, sizeof (stmt), "DELETE FROM %s", tabname);
+  rc = SQLExecDirect (stmtp->hsql, (SQLCHAR*) stmt, SQL_NTS);
+  rc = db2CheckErr (rc, stmtp->hsql, stmtp->type, __LINE__, __FILE__);
+  if (rc != SQL_SUCCESS && rc != SQL_NO_DATA) {
+    db2Error_d (FDW_UNABLE_TO_CREATE_EXECUTION, "error loading key table: SQLExecDirect failed to delete rows", db2Message);
+  }
+
+  /* the buffer for one chunk of keys, bound column-wise */
+  for (i = 0; i < nkeys; ++i)
+    if (keys[i] != NULL && (SQLLEN) strlen (keys[i]) + 1 > width)
+      width = strlen (keys[i]) + 1;
+  values = db2alloc ("key table values", KEY_TABLE_CHUNK * width);
+  ind    = db2alloc ("key table indicators", KEY_TABLE_CHUNK * sizeof (SQLLEN));
+
+  snprintf (stmt, sizeof (stmt), "INSERT INTO %s VALUES (?)", tabname);
+  rc = SQLPrepare (stmtp->hsql, (SQLCHAR*) stmt, SQL_NTS);
+  rc = db2CheckErr (rc, stmtp->hsql, stmtp->type, __LINE__, __FILE__);
+  if (rc != SQL_SUCCESS) {
+    db2Error_d (FDW_UNABLE_TO_CREATE_EXECUTION, "error loading key table: SQLPrepare failed to prepare insert", db2Message);
+  }
+  rc = SQLSetStmtAttr (stmtp->hsql, SQL_ATTR_PARAM_BIND_TYPE, (SQLPOINTER) SQL_PARAM_BIND_BY_COLUMN, 0);
+  rc = db2CheckErr (rc, stmtp->hsql, stmtp->type, __LINE__, __FILE__);
+  if (rc != SQL_SUCCESS) {
+    db2Error_d (FDW_UNABLE_TO_CREATE_EXECUTION, "error loading key table: SQLSetStmtAttr failed to set column-wise binding", db2Message);
+  }
+  rc = SQLBindParameter (stmtp->hsql, 1, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_VARCHAR, width - 1, 0, values, width, ind);
+  rc = db2CheckErr (rc, stmtp->hsql, stmtp->type, __LINE__, __FILE__);
+  if (rc != SQL_SUCCESS) {
+    db2Error_d (FDW_UNABLE_TO_CREATE_EXECUTION, "error loading key table: SQLBindParameter failed to bind parameter array", db2Message);
+  }
+
+  i = 0;
+  while (i < nkeys) {
+    /* fill the next chunk */
+    for (n = 0; i < nkeys && n < KEY_TABLE_CHUNK; ++i) {
+      if (keys[i] == NULL) {
+        values[n * width] = '\0';
+        ind[n] = SQL_NULL_DATA;
+      } else {
+        strcpy ((char*) values + n * width, keys[i]);
+        ind[n] = SQL_NTS;
+      }
+      ++n;
+    }
+    if (n == 0)
+      break;
+    rc = SQLSetStmtAttr (stmtp->hsql, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER) (SQLULEN) n, 0);
+    rc = db2CheckErr (rc, stmtp->hsql, stmtp->type, __LINE__, __FILE__);
+    if (rc != SQL_SUCCESS) {
+      db2Error_d (FDW_UNABLE_TO_CREATE_EXECUTION, "error loading key table: SQLSetStmtAttr failed to set parameter array size", db2Message);
+    }
+    rc = SQLExecute (stmtp->hsql);
+    rc = db2CheckErr (rc, stmtp->hsql, stmtp->type, __LINE__, __FILE__);
+    if (rc != SQL_SUCCESS) {
+      db2Error_d (FDW_UNABLE_TO_CREATE_EXECUTION, "error loading key table: SQLExecute failed to insert keys", db2Message);
+    }
+    db2Debug2("  inserted %d keys", n);
+  }
+
+  db2FreeStmtHdl (stmtp, session->connp);
+  db2free (ind);
+  db2free (values);
+  db2Debug1("< db2LoadKeyTable");
+}
@@ -0,0 +1,119 @@
+#include <string.h>
+#include <sqlcli1.h>
+#include <postgres_ext.h>
+#include "db2_fdw.h"
+#include "ParamDesc.h"
+
+/** global variables */
+
+/** external variables */
+extern char         db2Message[ERRBUFSIZE];/* contains DB2 error messages, set by db2CheckErr()             */
+
+/** external prototypes */
+extern void*        db2alloc             (const char* type, size_t size);
+extern void         db2free              (void* p);
+extern void         db2Debug1            (const char* message, ...);
+extern void         db2Debug2            (const char* message, ...);
+extern SQLRETURN    db2CheckErr          (SQLRETURN status, SQLHANDLE handle, SQLSMALLINT handleType, int line, char* file);
+extern void         db2Error_d           (db2error sqlstate, const char* message, const char* detail, ...);
+
+/** internal prototypes */
+int                 db2LoadRows          (DB2Session* session, const DB2Table* db2Table, ParamDesc* paramList, int nrows, char** values, long* lengths);
+
+/** db2LoadRows
+ *   Hand "nrows" rows to the LOAD started with db2BeginLoad, in one execution
+ *   with parameter arrays bound column-wise.
+ *   The values of the n-th parameter of paramList are values[n * nrows] to
+ *   values[n * nrows + nrows - 1], NULL for a NULL value, with their lengths
+ *   in "lengths" (character values need not be terminated).
+ *   Returns the number of rows DB2 reports as processed.
+ */
+int db2LoadRows (DB2Session* session, const DB2Table* db2Table, ParamDesc* paramList, int nrows, char** values, long* lengths) {
+  HdlEntry*   stmtp     = session->stmtp;
+  ParamDesc*  param     = NULL;
+  SQLRETURN   rc        = 0;
+  SQLCHAR**   buffers   = NULL;
+  SQLLEN**    ind       = NULL;
+  SQLULEN     processed = 0;
+  int         nparams   = 0;
+  int         n, i;
+
+  db2Debug1("> db2LoadRows");
+  db2Debug2("  rows: %d", nrows);
+  for (param = paramList; param != NULL; param = param->next)
+    ++nparams;
+  buffers = db2alloc ("load buffers", (nparams + 1) * sizeof (SQLCHAR*));
+  ind     = db2alloc ("load indicators", (nparams + 1) * sizeof (SQLLEN*));
+
+  for (param = paramList, n = 0; param != NULL; param = param->next, ++n) {
+    DB2Column*  col     = db2Table->cols[param->colnum];
+    char**      val     = values  + n * nrows;
+    long*       len     = lengths + n * nrows;
+    SQLLEN      width   = 1;
+    SQLSMALLINT c_type  = SQL_C_CHAR;
+    SQLSMALLINT sqltype = col->colType;
+
+    /* one buffer element per row, as wide as the longest value */
+    for (i = 0; i < nrows; ++i)
+      if (val[i] != NULL && (SQLLEN) len[i] + 1 > width)
+        width = len[i] + 1;
+    buffers[n] = db2alloc ("load values", nrows * width);
+    ind[n]     = db2alloc ("load value indicators", nrows * sizeof (SQLLEN));
+    for (i = 0; i < nrows; ++i) {
+      if (val[i] == NULL) {
+        ind[n][i] = SQL_NULL_DATA;
+      } else {
+        memcpy (buffers[n] + i * width, val[i], len[i]);
+        ind[n][i] = (SQLLEN) len[i];
+      }
+    }
+
+    /* the same types as db2ExecuteInsert, numbers are converted by DB2 from their text */
+    switch (param->bindType) {
+      case BIND_LONGRAW:
+        c_type  = SQL_C_BINARY;
+      break;
+      case BIND_LONG:
+        sqltype = SQL_LONGVARCHAR;
+      break;
+      case BIND_STRING:
+        sqltype = SQL_VARCHAR;
+      break;
+      default:
+      break;
+    }
+    db2Debug2("  colName: %s, width: %d", col->colName, width);
+    rc = SQLBindParameter (stmtp->hsql, param->colnum + 1, SQL_PARAM_INPUT, c_type, sqltype, col->colSize, col->colScale, buffers[n], width, ind[n]);
+    rc = db2CheckErr (rc, stmtp->hsql, stmtp->type, __LINE__, __FILE__);
+    if (rc != SQL_SUCCESS) {
+      db2Error_d (FDW_UNABLE_TO_CREATE_EXECUTION, "error loading rows: SQLBindParameter failed to bind parameter array", db2Message);
+    }
+  }
+
+  rc = SQLSetStmtAttr (stmtp->hsql, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER) (SQLULEN) nrows, 0);
+  rc = db2CheckErr (rc, stmtp->hsql, stmtp->type, __LINE__, __FILE__);
+  if (rc != SQL_SUCCESS) {
+    db2Error_d (FDW_UNABLE_TO_CREATE_EXECUTION, "error loading rows: SQLSetStmtAttr failed to set parameter array size", db2Message);
+  }
+  rc = SQLSetStmtAttr (stmtp->hsql, SQL_ATTR_PARAMS_PROCESSED_PTR, (SQLPOINTER) &processed, 0);
+  rc = db2CheckErr (rc, stmtp->hsql, stmtp->type, __LINE__, __FILE__);
+  if (rc != SQL_SUCCESS) {
+    db2Error_d (FDW_UNABLE_TO_CREATE_EXECUTION, "error loading rows: SQLSetStmtAttr failed to set processed rows pointer", db2Message);
+  }
+  rc = SQLExecute (stmtp->hsql);
+  rc = db2CheckErr (rc, stmtp->hsql, stmtp->type, __LINE__, __FILE__);
+  if (rc != SQL_SUCCESS) {
+    db2Error_d (FDW_UNABLE_TO_CREATE_EXECUTION, "error loading rows: SQLExecute failed to load rows", db2Message);
+  }
+  /* "processed" goes out of scope */
+  SQLSetStmtAttr (stmtp->hsql, SQL_ATTR_PARAMS_PROCESSED_PTR, NULL, 0);
+
+  for (n = 0; n < nparams; ++n) {
+    db2free (ind[n]);
+    db2free (buffers[n]);
+  }
+  db2free (ind);
+  db2free (buffers);
+  db2Debug1("< db2LoadRows - returns: %d", (int) processed);
+  return (int) processed;
+}
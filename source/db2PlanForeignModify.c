@@ -25,6 +25,8 @@ extern void         db2Debug4                 (const char* message, ...);
 extern void         db2Debug5                 (const char* message, ...);
 extern short        c2dbType                  (short fcType);
 extern void         appendAsType              (StringInfoData* dest, Oid type);
+extern void         buildAttrMap              (DB2Table* db2Table);
+extern int          db2ColumnIndex            (const DB2Table* db2Table, int attnum);
 
 /** local prototypes */
 List*        db2PlanForeignModify(PlannerInfo* root, ModifyTable* plan, Index resultRelation, int subplan_index);
@@ -34,8 +36,9 @@ void         addParam            (ParamDesc** paramList, Oid pgtype, short colTy
 #endif
 void         checkDataType       (short db2type, int scale, Oid pgtype, const char* tablename, const char* colname);
 List*        serializePlanData   (DB2FdwState* fdwState);
-Const*       serializeString     (const char* s);
-Const*       serializeLong       (long i);
+void         packInt             (StringInfo buf, int32 value);
+void         packLong            (StringInfo buf, int64 value);
+void         packString          (StringInfo buf, const char* s);
 
 /** db2PlanForeignModify
  *   Construct an DB2FdwState or copy it from the foreign scan plan.
@@ -223,15 +226,11 @@ List* db2PlanForeignModify (PlannerInfo* root, ModifyTable* plan, Index resultRe
     case CMD_UPDATE:
       appendStringInfo (&sql, "UPDATE %s SET ", fdwState->db2Table->name);
       firstcol = true;
-      i = 0;
       foreach (cell, targetAttrs) {
         /* find the corresponding db2Table entry */
-        while (i < fdwState->db2Table->ncols && fdwState->db2Table->cols[i]->pgattnum < lfirst_int (cell))
-          ++i;
-        if (i == fdwState->db2Table->ncols)
-          break;
+        i = db2ColumnIndex (fdwState->db2Table, lfirst_int (cell));
         /* ignore columns that don't occur in the foreign table */
-        if (fdwState->db2Table->cols[i]->pgtype == 0)
+        if (i < 0 || fdwState->db2Table->cols[i]->pgtype == 0)
           continue;
         /* check that the data types can be converted */
         checkDataType (fdwState->db2Table->cols[i]->colType, fdwState->db2Table->cols[i]->colScale, fdwState->db2Table->cols[i]->pgtype, fdwState->db2Table->pgname, fdwState->db2Table->cols[i]->pgname);
@@ -377,12 +376,18 @@ DB2FdwState* copyPlanData (DB2FdwState* orig) {
     copy->db2Table->cols[i]->val_len        = 0;
     copy->db2Table->cols[i]->val_null       = 0;
   }
+  buildAttrMap (copy->db2Table);
   copy->startup_cost = 0.0;
   copy->total_cost   = 0.0;
   copy->rowcount     = 0;
   copy->columnindex  = 0;
   copy->temp_cxt     = NULL;
   copy->order_clause = NULL;
+  copy->rescan_cache = orig->rescan_cache;
+  copy->key_table_min = orig->key_table_min;
+  copy->rescan_store = NULL;
+  copy->full_query   = NULL;
+  copy->full_keys    = NIL;
   db2Debug1("< copyPlanData");
   return copy;
 }
@@ -413,6 +418,12 @@ void addParam (ParamDesc **paramList, Oid pgtype, short colType, int colnum, int
     case DB2_BLOB:
       param->bindType = BIND_LONGRAW;
     break;
+    case DB2_BINARY:
+    case DB2_VARBINARY:
+    case DB2_LONGVARBINARY:
+      /* bytea is bound as raw bytes, other types as their hexadecimal string */
+      param->bindType = (pgtype == BYTEAOID) ? BIND_LONGRAW : BIND_STRING;
+    break;
     default:
       param->bindType = BIND_STRING;
   }
@@ -436,8 +447,8 @@ void checkDataType (short sqltype, int scale, Oid pgtype, const char *tablename,
   db2Debug4("> checkDataType");
   db2Debug4("  checkDataType: %s.%s of sqltype: %d, db2type: %d, pgtype: %d",tablename,colname,sqltype, db2type, pgtype);
   /* the binary DB2 types can be converted to bytea */
-  if (db2type == DB2_BLOB && pgtype == BYTEAOID) {
-    db2Debug5("  DB2_BLOB can be converted into BYTEAOID");
+  if ((db2type == DB2_BLOB || db2type == DB2_BINARY || db2type == DB2_VARBINARY || db2type == DB2_LONGVARBINARY) && pgtype == BYTEAOID) {
+    db2Debug5("  DB2_BLOB, BINARY, VARBINARY, LONGVARBINARY can be converted into BYTEAOID");
   } else if (db2type == DB2_XML && pgtype == XMLOID) {
     db2Debug5("  DB2_XML can be converted into XMLOID");
   } else if (db2type != DB2_UNKNOWN_TYPE && db2type != DB2_BLOB && (pgtype == TEXTOID || pgtype == VARCHAROID || pgtype == BPCHAROID)) {
@@ -466,57 +477,87 @@ void checkDataType (short sqltype, int scale, Oid pgtype, const char *tablename,
 }
 
 /** serializePlanData
- *   Create a List representation of plan data that copyObject can copy.
- *   This List can be parsed by deserializePlanData.
+ *   Create a representation of plan data that copyObject can copy.
+ *   It is a List with a single bytea Const that holds the data in binary
+ *   form, starting with DB2_PLAN_VERSION, so that copying, caching and
+ *   serializing the plan handles one block of memory, however many
+ *   columns the table has. It can be parsed by deserializePlanData.
+ *   Values are stored in the byte order of the server.
  */
 List* serializePlanData (DB2FdwState* fdwState) {
-  List*      result   = NIL;
-  int        idxCol   = 0;
-  int        lenParam = 0;
-  ParamDesc* param    = NULL;
+  StringInfoData buf;
+  bytea*         blob;
+  List*          result   = NIL;
+  int            idxCol   = 0;
+  int            lenParam = 0;
+  ParamDesc*     param    = NULL;
+  ListCell*      cell;
 
   db2Debug1("> serializePlanData");
+  initStringInfo (&buf);
+  /* room for the varlena header */
+  appendStringInfoSpaces (&buf, VARHDRSZ);
+  /* format version */
+  packInt (&buf, DB2_PLAN_VERSION);
   /* dbserver */
-  result = lappend (result, serializeString (fdwState->dbserver));
+  packString (&buf, fdwState->dbserver);
   /* user name */
-  result = lappend (result, serializeString (fdwState->user));
+  packString (&buf, fdwState->user);
   /* password */
-  result = lappend (result, serializeString (fdwState->password));
+  packString (&buf, fdwState->password);
   /* nls_lang */
-  result = lappend (result, serializeString (fdwState->nls_lang));
+  packString (&buf, fdwState->nls_lang);
   /* query */
-  result = lappend (result, serializeString (fdwState->query));
+  packString (&buf, fdwState->query);
   /* DB2 prefetch count */
-  result = lappend (result, serializeInt ((int) fdwState->prefetch));
+  packInt (&buf, (int) fdwState->prefetch);
+  packInt (&buf, fdwState->fetch_memory);
+  packInt (&buf, fdwState->column_buffer);
+  /* rescan cache */
+  packInt (&buf, (int) fdwState->rescan_cache);
+  /* key table threshold */
+  packInt (&buf, fdwState->key_table_min);
+  /* LOAD utility */
+  packInt (&buf, (int) fdwState->load_mode);
+  packInt (&buf, fdwState->load_savecount);
+  packString (&buf, fdwState->load_messages);
+  /* full scan instead of lookups */
+  packString (&buf, fdwState->full_query);
+  packInt (&buf, fdwState->full_after);
+  packInt (&buf, list_length (fdwState->full_keys));
+  foreach (cell, fdwState->full_keys)
+    packInt (&buf, lfirst_int (cell));
   /* DB2 table name */
-  result = lappend (result, serializeString (fdwState->db2Table->name));
+  packString (&buf, fdwState->db2Table->name);
   /* PostgreSQL table name */
-  result = lappend (result, serializeString (fdwState->db2Table->pgname));
+  packString (&buf, fdwState->db2Table->pgname);
   /* batch size in DB2 table */
-  result = lappend (result, serializeInt (fdwState->db2Table->batchsz));
+  packInt (&buf, fdwState->db2Table->batchsz);
   /* number of columns in DB2 table */
-  result = lappend (result, serializeInt (fdwState->db2Table->ncols));
+  packInt (&buf, fdwState->db2Table->ncols);
   /* number of columns in PostgreSQL table */
-  result = lappend (result, serializeInt (fdwState->db2Table->npgcols));
+  packInt (&buf, fdwState->db2Table->npgcols);
   /* column data */
   for (idxCol = 0; idxCol < fdwState->db2Table->ncols; ++idxCol) {
-    result = lappend (result, serializeString (fdwState->db2Table->cols[idxCol]->colName));
-    result = lappend (result, serializeInt    (fdwState->db2Table->cols[idxCol]->colType));
-    result = lappend (result, serializeInt    (fdwState->db2Table->cols[idxCol]->colSize));
-    result = lappend (result, serializeInt    (fdwState->db2Table->cols[idxCol]->colScale));
-    result = lappend (result, serializeInt    (fdwState->db2Table->cols[idxCol]->colNulls));
-    result = lappend (result, serializeInt    (fdwState->db2Table->cols[idxCol]->colChars));
-    result = lappend (result, serializeInt    (fdwState->db2Table->cols[idxCol]->colBytes));
-    result = lappend (result, serializeInt    (fdwState->db2Table->cols[idxCol]->colPrimKeyPart));
-    result = lappend (result, serializeInt    (fdwState->db2Table->cols[idxCol]->colCodepage));
-    result = lappend (result, serializeString (fdwState->db2Table->cols[idxCol]->pgname));
-    result = lappend (result, serializeInt    (fdwState->db2Table->cols[idxCol]->pgattnum));
-    result = lappend (result, serializeOid    (fdwState->db2Table->cols[idxCol]->pgtype));
-    result = lappend (result, serializeInt    (fdwState->db2Table->cols[idxCol]->pgtypmod));
-    result = lappend (result, serializeInt    (fdwState->db2Table->cols[idxCol]->used));
-    result = lappend (result, serializeInt    (fdwState->db2Table->cols[idxCol]->pkey));
-    result = lappend (result, serializeLong   (fdwState->db2Table->cols[idxCol]->val_size));
-    result = lappend (result, serializeInt    (fdwState->db2Table->cols[idxCol]->noencerr));
+    DB2Column* col = fdwState->db2Table->cols[idxCol];
+
+    packString (&buf, col->colName);
+    packInt    (&buf, col->colType);
+    packLong   (&buf, col->colSize);
+    packInt    (&buf, col->colScale);
+    packInt    (&buf, col->colNulls);
+    packLong   (&buf, col->colChars);
+    packLong   (&buf, col->colBytes);
+    packInt    (&buf, col->colPrimKeyPart);
+    packInt    (&buf, col->colCodepage);
+    packString (&buf, col->pgname);
+    packInt    (&buf, col->pgattnum);
+    packInt    (&buf, (int) col->pgtype);
+    packInt    (&buf, col->pgtypmod);
+    packInt    (&buf, col->used);
+    packInt    (&buf, col->pkey);
+    packLong   (&buf, col->val_size);
+    packInt    (&buf, col->noencerr);
     /* don't serialize val, val_len, val_null and varno */
   }
 
@@ -525,48 +566,46 @@ List* serializePlanData (DB2FdwState* fdwState) {
     ++lenParam;
   }
   /* serialize length */
-  result = lappend (result, serializeInt (lenParam));
+  packInt (&buf, lenParam);
   /* parameter list entries */
   for (param = fdwState->paramList; param; param = param->next) {
-    result = lappend (result, serializeOid (param->type));
-    result = lappend (result, serializeInt ((int) param->bindType));
-    result = lappend (result, serializeInt ((int) param->colnum));
-    result = lappend (result, serializeInt ((int) param->txts));
+    packInt (&buf, (int) param->type);
+    packInt (&buf, (int) param->bindType);
+    packInt (&buf, (int) param->colnum);
+    packInt (&buf, (int) param->txts);
     /* don't serialize value and node */
   }
   /* don't serialize params, startup_cost, total_cost, rowcount, columnindex, temp_cxt, order_clause and where_clause */
-  db2Debug1("< serializePlanData - returns: %x",result);
+  blob = (bytea*) buf.data;
+  SET_VARSIZE (blob, buf.len);
+  result = list_make1 (makeConst (BYTEAOID, -1, InvalidOid, -1, PointerGetDatum (blob), false, false));
+  db2Debug1("< serializePlanData - returns: %d bytes", buf.len);
   return result;
 }
 
-/** serializeString
- *   Create a Const that contains the string.
+/** packInt
+ *   Append an integer to the plan data.
  */
-Const* serializeString (const char* s) {
-  Const* result = NULL;
-  db2Debug1("> serializeString");
-  result = (s == NULL) ? makeNullConst (TEXTOID, -1, InvalidOid) 
-                       : makeConst (TEXTOID, -1, InvalidOid, -1, PointerGetDatum (cstring_to_text (s)), false, false);
-  db2Debug1("< serializeString - returns: %x",result);
-  return result;
+void packInt (StringInfo buf, int32 value) {
+  appendBinaryStringInfo (buf, (const char*) &value, sizeof (int32));
 }
 
-/** serializeLong
- *   Create a Const that contains the long integer.
+/** packLong
+ *   Append a long integer to the plan data.
  */
-Const* serializeLong (long i) {
-  Const* result = NULL;
-  db2Debug1("> serializeLong");
-  if (sizeof (long) <= 4)
-    result = makeConst (INT4OID, -1, InvalidOid, 4, Int32GetDatum ((int32) i), false, true);
-  else
-    result = makeConst (INT4OID, -1, InvalidOid, 8, Int64GetDatum ((int64) i), false,
-#ifdef USE_FLOAT8_BYVAL
-      true
-#else
-      false
-#endif /* USE_FLOAT8_BYVAL */
-      );
-  db2Debug1("< serializeLong - returns: %x",result);
-  return result;
+void packLong (StringInfo buf, int64 value) {
+  appendBinaryStringInfo (buf, (const char*) &value, sizeof (int64));
+}
+
+/** packString
+ *   Append a string to the plan data: its length, -1 for NULL,
+ *   followed by the string and its terminating zero byte.
+ */
+void packString (StringInfo buf, const char* s) {
+  if (s == NULL) {
+    packInt (buf, -1);
+  } else {
+    packInt (buf, (int32) strlen (s));
+    appendBinaryStringInfo (buf, s, strlen (s) + 1);
+  }
 }
@@ -116,6 +116,10 @@ void db2PrepareQuery (DB2Session* session, const char *query, DB2Table* db2Table
       if (db2Table->cols[i]->pgtype == UUIDOID) {
         fparamType = SQL_C_CHAR;
       }
+      /* bytea gets the bytes as they are, not their hexadecimal string */
+      if (db2Table->cols[i]->pgtype == BYTEAOID) {
+        fparamType = SQL_C_BINARY;
+      }
       db2Debug2("  db2Table->cols[%d]->colName       : '%s' ",i,db2Table->cols[i]->colName);
       db2Debug2("  db2Table->cols[%d]->colSize       : '%ld'",i,db2Table->cols[i]->colSize);
       db2Debug2("  db2Table->cols[%d]->colScale      : '%d' ",i,db2Table->cols[i]->colScale);
@@ -126,12 +130,18 @@ void db2PrepareQuery (DB2Session* session, const char *query, DB2Table* db2Table
       db2Debug2("  db2Table->cols[%d]->colCodepage   : '%d' ",i,db2Table->cols[i]->colCodepage);
       db2Debug2("  db2Table->cols[%d]->val           : '%x'" ,i,db2Table->cols[i]->val);
       db2Debug2("  db2Table->cols[%d]->val_size      : '%ld'",i,db2Table->cols[i]->val_size);
+      db2Debug2("  db2Table->cols[%d]->val_bound     : '%ld'",i,db2Table->cols[i]->val_bound);
       db2Debug2("  db2Table->cols[%d]->val_len       : '%d' ",i,db2Table->cols[i]->val_len);
       db2Debug2("  db2Table->cols[%d]->val_null      : '%d' ",i,db2Table->cols[i]->val_null);
       db2Debug2("  fparamType: %d (%s)",fparamType,param2name(fparamType));
       ++col_pos;
-      db2Debug2("  SQLBindCol(%d,%d,%d(%s),%x,%ld,%x)",session->stmtp->hsql,col_pos, fparamType, param2name(fparamType), db2Table->cols[i]->val, db2Table->cols[i]->val_size, &db2Table->cols[i]->val_null);
-      rc = SQLBindCol (session->stmtp->hsql,col_pos, fparamType, db2Table->cols[i]->val, db2Table->cols[i]->val_size, &db2Table->cols[i]->val_null);
+      if (db2Table->cols[i]->val_bound == 0) {
+        /* LOBs are not bound, db2GetLob reads them after the fetch */
+        db2Debug2("  column %d is read with SQLGetData", col_pos);
+        continue;
+      }
+      db2Debug2("  SQLBindCol(%d,%d,%d(%s),%x,%ld,%x)",session->stmtp->hsql,col_pos, fparamType, param2name(fparamType), db2Table->cols[i]->val, db2Table->cols[i]->val_bound, &db2Table->cols[i]->val_null);
+      rc = SQLBindCol (session->stmtp->hsql,col_pos, fparamType, db2Table->cols[i]->val, db2Table->cols[i]->val_bound, &db2Table->cols[i]->val_null);
       rc = db2CheckErr(rc, session->stmtp->hsql, session->stmtp->type, __LINE__, __FILE__);
       if (rc != SQL_SUCCESS) {
         db2Error_d(FDW_UNABLE_TO_CREATE_EXECUTION, "error executing query: SQLBindCol failed to define result value", db2Message);
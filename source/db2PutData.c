@@ -0,0 +1,61 @@
+#include <sqlcli1.h>
+#include <postgres_ext.h>
+#include "db2_fdw.h"
+#include "ParamDesc.h"
+
+/** global variables */
+
+/** external variables */
+extern char         db2Message[ERRBUFSIZE];/* contains DB2 error messages, set by db2CheckErr()             */
+
+/** external prototypes */
+extern void*        db2alloc             (const char* type, size_t size);
+extern void         db2free              (void* p);
+extern void         db2Debug1            (const char* message, ...);
+extern void         db2Debug2            (const char* message, ...);
+extern SQLRETURN    db2CheckErr          (SQLRETURN status, SQLHANDLE handle, SQLSMALLINT handleType, int line, char* file);
+extern void         db2Error_d           (db2error sqlstate, const char* message, const char* detail, ...);
+extern long         db2ReadLob           (void* lob, long offset, long length, char* buf, int text);
+
+/** local prototypes */
+SQLRETURN           db2PutData           (DB2Session* session);
+
+/** db2PutData
+ *   Send the values of the parameters bound with SQL_DATA_AT_EXEC after
+ *   SQLExecute returned SQL_NEED_DATA. The token of such a parameter is its
+ *   ParamDesc, the value is read from PostgreSQL in pieces of LOB_PUT_SIZE
+ *   bytes, so it never has to be in memory as a whole.
+ *   Returns the result of the execution.
+ */
+SQLRETURN db2PutData (DB2Session* session) {
+  SQLPOINTER token = NULL;
+  SQLRETURN  rc    = SQL_SUCCESS;
+  char*      buf   = NULL;
+
+  db2Debug1("> db2PutData");
+  while ((rc = SQLParamData (session->stmtp->hsql, &token)) == SQL_NEED_DATA) {
+    ParamDesc* param  = (ParamDesc*) token;
+    long       offset = 0;
+
+    if (buf == NULL)
+      buf = db2alloc ("lob piece", LOB_PUT_SIZE);
+    db2Debug2("  sending %ld bytes for column %d", param->value_len, param->colnum);
+    while (offset < param->value_len) {
+      long length = param->value_len - offset;
+      long n      = db2ReadLob (param->lob, offset, (length < LOB_PUT_SIZE) ? length : LOB_PUT_SIZE, buf, param->bindType == BIND_LONG);
+
+      if (n <= 0)
+        break;
+      rc = SQLPutData (session->stmtp->hsql, buf, n);
+      rc = db2CheckErr (rc, session->stmtp->hsql, session->stmtp->type, __LINE__, __FILE__);
+      if (rc != SQL_SUCCESS) {
+        db2Error_d (FDW_UNABLE_TO_CREATE_EXECUTION, "error executing query: SQLPutData failed to send parameter value", db2Message);
+      }
+      offset += n;
+    }
+  }
+  if (buf != NULL)
+    db2free (buf);
+  db2Debug1("< db2PutData - returns: %d", rc);
+  return rc;
+}
@@ -13,22 +13,45 @@
 #include "DB2FdwState.h"
 
 /** external prototypes */
-extern void            db2CloseStatement         (DB2Session* session);
+extern void            db2CloseCursor            (DB2Session* session);
 extern void            db2Debug1                 (const char* message, ...);
 
 /** local prototypes */
 void db2ReScanForeignScan(ForeignScanState* node);
 
 /** db2ReScanForeignScan
- *   Close the DB2 statement if there is any.
- *   That causes the next db2IterateForeignScan call to restart the scan.
+ *   Close the cursor of the DB2 statement if there is any.
+ *   That causes the next db2IterateForeignScan call to restart the scan
+ *   by executing the still prepared statement with new parameter values.
+ *   If the complete result has been materialized locally, the scan
+ *   is restarted on the tuplestore and DB2 is not involved at all.
+ *   A parameterized scan that has fetched the full result looks up
+ *   the new parameter values there in the next db2IterateForeignScan call.
  */
 void db2ReScanForeignScan (ForeignScanState* node) {
   DB2FdwState* fdw_state = (DB2FdwState*) node->fdw_state;
  
   db2Debug1("> db2ReScanForeignScan");
-  /* close open DB2 statement if there is one */
-  db2CloseStatement(fdw_state->session);
+  if (fdw_state->rescan_store != NULL) {
+    if (fdw_state->rescan_full) {
+      /* serve the rescan from the materialized result */
+      db2Debug2("  rescan from materialized result");
+      tuplestore_rescan (fdw_state->rescan_store);
+      fdw_state->rescan_read = true;
+      fdw_state->rowcount    = 0;
+      db2Debug1("< db2ReScanForeignScan");
+      return;
+    }
+    /* the first pass was not completed, start over */
+    tuplestore_clear (fdw_state->rescan_store);
+  }
+  if (fdw_state->lookup_cxt != NULL) {
+    fdw_state->lookup_entry = NULL;
+    fdw_state->lookup_next  = NULL;
+    fdw_state->lookup_read  = false;
+  }
+  /* close open DB2 cursor if there is one */
+  db2CloseCursor(fdw_state->session);
   /* reset row count to zero */
   fdw_state->rowcount = 0;
   db2Debug1("< db2ReScanForeignScan");
@@ -0,0 +1,38 @@
+#include <sqlcli1.h>
+#include <postgres_ext.h>
+#include "db2_fdw.h"
+
+/** global variables */
+
+/** external variables */
+extern char         db2Message[ERRBUFSIZE];/* contains DB2 error messages, set by db2CheckErr()             */
+
+/** external prototypes */
+extern void      db2Debug1            (const char* message, ...);
+extern void      db2Debug2            (const char* message, ...);
+extern void      db2Error_d           (db2error sqlstate, const char* message, const char* detail, ...);
+extern SQLRETURN db2CheckErr          (SQLRETURN status, SQLHANDLE handle, SQLSMALLINT handleType, int line, char* file);
+
+/** local prototypes */
+void             db2SetPrefetch       (DB2Session* session, unsigned int prefetch);
+
+/** db2SetPrefetch
+ *   Change the number of rows DB2 prefetches for the prepared statement
+ *   of the session. It takes effect with the next execution, so it must
+ *   not be called while a cursor is open.
+ */
+void db2SetPrefetch (DB2Session* session, unsigned int prefetch) {
+  SQLULEN   prefetch_rows = prefetch;
+  SQLRETURN rc            = 0;
+
+  db2Debug1("> db2SetPrefetch");
+  if (session->stmtp != NULL && !session->stmtp->cursor_open) {
+    rc = SQLSetStmtAttr (session->stmtp->hsql, SQL_ATTR_PREFETCH_NROWS, (SQLPOINTER) prefetch_rows, 0);
+    rc = db2CheckErr (rc, session->stmtp->hsql, session->stmtp->type, __LINE__, __FILE__);
+    if (rc != SQL_SUCCESS) {
+      db2Error_d (FDW_UNABLE_TO_CREATE_EXECUTION, "error executing query: SQLSetStmtAttr failed to set number of prefetched rows in statement handle", db2Message);
+    }
+    db2Debug2("  set cursor prefetch: %d", prefetch);
+  }
+  db2Debug1("< db2SetPrefetch");
+}
@@ -5,6 +5,7 @@
  */
 #include <postgres.h>
 #include <access/reloptions.h>
+#include <catalog/pg_authid.h>
 #include <catalog/pg_foreign_data_wrapper.h>
 #include <catalog/pg_foreign_server.h>
 #include <catalog/pg_foreign_table.h>
@@ -18,6 +19,7 @@
 #include <foreign/foreign.h>
 #include <miscadmin.h>
 #include <storage/ipc.h>
+#include <utils/acl.h>
 #include <utils/builtins.h>
 #include <utils/array.h>
 #include <utils/guc.h>
@@ -70,6 +72,10 @@ DB2FdwOption valid_options[] = {
   {OPT_READONLY         , ForeignTableRelationId      , false},
   {OPT_SAMPLE           , ForeignTableRelationId      , false},
   {OPT_PREFETCH         , ForeignTableRelationId      , false},
+  {OPT_FETCH_MEMORY     , ForeignServerRelationId     , false},
+  {OPT_FETCH_MEMORY     , ForeignTableRelationId      , false},
+  {OPT_COLUMN_BUFFER    , ForeignServerRelationId     , false},
+  {OPT_COLUMN_BUFFER    , ForeignTableRelationId      , false},
   {OPT_KEY              , AttributeRelationId         , false},
 #if PG_VERSION_NUM >= 140000
   {OPT_BATCH_SIZE       , ForeignServerRelationId     , false},
@@ -78,7 +84,20 @@ DB2FdwOption valid_options[] = {
 #endif
   {OPT_NO_ENCODING_ERROR, ForeignDataWrapperRelationId, false},
   {OPT_NO_ENCODING_ERROR, ForeignTableRelationId      , false},
-  {OPT_NO_ENCODING_ERROR, AttributeRelationId         , false}
+  {OPT_NO_ENCODING_ERROR, AttributeRelationId         , false},
+  {OPT_RESCAN_CACHE     , ForeignServerRelationId     , false},
+  {OPT_RESCAN_CACHE     , ForeignTableRelationId      , false},
+  {OPT_KEY_TABLE        , ForeignServerRelationId     , false},
+  {OPT_KEY_TABLE        , ForeignTableRelationId      , false},
+  {OPT_COLLATION        , ForeignServerRelationId     , false},
+  {OPT_COLLATION        , ForeignTableRelationId      , false},
+  {OPT_COLLATION        , AttributeRelationId         , false},
+  {OPT_FUNCTION_MAP     , ForeignServerRelationId     , false},
+  {OPT_BIND_CONSTANTS   , ForeignServerRelationId     , false},
+  {OPT_BIND_CONSTANTS   , ForeignTableRelationId      , false},
+  {OPT_LOAD             , ForeignTableRelationId      , false},
+  {OPT_LOAD_SAVECOUNT   , ForeignTableRelationId      , false},
+  {OPT_LOAD_MESSAGES    , ForeignTableRelationId      , false}
 };
 
 /** Array to hold the type output functions during table modification.
@@ -100,6 +119,7 @@ extern void             db2GetForeignRelSize       (PlannerInfo* root, RelOptInf
 extern ForeignScan*     db2GetForeignPlan           (PlannerInfo* root, RelOptInfo* foreignrel, Oid foreigntableid, ForeignPath* best_path, List* tlist, List* scan_clauses , Plan* outer_plan);
 extern void             db2GetForeignPaths          (PlannerInfo* root, RelOptInfo* baserel, Oid foreigntableid);
 extern void             db2GetForeignJoinPaths      (PlannerInfo* root, RelOptInfo* joinrel, RelOptInfo* outerrel, RelOptInfo* innerrel, JoinType jointype, JoinPathExtraData* extra);
+extern void             db2GetForeignUpperPaths     (PlannerInfo* root, UpperRelationKind stage, RelOptInfo* input_rel, RelOptInfo* output_rel, void* extra);
 extern bool             db2AnalyzeForeignTable      (Relation relation, AcquireSampleRowsFunc* func, BlockNumber* totalpages);
 extern void             db2ExplainForeignScan       (ForeignScanState* node, ExplainState* es);
 extern void             db2BeginForeignScan         (ForeignScanState* node, int eflags);
@@ -141,6 +161,7 @@ PGDLLEXPORT Datum db2_fdw_handler (PG_FUNCTION_ARGS) {
   fdwroutine->GetForeignRelSize         = db2GetForeignRelSize;
   fdwroutine->GetForeignPaths           = db2GetForeignPaths;
   fdwroutine->GetForeignJoinPaths       = db2GetForeignJoinPaths;
+  fdwroutine->GetForeignUpperPaths      = db2GetForeignUpperPaths;
   fdwroutine->GetForeignPlan            = db2GetForeignPlan;
   fdwroutine->AnalyzeForeignTable       = db2AnalyzeForeignTable;
   fdwroutine->ExplainForeignScan        = db2ExplainForeignScan;
@@ -213,10 +234,13 @@ PGDLLEXPORT Datum db2_fdw_validator (PG_FUNCTION_ARGS) {
                 )
               );
     }
-    /* check valid values for "readonly", "key" and "no_encoding_error" */
+    /* check valid values for "readonly", "key", "no_encoding_error", "rescan_cache", "collation_compatible" and "bind_constants" */
     if (strcmp (def->defname, OPT_READONLY         ) == 0 
     ||  strcmp (def->defname, OPT_KEY              ) == 0  
-    ||  strcmp (def->defname, OPT_NO_ENCODING_ERROR) == 0) {
+    ||  strcmp (def->defname, OPT_NO_ENCODING_ERROR) == 0
+    ||  strcmp (def->defname, OPT_RESCAN_CACHE     ) == 0
+    ||  strcmp (def->defname, OPT_COLLATION        ) == 0
+    ||  strcmp (def->defname, OPT_BIND_CONSTANTS   ) == 0) {
       char *val = STRVAL(def->arg);
       if (pg_strcasecmp (val, "on"  ) != 0 && pg_strcasecmp (val, "off"  ) != 0
       &&  pg_strcasecmp (val, "yes" ) != 0 && pg_strcasecmp (val, "no"   ) != 0
@@ -240,6 +264,22 @@ PGDLLEXPORT Datum db2_fdw_validator (PG_FUNCTION_ARGS) {
                   )
                 );
     }
+    /* check valid values for "function_map": "function=template" entries separated by semicolons */
+    if (strcmp (def->defname, OPT_FUNCTION_MAP) == 0) {
+      char *val = pstrdup (STRVAL(def->arg));
+      char *entry, *next;
+      for (entry = val; entry != NULL; entry = next) {
+        if ((next = strchr (entry, ';')) != NULL)
+          *next++ = '\0';
+        if (strspn (entry, " ") != strlen (entry) && (strchr (entry, '=') == NULL || strspn (entry, " ") == (size_t) (strchr (entry, '=') - entry)))
+          ereport ( ERROR
+                  , ( errcode(ERRCODE_FDW_INVALID_ATTRIBUTE_VALUE)
+                    , errmsg ("invalid value for option \"%s\"", def->defname)
+                    , errhint("Entries must have the form \"function=template\" and be separated by semicolons.")
+                    )
+                  );
+      }
+    }
     /* check valid values for max_long */
     if (strcmp (def->defname, OPT_MAX_LONG) == 0) {
       char *val = STRVAL(def->arg);
@@ -273,11 +313,95 @@ PGDLLEXPORT Datum db2_fdw_validator (PG_FUNCTION_ARGS) {
       char *val = STRVAL(def->arg);
       char *endptr;
       unsigned long prefetch = strtol (val, &endptr, 0);
-      if (val[0] == '\0' || *endptr != '\0' || prefetch < 0 || prefetch > 10240)
+      if (val[0] == '\0' || *endptr != '\0' || prefetch < 0 || prefetch > MAX_PREFETCH)
+        ereport ( ERROR
+                , ( errcode (ERRCODE_FDW_INVALID_ATTRIBUTE_VALUE)
+                  , errmsg ("invalid value for option \"%s\"", def->defname)
+                  , errhint ("Valid values in this context are integers between 0 and %d.", MAX_PREFETCH)
+                  )
+                );
+    }
+    /* check valid values for "fetch_memory" */
+    if (strcmp (def->defname, OPT_FETCH_MEMORY) == 0) {
+      int         fetch_memory;
+      const char* hint = NULL;
+      if (!parse_int (STRVAL(def->arg), &fetch_memory, GUC_UNIT_BYTE, &hint) || fetch_memory < 8192 || fetch_memory > 1073741824)
+        ereport ( ERROR
+                , ( errcode (ERRCODE_FDW_INVALID_ATTRIBUTE_VALUE)
+                  , errmsg ("invalid value for option \"%s\"", def->defname)
+                  , errhint ("Valid values in this context are sizes between 8kB and 1GB, like '8MB'.")
+                  )
+                );
+    }
+    /* check valid values for "column_buffer" */
+    if (strcmp (def->defname, OPT_COLUMN_BUFFER) == 0) {
+      int         column_buffer;
+      const char* hint = NULL;
+      if (!parse_int (STRVAL(def->arg), &column_buffer, GUC_UNIT_BYTE, &hint) || column_buffer < 64 || column_buffer > 1073741824)
+        ereport ( ERROR
+                , ( errcode (ERRCODE_FDW_INVALID_ATTRIBUTE_VALUE)
+                  , errmsg ("invalid value for option \"%s\"", def->defname)
+                  , errhint ("Valid values in this context are sizes between 64 bytes and 1GB, like '256'.")
+                  )
+                );
+    }
+    /* check valid values for "load" */
+    if (strcmp (def->defname, OPT_LOAD) == 0) {
+      char *val = STRVAL(def->arg);
+      if (pg_strcasecmp (val, "off") != 0 && pg_strcasecmp (val, "insert") != 0 && pg_strcasecmp (val, "replace") != 0)
+        ereport ( ERROR
+                , ( errcode (ERRCODE_FDW_INVALID_ATTRIBUTE_VALUE)
+                  , errmsg ("invalid value for option \"%s\"", def->defname)
+                  , errhint ("Valid values in this context are: off, insert or replace")
+                  )
+                );
+    }
+    /* check valid values for "load_savecount" */
+    if (strcmp (def->defname, OPT_LOAD_SAVECOUNT) == 0) {
+      char *val = STRVAL(def->arg);
+      char *endptr;
+      long savecount = strtol (val, &endptr, 0);
+      if (val[0] == '\0' || *endptr != '\0' || savecount < 0 || savecount > INT_MAX)
+        ereport ( ERROR
+                , ( errcode (ERRCODE_FDW_INVALID_ATTRIBUTE_VALUE)
+                  , errmsg ("invalid value for option \"%s\"", def->defname)
+                  , errhint ("Valid values in this context are integers greater than or equal to 0.")
+                  )
+                );
+    }
+    /* check valid values for "load_messages" */
+    if (strcmp (def->defname, OPT_LOAD_MESSAGES) == 0) {
+      /* the LOAD utility writes this file on the database server, like COPY TO a file */
+#if PG_VERSION_NUM >= 140000
+      if (!has_privs_of_role (GetUserId (), ROLE_PG_WRITE_SERVER_FILES))
+#elif PG_VERSION_NUM >= 110000
+      if (!is_member_of_role (GetUserId (), DEFAULT_ROLE_WRITE_SERVER_FILES))
+#else
+      if (!superuser ())
+#endif /* PG_VERSION_NUM */
+        ereport ( ERROR
+                , ( errcode (ERRCODE_INSUFFICIENT_PRIVILEGE)
+                  , errmsg ("only superuser or a member of the pg_write_server_files role may specify the \"%s\" option", def->defname)
+                  )
+                );
+      if (STRVAL(def->arg)[0] == '\0')
+        ereport ( ERROR
+                , ( errcode (ERRCODE_FDW_INVALID_ATTRIBUTE_VALUE)
+                  , errmsg ("invalid value for option \"%s\"", def->defname)
+                  , errhint ("The name of the message file must not be empty.")
+                  )
+                );
+    }
+    /* check valid values for "key_table_threshold" */
+    if (strcmp (def->defname, OPT_KEY_TABLE) == 0) {
+      char *val = STRVAL(def->arg);
+      char *endptr;
+      long threshold = strtol (val, &endptr, 0);
+      if (val[0] == '\0' || *endptr != '\0' || threshold < 0 || threshold > INT_MAX)
         ereport ( ERROR
                 , ( errcode (ERRCODE_FDW_INVALID_ATTRIBUTE_VALUE)
                   , errmsg ("invalid value for option \"%s\"", def->defname)
-                  , errhint ("Valid values in this context are integers between 0 and 10240.")
+                  , errhint ("Valid values in this context are integers greater than or equal to 0.")
                   )
                 );
     }
@@ -4,11 +4,13 @@
 #include <catalog/pg_proc.h>
 #include <commands/vacuum.h>
 #include <mb/pg_wchar.h>
+#include <nodes/nodeFuncs.h>
 #include <utils/builtins.h>
 #include <utils/array.h>
 #include <utils/date.h>
 #include <utils/datetime.h>
 #include <utils/guc.h>
+#include <utils/lsyscache.h>
 #include <utils/syscache.h>
 #if PG_VERSION_NUM < 120000
 #include <nodes/relation.h>
@@ -25,7 +27,9 @@
 /** external prototypes */
 extern void         db2GetLob                 (DB2Session* session, DB2Column* column, int cidx, char** value, long* value_len, unsigned long trunc);
 extern void         db2Shutdown               (void);
+extern char*        db2GetFunctionTemplate    (Oid serverid, Oid funcid);
 extern short        c2dbType                  (short fcType);
+extern short        dbType2c                  (short dbType);
 extern void         db2Debug1                 (const char* message, ...);
 extern void         db2Debug2                 (const char* message, ...);
 extern void         db2Debug3                 (const char* message, ...);
@@ -35,45 +39,101 @@ extern void         db2free                   (void* p);
 
 /** local prototypes */
 void                appendAsType              (StringInfoData* dest, Oid type);
+void                appendParamAsType         (StringInfoData* dest, int index, Oid type);
+void                appendArrayParam          (StringInfoData* dest, Expr* expr, List** params);
 char*               deparseExpr               (DB2Session* session, RelOptInfo * foreignrel, Expr* expr, const DB2Table* db2Table, List** params);
+bool                collationIsCompatible     (RelOptInfo* foreignrel, Expr* expr, Oid collid, const DB2Table* db2Table);
+bool                setResultColumn           (RelOptInfo* baserel, const DB2Table* db2Table, Expr* expr, Oid type, int maxchars, DB2Column* col);
+char*               deparseParam              (Expr* expr, Oid type, List** params);
+char*               deparseOperand            (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, const DB2Table* db2Table, List** params);
+bool                bindsConstants            (RelOptInfo* foreignrel);
+char*               deparseCast               (DB2Session* session, RelOptInfo* foreignrel, FuncExpr* func, const DB2Table* db2Table, List** params);
+char*               deparseTemplate           (DB2Session* session, RelOptInfo* foreignrel, const char* template, List* args, const DB2Table* db2Table, List** params);
 char*               datumToString             (Datum datum, Oid type);
 char*               guessNlsLang              (char* nls_lang);
 char*               deparseDate               (Datum datum);
 char*               deparseTimestamp          (Datum datum, bool hasTimezone);
 char*               deparseInterval           (Datum datum);
 void                exitHook                  (int code, Datum arg);
+void                buildAttrMap              (DB2Table* db2Table);
+void                allocColumnBuffers        (DB2Table* db2Table, int column_buffer);
+bool                hasOverflow               (DB2Column* column);
+int                 resultPosition            (const DB2Table* db2Table, int index);
+unsigned int        budgetPrefetch            (DB2FdwState* fdw_state);
+int                 db2ColumnIndex            (const DB2Table* db2Table, int attnum);
 void                convertTuple              (DB2FdwState* fdw_state, Datum* values, bool* nulls, bool trunc_lob) ;
 void                errorContextCallback      (void* arg);
 
 /** appendAsType
- *   Append "s" to "dest", adding appropriate casts for datetime "type".
+ *   Append "?" to "dest", adding appropriate casts for datetime "type".
  */
 void appendAsType (StringInfoData* dest, Oid type) {
-  db2Debug1("> %s::appendAsType", __FILE__);
+  appendParamAsType (dest, 0, type);
+}
+
+/** appendParamAsType
+ *   Append a parameter marker to "dest", adding appropriate casts for datetime "type".
+ *   If "index" is greater than zero, the marker is followed by a comment
+ *   containing ":p<index>", so that createQuery can map every marker in
+ *   the query to its parameter.
+ */
+void appendParamAsType (StringInfoData* dest, int index, Oid type) {
+  char marker[20];
+  db2Debug1("> %s::appendParamAsType", __FILE__);
   db2Debug2("  dest->data: '%s'",dest->data);
   db2Debug2("  type: %d",type);
+  if (index > 0)
+    snprintf (marker, sizeof (marker), "?/*:p%d*/", index);
+  else
+    snprintf (marker, sizeof (marker), "?");
   switch (type) {
     case DATEOID:
-      appendStringInfo (dest, "CAST (? AS DATE)");
+      appendStringInfo (dest, "CAST (%s AS DATE)", marker);
       break;
     case TIMESTAMPOID:
-      appendStringInfo (dest, "CAST (? AS TIMESTAMP)");
+      appendStringInfo (dest, "CAST (%s AS TIMESTAMP)", marker);
       break;
     case TIMESTAMPTZOID:
-      appendStringInfo (dest, "CAST (? AS TIMESTAMP)");
+      appendStringInfo (dest, "CAST (%s AS TIMESTAMP)", marker);
       break;
     case TIMEOID:
-      appendStringInfo (dest, "(CAST (? AS TIME))");
+      appendStringInfo (dest, "(CAST (%s AS TIME))", marker);
       break;
     case TIMETZOID:
-      appendStringInfo (dest, "(CAST (? AS TIME))");
+      appendStringInfo (dest, "(CAST (%s AS TIME))", marker);
       break;
     default:
-      appendStringInfo (dest, "?");
+      appendStringInfo (dest, "%s", marker);
     break;
   }
   db2Debug2("  dest->data: '%s'", dest->data);
-  db2Debug1("< %s::appendAsType", __FILE__);
+  db2Debug1("< %s::appendParamAsType", __FILE__);
+}
+
+/** appendArrayParam
+ *   Add the array "expr" to "params" and append its marker to "dest".
+ *   Array parameters are tagged :a1, :a2 etc. and stand for a list of
+ *   markers, one for each element; the list is expanded before the
+ *   statement is prepared, when the number of elements is known.
+ */
+void appendArrayParam (StringInfoData* dest, Expr* expr, List** params) {
+  ListCell* cell;
+  int       index = 0;
+
+  db2Debug1("> %s::appendArrayParam", __FILE__);
+  /* find the index in the parameter list */
+  foreach (cell, *params) {
+    ++index;
+    if (equal (expr, (Node *) lfirst (cell)))
+      break;
+  }
+  if (cell == NULL) {
+    /* add the array to the list */
+    ++index;
+    *params = lappend (*params, expr);
+  }
+  appendStringInfo (dest, "?/*:a%d*/", index);
+  db2Debug1("< %s::appendArrayParam", __FILE__);
 }
 
 /** This macro is used by deparseExpr to identify PostgreSQL
@@ -83,7 +143,7 @@ void appendAsType (StringInfoData* dest, Oid type) {
       || (x) == VARCHAROID || (x) == NAMEOID || (x) == INT8OID || (x) == INT2OID \
       || (x) == INT4OID || (x) == OIDOID || (x) == FLOAT4OID || (x) == FLOAT8OID \
       || (x) == NUMERICOID || (x) == DATEOID || (x) == TIMEOID || (x) == TIMESTAMPOID \
-      || (x) == TIMESTAMPTZOID || (x) == INTERVALOID)
+      || (x) == TIMESTAMPTZOID || (x) == INTERVALOID || (x) == UUIDOID || (x) == BYTEAOID)
 
 /** deparseExpr
  *   Create and return an DB2 SQL string from "expr".
@@ -96,16 +156,15 @@ char* deparseExpr (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, cons
   char*              left;
   char*              right;
   char*              arg;
+  char*              template;
   char               oprkind;
-  #ifndef OLD_FDW_API
-  char               parname[10];
-  #endif
   Const*             constant;
   OpExpr*            oper;
   ScalarArrayOpExpr* arrayoper;
   CaseExpr*          caseexpr;
   BoolExpr*          boolexpr;
   CoalesceExpr*      coalesceexpr;
+  MinMaxExpr*        minmaxexpr;
   CoerceViaIO*       coerce;
   Param*             param;
   Var*               variable;
@@ -128,6 +187,7 @@ char* deparseExpr (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, cons
   Datum              datum;
   bool               first_arg;
   bool               isNull;
+  bool               ordered;
   int                index;
   StringInfoData     alias;
   const DB2Table*    var_table;  /* db2Table that belongs to a Var */
@@ -137,7 +197,13 @@ char* deparseExpr (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, cons
     switch (expr->type) {
       case T_Const: {
         constant = (Const *) expr;
-        if (constant->constisnull) {
+        if (constant->consttype == BOOLOID) {
+          /* DB2 has no boolean literals, use a predicate */
+          if (constant->constisnull)
+            return NULL;
+          initStringInfo (&result);
+          appendStringInfo (&result, "(1 = %d)", DatumGetBool (constant->constvalue) ? 1 : 0);
+        } else if (constant->constisnull) {
           /* only translate NULLs of a type DB2 can handle */
           if (canHandleType (constant->consttype)) {
             initStringInfo (&result);
@@ -163,27 +229,10 @@ char* deparseExpr (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, cons
         /* don't try to push down parameters with 9.1 */
         return NULL;
         #else
-        /* don't try to handle interval parameters */
-        if (!canHandleType (param->paramtype) || param->paramtype == INTERVALOID)
+        /* interval parameters are only handled in additions and subtractions */
+        if (!(canHandleType (param->paramtype) || param->paramtype == BOOLOID) || param->paramtype == INTERVALOID)
           return NULL;
-    
-        /* find the index in the parameter list */
-        index = 0;
-        foreach (cell, *params) {
-          ++index;
-          if (equal (param, (Node *) lfirst (cell)))
-            break;
-        }
-        if (cell == NULL) {
-          /* add the parameter to the list */
-          ++index;
-          *params = lappend (*params, param);
-        }
-    
-        /* parameters will be called :p1, :p2 etc. */
-        snprintf (parname, 10, ":p%d", index);
-        initStringInfo (&result);
-        appendAsType (&result, param->paramtype);
+        return deparseParam (expr, param->paramtype, params);
         #endif /* OLD_FDW_API */
       }
       break;
@@ -222,9 +271,7 @@ char* deparseExpr (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, cons
           if (!(canHandleType (variable->vartype) || variable->vartype == BOOLOID))
             return NULL;
           /* get var_table column index corresponding to this column (-1 if none) */
-          index = var_table->ncols - 1;
-          while (index >= 0 && var_table->cols[index]->pgattnum != variable->varattno)
-            --index;
+          index = db2ColumnIndex (var_table, variable->varattno);
           /* if no DB2 column corresponds, translate as NULL */
           if (index == -1) {
             initStringInfo (&result);
@@ -238,7 +285,10 @@ char* deparseExpr (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, cons
            * in PostgreSQL because functions and operators won't work the same.
            */
           db2type = c2dbType(var_table->cols[index]->colType);
-          if ((variable->vartype == TEXTOID || variable->vartype == BPCHAROID || variable->vartype == VARCHAROID)  && db2type != DB2_VARCHAR && db2type != DB2_CHAR)
+          if ((variable->vartype == TEXTOID || variable->vartype == BPCHAROID || variable->vartype == VARCHAROID || variable->vartype == UUIDOID)  && db2type != DB2_VARCHAR && db2type != DB2_CHAR)
+            return NULL;
+          /* LOBs cannot be compared in DB2 */
+          if (variable->vartype == BYTEAOID && db2type != DB2_BINARY && db2type != DB2_VARBINARY)
             return NULL;
           initStringInfo (&result);
           /* work around the lack of booleans in DB2 */
@@ -262,26 +312,10 @@ char* deparseExpr (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, cons
           /* don't try to push down parameters with 9.1 */
           return NULL;
           #else
-          /* don't try to handle type interval */
-          if (!canHandleType (variable->vartype) || variable->vartype == INTERVALOID)
+          /* interval parameters are only handled in additions and subtractions */
+          if (!(canHandleType (variable->vartype) || variable->vartype == BOOLOID) || variable->vartype == INTERVALOID)
             return NULL;
-    
-          /* find the index in the parameter list */
-          index = 0;
-          foreach (cell, *params) {
-            ++index;
-            if (equal (variable, (Node *) lfirst (cell)))
-              break;
-          }
-          if (cell == NULL) {
-            /* add the parameter to the list */
-            ++index;
-            *params = lappend (*params, variable);
-          }
-    
-          /* parameters will be called :p1, :p2 etc. */
-          initStringInfo (&result);
-          appendStringInfo (&result, ":p%d", index);
+          return deparseParam (expr, variable->vartype, params);
           #endif /* OLD_FDW_API */
         }
       }
@@ -299,9 +333,66 @@ char* deparseExpr (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, cons
         rightargtype = ((Form_pg_operator) GETSTRUCT (tuple))->oprright;
         schema       = ((Form_pg_operator) GETSTRUCT (tuple))->oprnamespace;
         ReleaseSysCache (tuple);
+        /* operators whose function has a DB2 template */
+        if ((template = db2GetFunctionTemplate (foreignrel->serverid, get_opcode (oper->opno))) != NULL) {
+          db2free (opername);
+          return deparseTemplate (session, foreignrel, template, oper->args, db2Table, params);
+        }
         /* ignore operators in other than the pg_catalog schema */
         if (schema != PG_CATALOG_NAMESPACE)
           return NULL;
+        /* booleans are predicates in DB2, so compare their truth values */
+        if (leftargtype == BOOLOID && rightargtype == BOOLOID && (strcmp (opername, "=") == 0 || strcmp (opername, "<>") == 0)) {
+          left  = deparseExpr (session, foreignrel, linitial (oper->args), db2Table, params);
+          right = (left == NULL) ? NULL : deparseExpr (session, foreignrel, lsecond (oper->args), db2Table, params);
+          if (right == NULL) {
+            db2free (opername);
+            return NULL;
+          }
+          initStringInfo (&result);
+          if (strcmp (opername, "=") == 0)
+            appendStringInfo (&result, "((%s AND %s) OR (NOT %s AND NOT %s))", left, right, left, right);
+          else
+            appendStringInfo (&result, "((%s AND NOT %s) OR (NOT %s AND %s))", left, right, left, right);
+          db2free (right);
+          db2free (left);
+          db2free (opername);
+          break;
+        }
+        /*
+         * Adding or subtracting an interval parameter: the parameter is
+         * bound as its months, microseconds and seconds (see paramValueString),
+         * which are added as labeled durations, months first like PostgreSQL does.
+         * Unlike ADD_MONTHS, a labeled duration keeps the day of the month
+         * unless it does not exist, as in PostgreSQL.
+         * DB2 only adds time durations to timestamps, so a date is cast first.
+         */
+        if (rightargtype == INTERVALOID && oprkind == 'b' && (strcmp (opername, "+") == 0 || strcmp (opername, "-") == 0)
+        && (leftargtype == DATEOID || leftargtype == TIMESTAMPOID || leftargtype == TIMESTAMPTZOID)
+        && (IsA (lsecond (oper->args), Param) || IsA (lsecond (oper->args), Var))) {
+          #ifdef OLD_FDW_API
+          return NULL;
+          #else
+          left = deparseExpr (session, foreignrel, linitial (oper->args), db2Table, params);
+          if (left == NULL) {
+            db2free (opername);
+            return NULL;
+          }
+          right = deparseParam ((Expr*) lsecond (oper->args), INTERVALOID, params);
+          arg   = (strcmp (opername, "-") == 0) ? "-" : "+";
+          initStringInfo (&result);
+          appendStringInfo ( &result
+                           , (leftargtype == DATEOID)
+                             ? "(CAST (%s AS TIMESTAMP) %s (CAST (SUBSTR (%s, 1, 11) AS INTEGER)) MONTHS %s (CAST (SUBSTR (%s, 21) AS BIGINT)) SECONDS %s (CAST (SUBSTR (%s, 13, 7) AS INTEGER)) MICROSECONDS)"
+                             : "(%s %s (CAST (SUBSTR (%s, 1, 11) AS INTEGER)) MONTHS %s (CAST (SUBSTR (%s, 21) AS BIGINT)) SECONDS %s (CAST (SUBSTR (%s, 13, 7) AS INTEGER)) MICROSECONDS)"
+                           , left, arg, right, arg, right, arg, right
+                           );
+          db2free (right);
+          db2free (left);
+          db2free (opername);
+          break;
+          #endif /* OLD_FDW_API */
+        }
         if (!canHandleType (rightargtype))
           return NULL;
         /*
@@ -310,20 +401,30 @@ char* deparseExpr (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, cons
          */
         if (leftargtype == INTERVALOID && rightargtype == INTERVALOID)
           return NULL;
+        /* binary strings and uuids can only be compared */
+        if ((rightargtype == BYTEAOID || rightargtype == UUIDOID)
+        &&  strcmp (opername, "=")  != 0 && strcmp (opername, "<>") != 0
+        &&  strcmp (opername, "<")  != 0 && strcmp (opername, "<=") != 0
+        &&  strcmp (opername, ">")  != 0 && strcmp (opername, ">=") != 0) {
+          db2free (opername);
+          return NULL;
+        }
+        /* string comparisons are only safe if DB2 collates the strings like PostgreSQL */
+        ordered = (rightargtype != TEXTOID && rightargtype != BPCHAROID && rightargtype != NAMEOID && rightargtype != CHAROID && rightargtype != UUIDOID)
+               || (rightargtype != UUIDOID && collationIsCompatible (foreignrel, expr, oper->inputcollid, db2Table));
         /* the operators that we can translate */
         if (strcmp (opername, "=") == 0 || strcmp (opername, "<>") == 0
-        /* string comparisons are not safe */
-        || (strcmp (opername, ">")  == 0 && rightargtype != TEXTOID && rightargtype != BPCHAROID && rightargtype != NAMEOID && rightargtype != CHAROID)
-        || (strcmp (opername, "<")  == 0 && rightargtype != TEXTOID && rightargtype != BPCHAROID && rightargtype != NAMEOID && rightargtype != CHAROID)
-        || (strcmp (opername, ">=") == 0 && rightargtype != TEXTOID && rightargtype != BPCHAROID && rightargtype != NAMEOID && rightargtype != CHAROID)
-        || (strcmp (opername, "<=") == 0 && rightargtype != TEXTOID && rightargtype != BPCHAROID && rightargtype != NAMEOID && rightargtype != CHAROID)
+        || (strcmp (opername, ">")  == 0 && ordered)
+        || (strcmp (opername, "<")  == 0 && ordered)
+        || (strcmp (opername, ">=") == 0 && ordered)
+        || (strcmp (opername, "<=") == 0 && ordered)
         || strcmp (opername, "+")   == 0
         /* subtracting DATEs yields a NUMBER in DB2 */
         || (strcmp (opername, "-")    == 0 && rightargtype != DATEOID      && rightargtype != TIMESTAMPOID  && rightargtype != TIMESTAMPTZOID)
         ||  strcmp (opername, "*")    == 0 || strcmp (opername, "~~") == 0 || strcmp (opername, "!~~") == 0 || strcmp (opername, "~~*") == 0
         ||  strcmp (opername, "!~~*") == 0 || strcmp (opername, "^")  == 0 || strcmp (opername, "%")   == 0 || strcmp (opername, "&")   == 0 
         ||  strcmp (opername, "|/")   == 0 || strcmp (opername, "@")  == 0) {
-          left = deparseExpr (session, foreignrel, linitial (oper->args), db2Table, params);
+          left = deparseOperand (session, foreignrel, linitial (oper->args), db2Table, params);
           if (left == NULL) {
             db2free (opername);
             return NULL;
@@ -331,7 +432,7 @@ char* deparseExpr (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, cons
     
           if (oprkind == 'b') {
             /* binary operator */
-            right = deparseExpr (session, foreignrel, lsecond (oper->args), db2Table, params);
+            right = deparseOperand (session, foreignrel, lsecond (oper->args), db2Table, params);
             if (right == NULL) {
               db2free (left);
               db2free (opername);
@@ -408,7 +509,8 @@ char* deparseExpr (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, cons
         if ((strcmp (opername, "=") != 0 || !arrayoper->useOr) && (strcmp (opername, "<>") != 0 || arrayoper->useOr))
           return NULL;
     
-        if (!canHandleType (leftargtype))
+        /* array elements are bound as strings, which DB2 won't compare with binary strings */
+        if (!canHandleType (leftargtype) || leftargtype == BYTEAOID)
           return NULL;
     
         left = deparseExpr (session, foreignrel, linitial (arrayoper->args), db2Table, params);
@@ -423,14 +525,25 @@ char* deparseExpr (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, cons
         rightexpr = (Expr *) llast (arrayoper->args);
         switch (rightexpr->type) {
           case T_Const: {
+            ArrayType* arr;
+            Oid        elemtype;
+
             /* the second (=last) argument is a Const of ArrayType */
             constant = (Const *) rightexpr;
+            arr      = constant->constisnull ? NULL : DatumGetArrayTypeP (constant->constvalue);
+            elemtype = get_element_type (constant->consttype);
             /* using NULL in place of an array or value list is valid in DB2 and PostgreSQL */
             if (constant->constisnull) {
               appendStringInfo (&result, "NULL");
+            } else if (arrayoper->useOr
+                   &&  (ArrayGetNItems (ARR_NDIM (arr), ARR_DIMS (arr)) > MAX_INLINE_IN || bindsConstants (foreignrel))
+                   &&  canHandleType (elemtype)
+                   &&  elemtype != INTERVALOID) {
+              /* bind long IN lists (or all of them) instead of rendering every element into the query */
+              appendArrayParam (&result, rightexpr, params);
             } else {
               /* loop through the array elements */
-              iterator = array_create_iterator (DatumGetArrayTypeP (constant->constvalue), 0);
+              iterator = array_create_iterator (arr, 0);
               first_arg = true;
               while (array_iterate (iterator, &datum, &isNull)) {
                 char *c;
@@ -454,6 +567,20 @@ char* deparseExpr (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, cons
             }
           }
           break;
+          case T_Param: {
+            /* a runtime array can only be bound as a list for IN */
+            #ifdef OLD_FDW_API
+            return NULL;
+            #else
+            param = (Param *) rightexpr;
+            if (!arrayoper->useOr
+            ||  !canHandleType (get_element_type (param->paramtype))
+            ||  get_element_type (param->paramtype) == INTERVALOID)
+              return NULL;
+            appendArrayParam (&result, rightexpr, params);
+            #endif /* OLD_FDW_API */
+          }
+          break;
           case T_ArrayCoerceExpr: {
             /* the second (=last) argument is an ArrayCoerceExpr */
             arraycoerce = (ArrayCoerceExpr *) rightexpr;
@@ -673,6 +800,83 @@ char* deparseExpr (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, cons
         appendStringInfo (&result, ")");
       }
       break;
+      case T_MinMaxExpr: {
+        List*     args = NIL;
+        ListCell* other;
+
+        minmaxexpr = (MinMaxExpr *) expr;
+
+        if (!canHandleType (minmaxexpr->minmaxtype))
+          return NULL;
+
+        /* strings must compare the same way in DB2 */
+        if ((minmaxexpr->minmaxtype == TEXTOID || minmaxexpr->minmaxtype == VARCHAROID || minmaxexpr->minmaxtype == BPCHAROID)
+        && !collationIsCompatible (foreignrel, expr, minmaxexpr->minmaxcollid, db2Table))
+          return NULL;
+
+        foreach (cell, minmaxexpr->args) {
+          arg = deparseExpr (session, foreignrel, (Expr *) lfirst (cell), db2Table, params);
+          if (arg == NULL)
+            return NULL;
+          args = lappend (args, arg);
+        }
+
+        /*
+         * PostgreSQL ignores NULL arguments, but DB2 returns NULL if any argument is NULL.
+         * So each argument is replaced by the first non-NULL value of all arguments,
+         * that is COALESCE(arg1, arg2, ...) for the first, COALESCE(arg2, arg1, ...)
+         * for the second and so on. The result is NULL only if all arguments are.
+         */
+        initStringInfo (&result);
+        if (list_length (args) == 1) {
+          appendStringInfo (&result, "%s", (char*) linitial (args));
+        } else {
+          appendStringInfo (&result, "%s(", (minmaxexpr->op == IS_GREATEST) ? "GREATEST" : "LEAST");
+          first_arg = true;
+          foreach (cell, args) {
+            appendStringInfo (&result, "%sCOALESCE(%s", first_arg ? "" : ", ", (char*) lfirst (cell));
+            foreach (other, args) {
+              if (other != cell)
+                appendStringInfo (&result, ", %s", (char*) lfirst (other));
+            }
+            appendStringInfo (&result, ")");
+            first_arg = false;
+          }
+          appendStringInfo (&result, ")");
+        }
+        list_free_deep (args);
+      }
+      break;
+      case T_BooleanTest: {
+        /* the argument is a predicate in DB2, map its truth value to a number */
+        arg = deparseExpr (session, foreignrel, ((BooleanTest *) expr)->arg, db2Table, params);
+        if (arg == NULL)
+          return NULL;
+
+        initStringInfo (&result);
+        switch (((BooleanTest *) expr)->booltesttype) {
+          case IS_TRUE:
+            appendStringInfo (&result, "(CASE WHEN %s THEN 1 ELSE 0 END = 1)", arg);
+          break;
+          case IS_NOT_TRUE:
+            appendStringInfo (&result, "(CASE WHEN %s THEN 1 ELSE 0 END = 0)", arg);
+          break;
+          case IS_FALSE:
+            appendStringInfo (&result, "(CASE WHEN NOT %s THEN 1 ELSE 0 END = 1)", arg);
+          break;
+          case IS_NOT_FALSE:
+            appendStringInfo (&result, "(CASE WHEN NOT %s THEN 1 ELSE 0 END = 0)", arg);
+          break;
+          case IS_UNKNOWN:
+            appendStringInfo (&result, "(CASE WHEN %s THEN 0 WHEN NOT %s THEN 0 ELSE 1 END = 1)", arg, arg);
+          break;
+          case IS_NOT_UNKNOWN:
+            appendStringInfo (&result, "(CASE WHEN %s THEN 0 WHEN NOT %s THEN 0 ELSE 1 END = 0)", arg, arg);
+          break;
+        }
+        db2free (arg);
+      }
+      break;
       case T_NullTest: {
         arg = deparseExpr (session, foreignrel, ((NullTest *) expr)->arg, db2Table, params);
         if (arg == NULL)
@@ -685,12 +889,17 @@ char* deparseExpr (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, cons
       case T_FuncExpr: {
         func = (FuncExpr *) expr;
     
-        if (!canHandleType (func->funcresulttype))
+        /* boolean functions are predicates in DB2 */
+        if (!canHandleType (func->funcresulttype) && func->funcresulttype != BOOLOID)
           return NULL;
     
         /* do nothing for implicit casts */
         if (func->funcformat == COERCE_IMPLICIT_CAST)
           return deparseExpr (session, foreignrel, linitial (func->args), db2Table, params);
+
+        /* explicit casts that DB2 performs the same way */
+        if (func->funcformat == COERCE_EXPLICIT_CAST)
+          return deparseCast (session, foreignrel, func, db2Table, params);
     
         /* get function name and schema */
         tuple = SearchSysCache1 (PROCOID, ObjectIdGetDatum (func->funcid));
@@ -700,61 +909,30 @@ char* deparseExpr (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, cons
         opername = db2strdup (((Form_pg_proc) GETSTRUCT (tuple))->proname.data);
         schema = ((Form_pg_proc) GETSTRUCT (tuple))->pronamespace;
         ReleaseSysCache (tuple);
-    
-        /* ignore functions in other than the pg_catalog schema */
-        if (schema != PG_CATALOG_NAMESPACE)
-          return NULL;
-    
-        /* the "normal" functions that we can translate */
-        if (strcmp (opername, "abs")         == 0 || strcmp (opername, "acos")         == 0 || strcmp (opername, "asin")             == 0
-        || strcmp (opername, "atan")         == 0 || strcmp (opername, "atan2")        == 0 || strcmp (opername, "ceil")             == 0
-        || strcmp (opername, "ceiling")      == 0 || strcmp (opername, "char_length")  == 0 || strcmp (opername, "character_length") == 0
-        || strcmp (opername, "concat")       == 0 || strcmp (opername, "cos")          == 0 || strcmp (opername, "exp")              == 0
-        || strcmp (opername, "initcap")      == 0 || strcmp (opername, "length")       == 0 || strcmp (opername, "lower")            == 0
-        || strcmp (opername, "lpad")         == 0 || strcmp (opername, "ltrim")        == 0 || strcmp (opername, "mod")              == 0
-        || strcmp (opername, "octet_length") == 0 || strcmp (opername, "position")     == 0 || strcmp (opername, "pow")              == 0
-        || strcmp (opername, "power")        == 0 || strcmp (opername, "replace")      == 0 || strcmp (opername, "round")            == 0
-        || strcmp (opername, "rpad")         == 0 || strcmp (opername, "rtrim")        == 0 || strcmp (opername, "sign")             == 0
-        || strcmp (opername, "sin")          == 0 || strcmp (opername, "sqrt")         == 0 || strcmp (opername, "strpos")           == 0
-        || strcmp (opername, "substr")       == 0 || strcmp (opername, "tan")          == 0 || strcmp (opername, "to_char")          == 0
-        || strcmp (opername, "to_date")      == 0 || strcmp (opername, "to_number")    == 0 || strcmp (opername, "to_timestamp")     == 0
-        || strcmp (opername, "translate")    == 0 || strcmp (opername, "trunc")        == 0 || strcmp (opername, "upper")            == 0
-        ||(strcmp (opername, "substring")    == 0 && list_length (func->args) == 3)) {
-          initStringInfo (&result);
-    
-          if (strcmp (opername, "ceiling") == 0)
-            appendStringInfo (&result, "CEIL(");
-          else if (strcmp (opername, "char_length") == 0 || strcmp (opername, "character_length") == 0)
-            appendStringInfo (&result, "LENGTH(");
-          else if (strcmp (opername, "pow") == 0)
-            appendStringInfo (&result, "POWER(");
-          else if (strcmp (opername, "octet_length") == 0)
-            appendStringInfo (&result, "LENGTHB(");
-          else if (strcmp (opername, "position") == 0 || strcmp (opername, "strpos") == 0)
-            appendStringInfo (&result, "INSTR(");
-          else if (strcmp (opername, "substring") == 0)
-            appendStringInfo (&result, "SUBSTR(");
-          else
-            appendStringInfo (&result, "%s(", opername);
-    
-          first_arg = true;
-          foreach (cell, func->args) {
-            arg = deparseExpr (session, foreignrel, lfirst (cell), db2Table, params);
-            if (arg == NULL) {
-              db2free (result.data);
-              db2free (opername);
-              return NULL;
-            }
-            if (first_arg) {
-              first_arg = false;
-              appendStringInfo (&result, "%s", arg);
-            } else {
-              appendStringInfo (&result, ", %s", arg);
-            }
-            db2free(arg);
+
+        /* a negative length makes left and right count from the other end, DB2 rejects it */
+        if (schema == PG_CATALOG_NAMESPACE && (strcmp (opername, "left") == 0 || strcmp (opername, "right") == 0)) {
+          Const* length = (Const*) lsecond (func->args);
+
+          if (!IsA (length, Const) || length->constisnull || DatumGetInt32 (length->constvalue) < 0) {
+            db2free (opername);
+            return NULL;
           }
-          appendStringInfo (&result, ")");
-        } else if (strcmp (opername, "date_part") == 0) {
+        }
+
+        /* functions with a DB2 template, built-in or from the server's "function_map" */
+        if ((template = db2GetFunctionTemplate (foreignrel->serverid, func->funcid)) != NULL) {
+          db2free (opername);
+          return deparseTemplate (session, foreignrel, template, func->args, db2Table, params);
+        }
+
+        /* ignore other functions in other than the pg_catalog schema */
+        if (schema != PG_CATALOG_NAMESPACE) {
+          db2free (opername);
+          return NULL;
+        }
+
+        if (strcmp (opername, "date_part") == 0 || strcmp (opername, "extract") == 0) {
           /* special case: EXTRACT */
           left = deparseExpr (session, foreignrel, linitial (func->args), db2Table, params);
           if (left == NULL) {
@@ -778,6 +956,26 @@ char* deparseExpr (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, cons
     
             initStringInfo (&result);
             appendStringInfo (&result, "EXTRACT(%s FROM %s)", left + 1, right);
+          } else if (strcmp (left, "'dow'")    == 0 || strcmp (left, "'isodow'")  == 0 || strcmp (left, "'doy'") == 0
+          ||         strcmp (left, "'week'")   == 0 || strcmp (left, "'quarter'") == 0) {
+            /* fields that DB2 has functions for */
+            right = deparseExpr (session, foreignrel, lsecond (func->args), db2Table, params);
+            if (right == NULL) {
+              db2free (opername);
+              db2free (left);
+              return NULL;
+            }
+            initStringInfo (&result);
+            if (strcmp (left, "'dow'") == 0)
+              appendStringInfo (&result, "(DAYOFWEEK(%s) - 1)", right);
+            else if (strcmp (left, "'isodow'") == 0)
+              appendStringInfo (&result, "DAYOFWEEK_ISO(%s)", right);
+            else if (strcmp (left, "'doy'") == 0)
+              appendStringInfo (&result, "DAYOFYEAR(%s)", right);
+            else if (strcmp (left, "'week'") == 0)
+              appendStringInfo (&result, "WEEK_ISO(%s)", right);
+            else
+              appendStringInfo (&result, "QUARTER(%s)", right);
           } else {
             db2free (opername);
             db2free (left);
@@ -800,7 +998,7 @@ char* deparseExpr (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, cons
       break;
       case T_CoerceViaIO: {
         /*
-         * We will only handle casts of 'now'.
+         * We will only handle casts of 'now' and of strings to date and time types.
          */
         coerce = (CoerceViaIO *) expr;
     
@@ -808,6 +1006,22 @@ char* deparseExpr (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, cons
         if (coerce->resulttype != DATEOID && coerce->resulttype != TIMESTAMPOID && coerce->resulttype != TIMESTAMPTZOID)
           return NULL;
     
+        /*
+         * Strings other than constants are converted by DB2.
+         * Constants are never cast in DB2, since DB2 does not know the
+         * special values like 'today'.
+         */
+        leftargtype = exprType ((Node*) coerce->arg);
+        if (coerce->arg->type != T_Const && (leftargtype == TEXTOID || leftargtype == VARCHAROID || leftargtype == BPCHAROID)) {
+          arg = deparseExpr (session, foreignrel, coerce->arg, db2Table, params);
+          if (arg == NULL)
+            return NULL;
+          initStringInfo (&result);
+          appendStringInfo (&result, "CAST (%s AS %s)", arg, (coerce->resulttype == DATEOID) ? "DATE" : "TIMESTAMP");
+          db2free (arg);
+          break;
+        }
+
         /* the argument must be a Const */
         if (coerce->arg->type != T_Const)
           return NULL;
@@ -888,24 +1102,407 @@ char* deparseExpr (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, cons
   return result.data;
 }
 
+/** deparseParam
+ *   Add the parameter "expr" of type "type" to "params" (unless it is
+ *   already there) and return its marker, tagged :p1, :p2 etc.
+ *   Booleans are bound as 1 or 0 and compared to make a predicate,
+ *   binary strings are bound in hexadecimal, and intervals as a string
+ *   with months and seconds (see paramValueString).
+ */
+char* deparseParam (Expr* expr, Oid type, List** params) {
+  StringInfoData result;
+  ListCell*      cell;
+  int            index = 0;
+
+  /* find the index in the parameter list */
+  foreach (cell, *params) {
+    ++index;
+    if (equal (expr, (Node *) lfirst (cell)))
+      break;
+  }
+  if (cell == NULL) {
+    /* add the parameter to the list */
+    ++index;
+    *params = lappend (*params, expr);
+  }
+
+  initStringInfo (&result);
+  switch (type) {
+    case BOOLOID:
+      appendStringInfo (&result, "(CAST (?/*:p%d*/ AS SMALLINT) <> 0)", index);
+    break;
+    case BYTEAOID:
+      appendStringInfo (&result, "HEXTORAW(?/*:p%d*/)", index);
+    break;
+    case INTERVALOID:
+      appendStringInfo (&result, "CAST (?/*:p%d*/ AS VARCHAR(40))", index);
+    break;
+    default:
+      appendParamAsType (&result, index, type);
+    break;
+  }
+  return result.data;
+}
+
+/** bindsConstants
+ *   True if constants in conditions on "foreignrel" are to be bound as
+ *   parameters (option "bind_constants").
+ */
+bool bindsConstants (RelOptInfo* foreignrel) {
+  return foreignrel->fdw_private != NULL && ((DB2FdwState*) foreignrel->fdw_private)->bind_constants;
+}
+
+/** deparseOperand
+ *   Render an operand of an operator like deparseExpr, but if constants
+ *   are bound (see bindsConstants), a constant becomes a parameter marker
+ *   cast to the DB2 type. The statement text then stays the same for all
+ *   values, so DB2 can take it from its package cache instead of compiling
+ *   it again. Constants that DB2 cannot take as a parameter are written
+ *   into the query as usual.
+ */
+char* deparseOperand (DB2Session* session, RelOptInfo* foreignrel, Expr* expr, const DB2Table* db2Table, List** params) {
+  Const*         constant = (Const*) expr;
+  const char*    db2type  = NULL;
+  char*          marker;
+  StringInfoData result;
+
+  if (!IsA (expr, Const) || constant->constisnull || !bindsConstants (foreignrel))
+    return deparseExpr (session, foreignrel, expr, db2Table, params);
+  switch (constant->consttype) {
+    case INT2OID:
+      db2type = "SMALLINT";
+    break;
+    case INT4OID:
+      db2type = "INTEGER";
+    break;
+    case INT8OID:
+    case OIDOID:
+      db2type = "BIGINT";
+    break;
+    case FLOAT4OID:
+      db2type = "REAL";
+    break;
+    case FLOAT8OID:
+      db2type = "DOUBLE";
+    break;
+    case NUMERICOID:
+      db2type = "DECFLOAT(34)";
+    break;
+    case TEXTOID:
+    case VARCHAROID:
+    case BPCHAROID: {
+      /* string parameters are bound with up to 4000 bytes, empty strings are not pushed down */
+      int len = VARSIZE_ANY_EXHDR (DatumGetTextPP (constant->constvalue));
+
+      if (len == 0 || len > 4000)
+        return deparseExpr (session, foreignrel, expr, db2Table, params);
+      db2type = "VARCHAR(4000)";
+    }
+    break;
+    case DATEOID:
+    case TIMESTAMPOID:
+    case TIMESTAMPTZOID:
+    case TIMEOID:
+    case TIMETZOID:
+      /* these markers are cast already */
+      return deparseParam (expr, constant->consttype, params);
+    default:
+      return deparseExpr (session, foreignrel, expr, db2Table, params);
+  }
+  marker = deparseParam (expr, constant->consttype, params);
+  initStringInfo (&result);
+  appendStringInfo (&result, "CAST (%s AS %s)", marker, db2type);
+  db2free (marker);
+  return result.data;
+}
+
+/** deparseCast
+ *   Render the explicit cast "func" if DB2 converts the value the same way
+ *   as PostgreSQL: between numeric types (rounding like PostgreSQL where it
+ *   rounds), length coercions of strings, and between date and timestamp.
+ *   Returns NULL for all other casts.
+ */
+char* deparseCast (DB2Session* session, RelOptInfo* foreignrel, FuncExpr* func, const DB2Table* db2Table, List** params) {
+  StringInfoData result;
+  char*          arg;
+  const char*    db2type = NULL;
+  Oid            argtype = exprType ((Node*) linitial (func->args));
+  int32          typmod  = -1;
+  bool           fromint = (argtype == INT2OID || argtype == INT4OID || argtype == INT8OID);
+  bool           fromnum = (fromint || argtype == NUMERICOID || argtype == FLOAT4OID || argtype == FLOAT8OID);
+  bool           fromstr = (argtype == TEXTOID || argtype == VARCHAROID || argtype == BPCHAROID);
+
+  db2Debug1("> deparseCast");
+  /* length coercions have the type modifier as second argument */
+  if (list_length (func->args) >= 2 && IsA (lsecond (func->args), Const) && !((Const*) lsecond (func->args))->constisnull)
+    typmod = DatumGetInt32 (((Const*) lsecond (func->args))->constvalue);
+
+  arg = deparseExpr (session, foreignrel, linitial (func->args), db2Table, params);
+  if (arg == NULL) {
+    db2Debug1("< deparseCast - returns: NULL");
+    return NULL;
+  }
+  initStringInfo (&result);
+  switch (func->funcresulttype) {
+    case INT2OID:
+    case INT4OID:
+    case INT8OID:
+      db2type = (func->funcresulttype == INT2OID) ? "SMALLINT" : (func->funcresulttype == INT4OID) ? "INTEGER" : "BIGINT";
+      /* DB2 truncates, PostgreSQL rounds numerics half away from zero like ROUND */
+      if (fromint)
+        appendStringInfo (&result, "CAST (%s AS %s)", arg, db2type);
+      else if (argtype == NUMERICOID)
+        appendStringInfo (&result, "CAST (ROUND(%s, 0) AS %s)", arg, db2type);
+      /* floats are rounded half to even in PostgreSQL, leave them alone */
+    break;
+    case FLOAT4OID:
+    case FLOAT8OID:
+      if (fromnum)
+        appendStringInfo (&result, "CAST (%s AS %s)", arg, (func->funcresulttype == FLOAT4OID) ? "REAL" : "DOUBLE");
+    break;
+    case NUMERICOID:
+      /* PostgreSQL converts floats with their shortest decimal representation, DB2 keeps more digits */
+      if (typmod >= (int32) VARHDRSZ && (fromint || argtype == NUMERICOID)) {
+        int precision = ((typmod - VARHDRSZ) >> 16) & 0xffff;
+        int scale     = (typmod - VARHDRSZ) & 0xffff;
+
+        /* DB2 allows up to 31 digits */
+        if (precision <= 31)
+          appendStringInfo (&result, "CAST (ROUND(%s, %d) AS DECIMAL(%d,%d))", arg, scale, precision, scale);
+      } else if (typmod < 0 && (fromint || argtype == NUMERICOID)) {
+        /* DECFLOAT keeps integer division from truncating */
+        appendStringInfo (&result, "CAST (%s AS DECFLOAT(34))", arg);
+      }
+    break;
+    case VARCHAROID:
+    case BPCHAROID:
+    case TEXTOID:
+      if (!fromstr)
+        break;
+      /* trailing blanks of char(n) are not significant */
+      if (argtype == BPCHAROID && func->funcresulttype != BPCHAROID) {
+        char* trimmed = (char*) palloc (strlen (arg) + 8);
+
+        sprintf (trimmed, "RTRIM(%s)", arg);
+        db2free (arg);
+        arg = trimmed;
+      }
+      /* PostgreSQL counts characters, not bytes */
+      if (typmod >= (int32) VARHDRSZ && func->funcresulttype != TEXTOID)
+        appendStringInfo (&result, "CAST (%s AS %s(%d CODEUNITS32))", arg, (func->funcresulttype == VARCHAROID) ? "VARCHAR" : "CHAR", typmod - VARHDRSZ);
+      else if (typmod < 0 && func->funcresulttype != BPCHAROID)
+        appendStringInfoString (&result, arg);
+    break;
+    case DATEOID:
+      if (argtype == TIMESTAMPOID || argtype == TIMESTAMPTZOID)
+        appendStringInfo (&result, "CAST (%s AS DATE)", arg);
+    break;
+    case TIMESTAMPOID:
+    case TIMESTAMPTZOID:
+      if (argtype == DATEOID)
+        appendStringInfo (&result, "CAST (%s AS TIMESTAMP)", arg);
+      else if ((argtype == TIMESTAMPOID || argtype == TIMESTAMPTZOID) && typmod < 0)
+        appendStringInfoString (&result, arg);
+    break;
+    default:
+    break;
+  }
+  db2free (arg);
+  if (result.len == 0) {
+    db2free (result.data);
+    db2Debug1("< deparseCast - returns: NULL");
+    return NULL;
+  }
+  db2Debug1("< deparseCast - returns: '%s'", result.data);
+  return result.data;
+}
+
+/** deparseTemplate
+ *   Render a function call by its DB2 template (see db2GetFunctionTemplate).
+ *   A template without parentheses is the name of a DB2 function that takes
+ *   the arguments in the same order, otherwise $1, $2 ... in the template
+ *   are replaced by the arguments.
+ *   Returns NULL if an argument cannot be rendered or the template does
+ *   not use every argument, since dropping one could change the result.
+ */
+char* deparseTemplate (DB2Session* session, RelOptInfo* foreignrel, const char* template, List* args, const DB2Table* db2Table, List** params) {
+  StringInfoData result;
+  char**         deparsed;
+  bool*          used;
+  ListCell*      cell;
+  const char*    p;
+  int            nargs = list_length (args);
+  int            i     = 0;
+
+  db2Debug1("> deparseTemplate");
+  deparsed = (char**) palloc (sizeof (char*) * (nargs + 1));
+  used     = (bool*) palloc0 (sizeof (bool) * (nargs + 1));
+  foreach (cell, args) {
+    if ((deparsed[i++] = deparseExpr (session, foreignrel, (Expr*) lfirst (cell), db2Table, params)) == NULL) {
+      db2Debug1("< deparseTemplate - returns: NULL");
+      return NULL;
+    }
+  }
+  initStringInfo (&result);
+  if (strchr (template, '(') == NULL) {
+    appendStringInfo (&result, "%s(", template);
+    for (i = 0; i < nargs; ++i)
+      appendStringInfo (&result, "%s%s", (i > 0) ? ", " : "", deparsed[i]);
+    appendStringInfoChar (&result, ')');
+  } else {
+    for (p = template; *p != '\0'; ++p) {
+      if (*p == '$' && isdigit ((unsigned char) p[1])) {
+        int n = (int) strtol (p + 1, (char**) &p, 10);
+
+        if (n < 1 || n > nargs) {
+          db2Debug1("< deparseTemplate - returns: NULL");
+          return NULL;
+        }
+        appendStringInfoString (&result, deparsed[n - 1]);
+        used[n - 1] = true;
+        --p;
+      } else {
+        appendStringInfoChar (&result, *p);
+      }
+    }
+    for (i = 0; i < nargs; ++i) {
+      if (!used[i]) {
+        db2Debug1("< deparseTemplate - returns: NULL");
+        return NULL;
+      }
+    }
+  }
+  db2Debug1("< deparseTemplate - returns: '%s'", result.data);
+  return result.data;
+}
+
+/** collationIsCompatible
+ *   Return true if DB2 compares and sorts the strings in "expr" like
+ *   PostgreSQL does with collation "collid".
+ *   That is the case if the expression contains at least one column of our
+ *   foreign tables, all these columns have the "collation_compatible" option
+ *   set, and "collid" is their own collation, not one chosen by a COLLATE clause.
+ *   Other Vars in the expression are parameters and compared by the columns' rules.
+ */
+bool collationIsCompatible (RelOptInfo* foreignrel, Expr* expr, Oid collid, const DB2Table* db2Table) {
+  List*     vars    = pull_var_clause ((Node*) expr, PVC_RECURSE_PLACEHOLDERS);
+  ListCell* cell;
+  int       columns = 0;
+
+  db2Debug1("> collationIsCompatible");
+  foreach (cell, vars) {
+    Var*            variable  = (Var*) lfirst (cell);
+    const DB2Table* var_table = NULL;
+    int             index;
+
+    if (!IsA (variable, Var))
+      continue;
+    if (IS_SIMPLE_REL (foreignrel)) {
+      if (variable->varno == foreignrel->relid && variable->varlevelsup == 0)
+        var_table = db2Table;
+    } else {
+      DB2FdwState* joinstate  = (DB2FdwState*) foreignrel->fdw_private;
+      DB2FdwState* outerstate = (DB2FdwState*) joinstate->outerrel->fdw_private;
+      DB2FdwState* innerstate = (DB2FdwState*) joinstate->innerrel->fdw_private;
+
+      if (variable->varno == outerstate->db2Table->cols[0]->varno && variable->varlevelsup == 0)
+        var_table = outerstate->db2Table;
+      if (variable->varno == innerstate->db2Table->cols[0]->varno && variable->varlevelsup == 0)
+        var_table = innerstate->db2Table;
+    }
+    if (var_table == NULL)
+      continue;
+    index = db2ColumnIndex (var_table, variable->varattno);
+    if (index == -1 || !var_table->cols[index]->colCollate || variable->varcollid != collid) {
+      db2Debug1("< collationIsCompatible - returns: false");
+      return false;
+    }
+    ++columns;
+  }
+  db2Debug1("< collationIsCompatible - returns: %s", (columns > 0) ? "true" : "false");
+  return columns > 0;
+}
+
+/** setResultColumn
+ *   Describe in "col" the DB2 result column for an expression that DB2
+ *   computes in the SELECT list.
+ *   If "expr" is a column of "baserel" of type "type", the result column is
+ *   like it, otherwise it has the DB2 type that is returned for PostgreSQL
+ *   type "type". Strings need the maximal number of characters "maxchars"
+ *   of the result for the buffer size.
+ *   Returns false for types that are not supported.
+ */
+bool setResultColumn (RelOptInfo* baserel, const DB2Table* db2Table, Expr* expr, Oid type, int maxchars, DB2Column* col) {
+  short db2type;
+  int   i;
+
+  if (expr != NULL && IsA (expr, Var) && ((Var*) expr)->varno == baserel->relid && ((Var*) expr)->vartype == type) {
+    if ((i = db2ColumnIndex (db2Table, ((Var*) expr)->varattno)) >= 0) {
+      memcpy (col, db2Table->cols[i], sizeof (DB2Column));
+      return true;
+    }
+  }
+  switch (type) {
+    case INT2OID:
+    case INT4OID:
+    case INT8OID:
+      db2type = DB2_BIGINT;
+    break;
+    case NUMERICOID:
+      db2type = DB2_DECFLOAT;
+    break;
+    case FLOAT4OID:
+    case FLOAT8OID:
+      db2type = DB2_DOUBLE;
+    break;
+    case DATEOID:
+      db2type = DB2_TYPE_DATE;
+    break;
+    case TIMESTAMPOID:
+      db2type = DB2_TYPE_TIMESTAMP;
+    break;
+    case TEXTOID:
+    case VARCHAROID:
+    case BPCHAROID:
+      if (maxchars <= 0)
+        return false;
+      db2type = DB2_VARCHAR;
+    break;
+    default:
+      return false;
+  }
+  col->colType     = dbType2c (db2type);
+  col->colScale    = 0;
+  col->colCodepage = 0;
+  col->noencerr    = NO_ENC_ERR_NULL;
+  if (db2type == DB2_VARCHAR) {
+    /* a character takes up to 4 bytes in UTF-8 */
+    col->colSize  = maxchars;
+    col->colChars = maxchars;
+    col->colBytes = maxchars * 4;
+    col->val_size = col->colBytes + 1;
+  } else {
+    col->colSize  = 34;
+    col->colChars = 0;
+    col->colBytes = 0;
+    /* DECFLOAT(34) in scientific notation is the longest value */
+    col->val_size = 64;
+  }
+  return true;
+}
+
 /** datumToString
  *   Convert a Datum to a string by calling the type output function.
  *   Returns the result or NULL if it cannot be converted to DB2 SQL.
  */
 char* datumToString (Datum datum, Oid type) {
   StringInfoData result;
-  regproc        typoutput;
-  HeapTuple      tuple;
+  Oid            typoutput;
+  bool           typIsVarlena;
   char*          str;
   char*          p;
+  char*          q;
   db2Debug1("> %s::datumToString", __FILE__);
-  /* get the type's output function */
-  tuple = SearchSysCache1 (TYPEOID, ObjectIdGetDatum (type));
-  if (!HeapTupleIsValid (tuple)) {
-    elog (ERROR, "cache lookup failed for type %u", type);
-  }
-  typoutput = ((Form_pg_type) GETSTRUCT (tuple))->typoutput;
-  ReleaseSysCache (tuple);
 
   /* render the constant in DB2 SQL */
   switch (type) {
@@ -914,7 +1511,8 @@ char* datumToString (Datum datum, Oid type) {
     case BPCHAROID:
     case VARCHAROID:
     case NAMEOID:
-      str = DatumGetCString (OidFunctionCall1 (typoutput, datum));
+      getTypeOutputInfo (type, &typoutput, &typIsVarlena);
+      str = OidOutputFunctionCall (typoutput, datum);
       /*
        * Don't try to convert empty strings to DB2.
        * DB2 treats empty strings as NULL.
@@ -922,15 +1520,16 @@ char* datumToString (Datum datum, Oid type) {
       if (str[0] == '\0')
         return NULL;
 
-      /* quote string */
+      /* quote string, copying the runs between single quotes in one go */
       initStringInfo (&result);
-      appendStringInfo (&result, "'");
-      for (p = str; *p; ++p) {
-        if (*p == '\'')
-          appendStringInfo (&result, "'");
-        appendStringInfo (&result, "%c", *p);
+      enlargeStringInfo (&result, strlen (str) + 2);
+      appendStringInfoChar (&result, '\'');
+      for (p = str; (q = strchr (p, '\'')) != NULL; p = q + 1) {
+        appendBinaryStringInfo (&result, p, q - p + 1);
+        appendStringInfoChar (&result, '\'');
       }
-      appendStringInfo (&result, "'");
+      appendStringInfoString (&result, p);
+      appendStringInfoChar (&result, '\'');
     break;
     case INT8OID:
     case INT2OID:
@@ -939,9 +1538,10 @@ char* datumToString (Datum datum, Oid type) {
     case FLOAT4OID:
     case FLOAT8OID:
     case NUMERICOID:
-      str = DatumGetCString (OidFunctionCall1 (typoutput, datum));
+      getTypeOutputInfo (type, &typoutput, &typIsVarlena);
+      str = OidOutputFunctionCall (typoutput, datum);
       initStringInfo (&result);
-      appendStringInfo (&result, "%s", str);
+      appendStringInfoString (&result, str);
     break;
     case DATEOID:
       str = deparseDate (datum);
@@ -975,6 +1575,26 @@ char* datumToString (Datum datum, Oid type) {
       initStringInfo (&result);
       appendStringInfo (&result, "%s", str);
     break;
+    case UUIDOID:
+      /* uuids are stored as strings in DB2 */
+      getTypeOutputInfo (type, &typoutput, &typIsVarlena);
+      str = OidOutputFunctionCall (typoutput, datum);
+      initStringInfo (&result);
+      appendStringInfo (&result, "'%s'", str);
+    break;
+    case BYTEAOID: {
+      bytea* value = DatumGetByteaPP (datum);
+      int    len   = VARSIZE_ANY_EXHDR (value);
+
+      /* a binary string constant */
+      initStringInfo (&result);
+      enlargeStringInfo (&result, 2 * len + 4);
+      appendStringInfoString (&result, "BX'");
+      for (p = VARDATA_ANY (value); p < VARDATA_ANY (value) + len; ++p)
+        appendStringInfo (&result, "%02X", (unsigned char) *p);
+      appendStringInfoChar (&result, '\'');
+    }
+    break;
     default:
       return NULL;
   }
@@ -1238,17 +1858,156 @@ char* deparseInterval (Datum datum) {
   return s.data;
 }
 
+/** buildAttrMap
+ *   Build the map from PostgreSQL attribute numbers to indexes in
+ *   db2Table->cols, so that columns can be found without a search.
+ *   Must be called whenever the columns or their pgattnum change.
+ */
+void buildAttrMap (DB2Table* db2Table) {
+  int i;
+
+  db2Table->nattrs = db2Table->npgcols;
+  for (i = 0; i < db2Table->ncols; ++i) {
+    if (db2Table->cols[i]->pgattnum > db2Table->nattrs)
+      db2Table->nattrs = db2Table->cols[i]->pgattnum;
+  }
+  db2Table->attrmap = (int*) db2alloc ("db2Table->attrmap", sizeof (int) * Max (db2Table->nattrs, 1));
+  for (i = 0; i < db2Table->nattrs; ++i)
+    db2Table->attrmap[i] = -1;
+  /* columns that are not in the PostgreSQL table have pgattnum 0 */
+  for (i = 0; i < db2Table->ncols; ++i) {
+    if (db2Table->cols[i]->pgattnum > 0)
+      db2Table->attrmap[db2Table->cols[i]->pgattnum - 1] = i;
+  }
+}
+
+/** db2ColumnIndex
+ *   Return the index in db2Table->cols of the column with PostgreSQL
+ *   attribute number "attnum", or -1 if there is none.
+ */
+int db2ColumnIndex (const DB2Table* db2Table, int attnum) {
+  int index;
+
+  if (db2Table->attrmap != NULL)
+    return (attnum > 0 && attnum <= db2Table->nattrs) ? db2Table->attrmap[attnum - 1] : -1;
+  /* tables that are only described have no map */
+  for (index = db2Table->ncols - 1; index >= 0 && db2Table->cols[index]->pgattnum != attnum; --index)
+    ;
+  return index;
+}
+
+/** allocColumnBuffers
+ *   Allocate the result buffers of all used columns as one block and
+ *   point their "val" there, each buffer aligned and val_bound+1 bytes long.
+ *   If "column_buffer" is nonzero, the buffers of variable length character
+ *   columns are no larger than that, longer values are read separately.
+ *   LOB columns get no buffer, db2GetLob reads them when the row is converted.
+ *   The columns without a buffer get NULL, all indicators are reset.
+ *   The size of the block is reported by EXPLAIN.
+ */
+void allocColumnBuffers (DB2Table* db2Table, int column_buffer) {
+  size_t offset = 0;
+  int    i;
+
+  for (i = 0; i < db2Table->ncols; ++i) {
+    DB2Column* col = db2Table->cols[i];
+
+    col->val_bound = col->val_size;
+    if (column_buffer > 0 && col->val_size > (size_t) column_buffer && hasOverflow (col))
+      col->val_bound = (size_t) column_buffer;
+    if (c2dbType (col->colType) == DB2_BLOB || c2dbType (col->colType) == DB2_CLOB)
+      col->val_bound = 0;
+    if (col->used == 1 && col->val_bound > 0)
+      offset += MAXALIGN (col->val_bound + 1);
+  }
+  db2Table->buffers_size = offset;
+  db2Table->buffers      = (offset > 0) ? (char*) db2alloc ("db2Table->buffers", offset) : NULL;
+  offset = 0;
+  for (i = 0; i < db2Table->ncols; ++i) {
+    DB2Column* col = db2Table->cols[i];
+
+    if (col->used == 1 && col->val_bound > 0) {
+      col->val = db2Table->buffers + offset;
+      offset  += MAXALIGN (col->val_bound + 1);
+    } else {
+      col->val = NULL;
+    }
+    col->val_len  = 0;
+    col->val_null = 1;
+  }
+  db2Debug2("  result buffers of table %s: %ld bytes", db2Table->name, (long) db2Table->buffers_size);
+}
+
+/** hasOverflow
+ *   Return true for the columns whose values are fetched as strings or bytes
+ *   of varying length, so that a value too long for the bound buffer can be
+ *   read with SQLGetData after the fetch.
+ */
+bool hasOverflow (DB2Column* column) {
+  switch (c2dbType (column->colType)) {
+    case DB2_VARCHAR:
+    case DB2_LONGVARCHAR:
+    case DB2_VARGRAPHIC:
+    case DB2_LONGVARGRAPHIC:
+    case DB2_WVARCHAR:
+    case DB2_WLONGVARCHAR:
+    case DB2_XML:
+      return (column->pgtype != BYTEAOID);
+    case DB2_VARBINARY:
+    case DB2_LONGVARBINARY:
+      return (column->pgtype == BYTEAOID);
+    default:
+      return false;
+  }
+}
+
+/** resultPosition
+ *   Return the position of column "index" in the result of the DB2 query,
+ *   which selects the used columns in their order.
+ */
+int resultPosition (const DB2Table* db2Table, int index) {
+  int position = 0;
+  int i;
+
+  for (i = 0; i <= index; ++i)
+    if (db2Table->cols[i]->used)
+      ++position;
+  return position;
+}
+
+/** budgetPrefetch
+ *   Return the number of rows to prefetch. Without a "fetch_memory" budget,
+ *   that is the "prefetch" option. Otherwise as many rows as fit into the
+ *   budget: the length of a row is taken from the values converted so far,
+ *   or, before the first row, from the sizes of the result buffers.
+ *   Between 1 and MAX_PREFETCH rows are prefetched.
+ */
+unsigned int budgetPrefetch (DB2FdwState* fdw_state) {
+  double row_bytes;
+  double rows;
+
+  if (fdw_state->fetch_memory <= 0)
+    return fdw_state->prefetch;
+  if (fdw_state->fetch_rows > 0)
+    row_bytes = fdw_state->fetch_bytes / fdw_state->fetch_rows;
+  else
+    row_bytes = (double) fdw_state->db2Table->buffers_size;
+  rows = fdw_state->fetch_memory / Max (row_bytes, 1.0);
+  return (unsigned int) Max (Min (rows, (double) MAX_PREFETCH), 1.0);
+}
+
 /** convertTuple
  *   Convert a result row from DB2 stored in db2Table
  *   into arrays of values and null indicators.
- *   If trunc_lob it true, truncate LOBs to WIDTH_THRESHOLD+1 bytes.
+ *   If trunc_lob it true, truncate LOBs to WIDTH_THRESHOLD+1 bytes,
+ *   which is all ANALYZE looks at.
  */
 void convertTuple (DB2FdwState* fdw_state, Datum* values, bool* nulls, bool trunc_lob) {
   char*                tmp_value = NULL;
   char*                value     = NULL;
   long                 value_len = 0;
-  int                  j, 
-                       index     = -1;
+  int                  j,
+                       index;
 //  ErrorContextCallback errcb;
   Oid                  pgtype;
 
@@ -1259,25 +2018,17 @@ void convertTuple (DB2FdwState* fdw_state, Datum* values, bool* nulls, bool trun
 
   /* assign result values */
   for (j = 0; j < fdw_state->db2Table->npgcols; ++j) {
-    short db2Type;
+    bool  fromlob = false;  /* value was allocated by db2GetLob */
     db2Debug2("  start processing column %d of %d",j + 1, fdw_state->db2Table->npgcols);
-    db2Debug2("  index: %d",index);
-    /* for dropped columns, insert a NULL */
-    if ((index + 1 < fdw_state->db2Table->ncols) && (fdw_state->db2Table->cols[index + 1]->pgattnum > j + 1)) {
-      nulls[j] = true;
-      values[j] = PointerGetDatum (NULL);
-      continue;
-    } else {
-      ++index;
-    }
+    index = db2ColumnIndex (fdw_state->db2Table, j + 1);
     db2Debug2("  index: %d",index);
     /*
-     * Columns exceeding the length of the DB2 table will be NULL,
-     * as well as columns that are not used in the query.
+     * Dropped columns and columns exceeding the length of the DB2 table
+     * will be NULL, as well as columns that are not used in the query.
      * Geometry columns are NULL if the value is NULL,
      * for all other types use the NULL indicator.
      */
-    if (index >= fdw_state->db2Table->ncols || fdw_state->db2Table->cols[index]->used == 0 || fdw_state->db2Table->cols[index]->val_null == -1) {
+    if (index < 0 || fdw_state->db2Table->cols[index]->used == 0 || fdw_state->db2Table->cols[index]->val_null == -1) {
       nulls[j] = true;
       values[j] = PointerGetDatum (NULL);
       continue;
@@ -1293,18 +2044,18 @@ void convertTuple (DB2FdwState* fdw_state, Datum* values, bool* nulls, bool trun
       case DB2_CLOB: {
         db2Debug3("  DB2_BLOB or DB2CLOB");
         /* for LOBs, get the actual LOB contents (allocated), truncated if desired */
-        /* the column index is 1 based, whereas index id 0 based, so always add 1 to index when calling db2GetLob, since it does a column based access*/
-        db2GetLob (fdw_state->session, fdw_state->db2Table->cols[index], index+1, &value, &value_len, trunc_lob ? (WIDTH_THRESHOLD + 1) : 0);
-      }
-      break;
-      case DB2_LONGVARBINARY: {
-        db2Debug3("  DB2_LONGBINARY datatypes");
-        /* for LONG and LONG RAW, the first 4 bytes contain the length */
-        value_len = *((int32 *) fdw_state->db2Table->cols[index]->val);
-        /* the rest is the actual data */
-        value = fdw_state->db2Table->cols[index]->val;
-        /* terminating zero byte (needed for LONGs) */
-        value[value_len] = '\0';
+        db2GetLob (fdw_state->session, fdw_state->db2Table->cols[index], resultPosition (fdw_state->db2Table, index), &value, &value_len, trunc_lob ? (WIDTH_THRESHOLD + 1) : 0);
+        fromlob = true;
+        if (value == NULL) {
+          nulls[j]  = true;
+          values[j] = PointerGetDatum (NULL);
+          continue;
+        }
+        /* don't cut a truncated CLOB in the middle of a character */
+        if (trunc_lob && value_len > WIDTH_THRESHOLD && fdw_state->db2Table->cols[index]->pgtype != BYTEAOID) {
+          value_len = pg_mbcliplen (value, value_len, value_len);
+          value[value_len] = '\0';
+        }
       }
       break;
       case DB2_FLOAT:
@@ -1325,11 +2076,26 @@ void convertTuple (DB2FdwState* fdw_state, Datum* values, bool* nulls, bool trun
       }
       break;
       default: {
+        DB2Column* col = fdw_state->db2Table->cols[index];
+
         db2Debug3("  shoud be string based values");
-        /* for other data types, db2Table contains the results */
-        value     = fdw_state->db2Table->cols[index]->val;
-        value_len = fdw_state->db2Table->cols[index]->val_len;
-        value_len = (value_len == 0) ? strlen(value) : value_len;
+        /* a string needs one byte of the buffer for its terminating zero */
+        if (hasOverflow (col) && col->val_null >= 0 && (size_t) col->val_null + (pgtype == BYTEAOID ? 0 : 1) > col->val_bound) {
+          /* the value was truncated to the buffer, the indicator has its full length */
+          db2Debug3("  value of %d bytes exceeds buffer, read it separately", col->val_null);
+          db2GetLob (fdw_state->session, col, resultPosition (fdw_state->db2Table, index), &value, &value_len, 0);
+          fromlob = true;
+        } else {
+          /* for other data types, db2Table contains the results */
+          value     = col->val;
+          value_len = col->val_len;
+          if (pgtype == BYTEAOID) {
+            /* binary values have no terminating zero, the indicator has their length */
+            value_len = col->val_null;
+          } else {
+            value_len = (value_len == 0) ? strlen(value) : value_len;
+          }
+        }
       }
       break;
     }
@@ -1338,6 +2104,7 @@ void convertTuple (DB2FdwState* fdw_state, Datum* values, bool* nulls, bool trun
       db2Debug2("  value    : '%s'", value);
     }
     db2Debug2("  value_len: %ld" , value_len);
+    fdw_state->fetch_bytes += value_len;
     db2Debug2("  fdw_state->db2Table->cols[%d]->val_null : %d",index,fdw_state->db2Table->cols[index]->val_len );
     db2Debug2("  fdw_state->db2Table->cols[%d]->val_null : %d",index,fdw_state->db2Table->cols[index]->val_null);
     db2Debug2("  fdw_state->db2Table->cols[%d]->pgname   : %s",index,fdw_state->db2Table->cols[index]->pgname  );
@@ -1345,7 +2112,14 @@ void convertTuple (DB2FdwState* fdw_state, Datum* values, bool* nulls, bool trun
     db2Debug2("  fdw_state->db2Table->cols[%d]->pgtype   : %d",index,fdw_state->db2Table->cols[index]->pgtype  );
     db2Debug2("  fdw_state->db2Table->cols[%d]->pgtypemod: %d",index,fdw_state->db2Table->cols[index]->pgtypmod);
     /* fill the TupleSlot with the data (after conversion if necessary) */
-    if (pgtype == BYTEAOID) {
+    if (pgtype == BYTEAOID && fromlob) {
+      /* db2GetLob left room for the header, use the value in place */
+      bytea* result = (bytea*) (value - DB2_LOB_HEADER);
+      SET_VARSIZE (result, value_len + VARHDRSZ);
+
+      values[j] = PointerGetDatum (result);
+      fromlob   = false;
+    } else if (pgtype == BYTEAOID) {
       /* binary columns are not converted */
       bytea* result = (bytea*) db2alloc ("bytea", value_len + VARHDRSZ);
       memcpy (VARDATA (result), value, value_len);
@@ -1404,16 +2178,12 @@ void convertTuple (DB2FdwState* fdw_state, Datum* values, bool* nulls, bool trun
 //      error_context_stack = errcb.previous;
     }
 
-    /* release the data buffer for LOBs */
-    db2Type = c2dbType(fdw_state->db2Table->cols[index]->colType);
-    if (db2Type == DB2_BLOB || db2Type == DB2_CLOB) {
-      if (value != NULL) {
-        db2free (value);
-      } else {
-        db2Debug2("  not freeing value, since it is null");
-      }
+    /* release the data buffer of values read by db2GetLob */
+    if (fromlob) {
+      db2free (value - DB2_LOB_HEADER);
     }
   }
+  ++fdw_state->fetch_rows;
   db2Debug1("< %s::convertTuple",__FILE__);
 }
 
@@ -13,6 +13,7 @@ SQLSMALLINT   c2param              (SQLSMALLINT fparamType);
 char*         param2name           (SQLSMALLINT fparamType);
 SQLSMALLINT   param2c              (SQLSMALLINT fcType);
 short         c2dbType             (short fcType);
+short         dbType2c             (short dbType);
 char*         c2name               (short fcType);
 void          parse2num_struct     (const char* s, SQL_NUMERIC_STRUCT* ns);
 
@@ -277,6 +278,57 @@ short c2dbType(short fcType){
   return dbType;
 }
 
+/** dbType2c
+ *    Map the fdw internal value representation back to a fcType.
+ *    Used for result columns that the fdw defines itself
+ *    instead of getting them from a table description.
+ */
+short dbType2c(short dbType){
+  short fcType = SQL_UNKNOWN_TYPE;
+  switch (dbType) {
+    case DB2_CHAR:
+      fcType = SQL_CHAR;
+    break;
+    case DB2_VARCHAR:
+      fcType = SQL_VARCHAR;
+    break;
+    case DB2_SMALLINT:
+      fcType = SQL_SMALLINT;
+    break;
+    case DB2_INTEGER:
+      fcType = SQL_INTEGER;
+    break;
+    case DB2_BIGINT:
+      fcType = SQL_BIGINT;
+    break;
+    case DB2_DECIMAL:
+      fcType = SQL_DECIMAL;
+    break;
+    case DB2_DECFLOAT:
+      fcType = SQL_DECFLOAT;
+    break;
+    case DB2_REAL:
+      fcType = SQL_REAL;
+    break;
+    case DB2_DOUBLE:
+      fcType = SQL_DOUBLE;
+    break;
+    case DB2_TYPE_DATE:
+      fcType = SQL_TYPE_DATE;
+    break;
+    case DB2_TYPE_TIME:
+      fcType = SQL_TYPE_TIME;
+    break;
+    case DB2_TYPE_TIMESTAMP:
+      fcType = SQL_TYPE_TIMESTAMP;
+    break;
+    default:
+      fcType = SQL_UNKNOWN_TYPE;
+    break;
+  }
+  return fcType;
+}
+
 /** c2name
  *    For debugging purpose provide a human readable text on a
  *    given SQL data type value.
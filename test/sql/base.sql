@@ -46,6 +46,80 @@ select * from sample.employee a, sample.sales b where a.lastname = b.sales_perso
 create table sample.orgcopy as select * from sample.org;
 \d+ sample.org*
 drop table sample.orgcopy;
+-- show the DB2 query of a statement without the MD5 hash that varies
+CREATE FUNCTION db2_remote_query(stmt text) RETURNS SETOF text LANGUAGE plpgsql AS $$
+DECLARE
+  line text;
+BEGIN
+  FOR line IN EXECUTE 'EXPLAIN (VERBOSE, COSTS OFF) ' || stmt LOOP
+    IF line ~ 'DB2 query' THEN
+      RETURN NEXT regexp_replace(trim(line), '/\*[0-9a-f]{32}\*/ ', '');
+    END IF;
+  END LOOP;
+END
+$$;
+-- bound IN lists: empty arrays and NULL elements must give the same results as in PostgreSQL
+ALTER FOREIGN TABLE sample.org OPTIONS (ADD bind_constants 'on');
+SELECT db2_remote_query('SELECT deptnumb FROM sample.org WHERE deptnumb = ANY(''{}''::smallint[])');
+SELECT deptnumb FROM sample.org WHERE deptnumb = ANY('{}'::smallint[]);
+SELECT count(*) FROM sample.org WHERE (deptnumb = ANY('{}'::smallint[])) IS FALSE;
+SELECT db2_remote_query('SELECT deptnumb FROM sample.org WHERE (deptnumb = ANY(''{10,NULL}''::smallint[])) IS UNKNOWN');
+SELECT deptnumb FROM sample.org WHERE (deptnumb = ANY('{10,NULL}'::smallint[])) IS UNKNOWN ORDER BY deptnumb;
+SELECT deptnumb FROM sample.org WHERE deptnumb = ANY('{10,NULL,84}'::smallint[]) ORDER BY deptnumb;
+-- arrays with a NULL element do not use a key table
+ALTER FOREIGN TABLE sample.org OPTIONS (ADD key_table_threshold '2');
+SELECT deptnumb FROM sample.org WHERE deptnumb = ANY('{15,10,15}'::smallint[]) ORDER BY deptnumb;
+SELECT deptnumb FROM sample.org WHERE (deptnumb = ANY('{10,15,NULL}'::smallint[])) IS UNKNOWN ORDER BY deptnumb;
+PREPARE arrayq(smallint[]) AS SELECT count(*) FROM sample.org WHERE (deptnumb = ANY($1)) IS NOT TRUE;
+EXECUTE arrayq('{}');
+EXECUTE arrayq('{10,15,20}');
+EXECUTE arrayq(NULL);
+DEALLOCATE arrayq;
+ALTER FOREIGN TABLE sample.org OPTIONS (DROP key_table_threshold, DROP bind_constants);
+-- GREATEST and LEAST ignore NULL arguments like in PostgreSQL
+SELECT db2_remote_query('SELECT deptnumb FROM sample.org WHERE LEAST(deptnumb, NULLIF(manager, 160)) = 10');
+SELECT deptnumb FROM sample.org WHERE LEAST(deptnumb, NULLIF(manager, 160)) = 10 ORDER BY deptnumb;
+SELECT deptnumb FROM sample.org WHERE GREATEST(NULLIF(deptnumb, 84), manager) > 280;
+SELECT count(*) FROM sample.org WHERE GREATEST(NULLIF(deptnumb, deptnumb), NULL::smallint) IS NULL;
+-- casts to numeric are pushed down for integer and numeric values, not for floats
+SELECT db2_remote_query('SELECT deptnumb FROM sample.org WHERE (manager * 0.1)::numeric(10,1) = 1');
+SELECT deptnumb FROM sample.org WHERE (manager * 0.1)::numeric(10,1) = 1;
+SELECT db2_remote_query('SELECT deptnumb FROM sample.org WHERE (manager * 0.1::float8)::numeric(10,1) = 1');
+SELECT deptnumb FROM sample.org WHERE (manager * 0.1::float8)::numeric(10,1) = 1;
+-- window functions are computed by DB2
+SELECT db2_remote_query('SELECT deptnumb, division, row_number() OVER (PARTITION BY division ORDER BY deptnumb) FROM sample.org') LIKE '%ROW_NUMBER() OVER (%' AS pushed;
+SELECT deptnumb, division, row_number() OVER (PARTITION BY division ORDER BY deptnumb) FROM sample.org ORDER BY deptnumb;
+SELECT deptnumb, sum(manager) OVER (ORDER BY deptnumb), lag(deptnumb) OVER (ORDER BY deptnumb) FROM sample.org ORDER BY deptnumb;
+-- avg is only pushed down for floating point arguments, DB2 truncates the average of integers
+SELECT db2_remote_query('SELECT deptnumb, avg(manager) OVER (PARTITION BY division) FROM sample.org') LIKE '%OVER (%' AS pushed;
+SELECT db2_remote_query('SELECT deptnumb, avg(manager::float8) OVER (PARTITION BY division) FROM sample.org') LIKE '%AVG(%' AS pushed;
+SELECT deptnumb, avg(manager::float8) OVER (PARTITION BY division) FROM sample.org ORDER BY deptnumb;
+-- expressions of the SELECT list are computed by DB2 if that saves transfer
+SELECT db2_remote_query('SELECT substr(deptname, 1, 3) FROM sample.org') LIKE '%SELECT SUBSTR(%' AS pushed;
+SELECT substr(deptname, 1, 3) FROM sample.org ORDER BY 1;
+SELECT deptnumb, substr(deptname, 1, 3), manager * 2 FROM sample.org ORDER BY deptnumb;
+-- validate the options for LOAD, fetch buffers and function templates
+CREATE FOREIGN TABLE sample.opttest (id integer) SERVER sample OPTIONS (schema 'DB2INST1', table 'ORG', load 'insert', load_savecount '1000', fetch_memory '1GB', column_buffer '1GB');
+ALTER FOREIGN TABLE sample.opttest OPTIONS (SET load 'append');
+ALTER FOREIGN TABLE sample.opttest OPTIONS (SET load_savecount '-1');
+ALTER FOREIGN TABLE sample.opttest OPTIONS (SET fetch_memory '4kB');
+ALTER FOREIGN TABLE sample.opttest OPTIONS (SET fetch_memory '2GB');
+ALTER FOREIGN TABLE sample.opttest OPTIONS (SET column_buffer '32');
+ALTER FOREIGN TABLE sample.opttest OPTIONS (ADD load_messages '');
+ALTER FOREIGN TABLE sample.opttest OPTIONS (ADD load_messages '/tmp/db2_fdw_load.msg');
+DROP FOREIGN TABLE sample.opttest;
+ALTER SERVER sample OPTIONS (ADD function_map 'upper=UCASE;initcap=');
+ALTER SERVER sample OPTIONS (SET function_map 'upper');
+ALTER SERVER sample OPTIONS (DROP function_map);
+-- only privileged roles may name a message file for LOAD
+CREATE ROLE db2_fdw_nofiles;
+GRANT USAGE ON FOREIGN SERVER sample TO db2_fdw_nofiles;
+GRANT CREATE ON SCHEMA sample TO db2_fdw_nofiles;
+SET ROLE db2_fdw_nofiles;
+CREATE FOREIGN TABLE sample.opttest (id integer) SERVER sample OPTIONS (table 'ORG', load_messages '/tmp/db2_fdw_load.msg');
+RESET ROLE;
+DROP OWNED BY db2_fdw_nofiles;
+DROP ROLE db2_fdw_nofiles;
 -- cleanup
 \c postgres
 DROP DATABASE regtest;